@@ -0,0 +1,165 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Batch.h"
+#include "Mandelbrot.h"
+
+struct BatchQueue
+{
+    const Viewport *views;
+    size_t          n_views;
+    const size_t   *first_pixels;  // number of the first pixel of every view, and the total at n_views
+    const size_t   *first_columns; // where the x of every view start in x_grid, and the total at n_views
+    const size_t   *first_rows;    // the same for y_grid
+    const float    *x_grid;        // x of every column and y of every row of all views, from GridCoordinates, so that
+    const float    *y_grid;        // the counts are those of RenderMandelbrotCounts
+    unsigned        n_iterations;
+
+    size_t next_pixel;  // both taken with __atomic_fetch_add
+    size_t next_view;
+};
+
+static void RunThreads(void *(*function)(void *), BatchQueue *queue, unsigned n_threads);
+static void *RenderChunks(void *queue_p);
+static void *ColorViews(void *queue_p);
+static size_t FindView(const BatchQueue *queue, size_t pixel);
+
+void RenderMandelbrotBatch(const Viewport *views, size_t n_views, unsigned n_iterations, unsigned n_threads)
+{
+    if(n_threads == 0) n_threads = 1;
+    if(n_threads > BATCH_MAX_THREADS) n_threads = BATCH_MAX_THREADS;
+
+    size_t *first_pixels  = (size_t *)calloc(n_views + 1, sizeof(size_t));
+    size_t *first_columns = (size_t *)calloc(n_views + 1, sizeof(size_t));
+    size_t *first_rows    = (size_t *)calloc(n_views + 1, sizeof(size_t));
+    for(size_t view = 0; view < n_views; view++)
+    {
+        first_pixels[view + 1]  = first_pixels[view]  + (size_t)views[view].width * views[view].height;
+        first_columns[view + 1] = first_columns[view] + views[view].width;
+        first_rows[view + 1]    = first_rows[view]    + views[view].height;
+    }
+
+    float *x_grid = (float *)calloc(first_columns[n_views] + 1, sizeof(float));
+    float *y_grid = (float *)calloc(first_rows[n_views]    + 1, sizeof(float));
+    for(size_t view = 0; view < n_views; view++)
+    {
+        GridCoordinates(x_grid + first_columns[view], y_grid + first_rows[view], views[view].width, views[view].height,
+                        views[view].x_rend, views[view].y_rend, views[view].delta);
+    }
+
+    BatchQueue queue = {views, n_views, first_pixels, first_columns, first_rows, x_grid, y_grid, n_iterations, 0, 0};
+
+    RunThreads(RenderChunks, &queue, n_threads);
+    RunThreads(ColorViews,   &queue, n_threads);
+
+    free(y_grid);
+    free(x_grid);
+    free(first_rows);
+    free(first_columns);
+    free(first_pixels);
+}
+
+static void RunThreads(void *(*function)(void *), BatchQueue *queue, unsigned n_threads)
+{
+    if(n_threads == 1)
+    {
+        function(queue);
+        return;
+    }
+
+    pthread_t threads[BATCH_MAX_THREADS] = {};
+    for(unsigned i = 0; i < n_threads; i++) pthread_create(threads + i, NULL, function, queue);
+    for(unsigned i = 0; i < n_threads; i++) pthread_join(threads[i], NULL);
+}
+
+// A chunk is cut into pieces, one per view it touches. The coordinates of all its pixels go into one pair of arrays for
+// RenderMandelbrotPoints, so the vectors run across row ends and views, and the counts are copied back piece by piece.
+static void *RenderChunks(void *queue_p)
+{
+    BatchQueue *queue = (BatchQueue *)queue_p;
+
+    float    x[BATCH_CHUNK] = {};
+    float    y[BATCH_CHUNK] = {};
+    unsigned n[BATCH_CHUNK] = {};
+
+    size_t n_pixels = queue->first_pixels[queue->n_views];
+    for(;;)
+    {
+        size_t start = __atomic_fetch_add(&queue->next_pixel, (size_t)BATCH_CHUNK, __ATOMIC_RELAXED);
+        if(start >= n_pixels) break;
+
+        size_t end        = (start + BATCH_CHUNK < n_pixels) ? start + BATCH_CHUNK : n_pixels;
+        size_t first_view = FindView(queue, start);
+
+        for(size_t pix = start, view = first_view; pix < end; view++)
+        {
+            const Viewport *viewport  = queue->views + view;
+            size_t          piece_end = (queue->first_pixels[view + 1] < end) ? queue->first_pixels[view + 1] : end;
+            if(piece_end == pix) continue;
+
+            const float *columns = queue->x_grid + queue->first_columns[view];
+            const float *rows    = queue->y_grid + queue->first_rows[view];
+
+            size_t   local = pix - queue->first_pixels[view];
+            unsigned x_pos = (unsigned)(local % viewport->width);
+            unsigned y_pos = (unsigned)(local / viewport->width);
+            for(; pix < piece_end; pix++)
+            {
+                x[pix - start] = columns[x_pos];
+                y[pix - start] = rows[y_pos];
+
+                if(++x_pos == viewport->width)
+                {
+                    x_pos = 0;
+                    y_pos++;
+                }
+            }
+        }
+
+        RenderMandelbrotPoints(n, NULL, x, y, end - start, queue->n_iterations);
+
+        for(size_t pix = start, view = first_view; pix < end; view++)
+        {
+            size_t piece_end = (queue->first_pixels[view + 1] < end) ? queue->first_pixels[view + 1] : end;
+            if(piece_end == pix) continue;
+
+            memcpy(queue->views[view].counts + (pix - queue->first_pixels[view]), n + (pix - start), (piece_end - pix) * sizeof(unsigned));
+            pix = piece_end;
+        }
+    }
+
+    return NULL;
+}
+
+static void *ColorViews(void *queue_p)
+{
+    BatchQueue *queue = (BatchQueue *)queue_p;
+
+    for(;;)
+    {
+        size_t view = __atomic_fetch_add(&queue->next_view, (size_t)1, __ATOMIC_RELAXED);
+        if(view >= queue->n_views) break;
+
+        const Viewport *viewport = queue->views + view;
+        if(viewport->pixels) ColorMandelbrot(viewport->pixels, viewport->counts, (size_t)viewport->width * viewport->height);
+    }
+
+    return NULL;
+}
+
+// The view the pixel belongs to, views of no pixels skipped.
+static size_t FindView(const BatchQueue *queue, size_t pixel)
+{
+    size_t low  = 0;
+    size_t high = queue->n_views;
+    while(high - low > 1)
+    {
+        size_t middle = (low + high) / 2;
+        if(queue->first_pixels[middle] <= pixel) low = middle;
+        else high = middle;
+    }
+
+    while(pixel >= queue->first_pixels[low + 1]) low++;
+    return low;
+}
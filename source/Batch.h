@@ -0,0 +1,30 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Many small views in one call, for thumbnails. Rendered one by one, every view pays the setup of a render and leaves
+// the last vector of each row and the threads of a thread pool partly idle; here the pixels of all views are numbered
+// one after another and cut into vectors of 8 that may span rows and views, and the threads take chunks of them from a
+// shared counter. Every pixel lands in the buffers of its own view. Coordinates are those of RenderMandelbrotCounts:
+// (x_rend, y_rend) is the top left pixel, delta the distance between pixels; the kernel is [8 x float].
+
+const unsigned BATCH_CHUNK       = 512;  // pixels a thread takes at once, a multiple of 8
+const unsigned BATCH_MAX_THREADS = 64;
+
+struct Viewport
+{
+    float    x_rend;
+    float    y_rend;
+    float    delta;
+    unsigned width;
+    unsigned height;
+
+    unsigned *counts;  // width * height escape counts, required
+    uint8_t  *pixels;  // width * height RGBA of the plain coloring, or NULL
+};
+
+void RenderMandelbrotBatch(const Viewport *views, size_t n_views, unsigned n_iterations, unsigned n_threads);
+
+#endif // BATCH_H
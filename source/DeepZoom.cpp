@@ -0,0 +1,617 @@
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+
+#include "DeepZoom.h"
+#include "Mandelbrot.h"
+
+const unsigned FIXED_FRACTION_BITS = 64 * FIXED_MAX_LIMBS - 4;
+
+// 2^27 + 1: splits a double into two halves of 26 bits whose products are exact.
+const double DEKKER_SPLITTER = 134217729.0;
+
+template<typename REAL>
+static inline void TwoSum(REAL a, REAL b, REAL *sum, REAL *error);
+template<typename REAL>
+static inline void QuickTwoSum(REAL a, REAL b, REAL *sum, REAL *error);
+template<typename REAL>
+static inline void TwoProduct(REAL a, REAL b, REAL *product, REAL *error);
+template<typename REAL>
+static inline void TwoSquare(REAL a, REAL *product, REAL *error);
+template<typename REAL>
+static inline void AddDoubleDouble(REAL a_hi, REAL a_lo, REAL b_hi, REAL b_lo, REAL *hi, REAL *lo);
+
+static inline __v4di IterateDoubleDouble(__v4df x_c_hi, __v4df x_c_lo, __v4df y_c_hi, __v4df y_c_lo, __v4di active, unsigned n_iterations);
+
+template<unsigned N>
+static void RenderFixedCounts(unsigned *counts, unsigned width, unsigned height, FixedPoint x_rend, FixedPoint y_rend, double delta,
+                              unsigned n_iterations);
+template<unsigned N>
+static inline __v4di IterateFixed(const __m256i *x_c, const __m256i *y_c, __m256i active, unsigned n_iterations);
+
+template<unsigned N>
+static inline void LoadFixed(__m256i *digits, const FixedPoint *lanes);
+template<unsigned N>
+static inline void AddFixed(__m256i *sum, const __m256i *a, const __m256i *b);
+template<unsigned N>
+static inline void AddNegatedFixed(__m256i *sum, const __m256i *a, const __m256i *b, __m256i negative);
+template<unsigned N>
+static inline void SubAddFixed(__m256i *result, const __m256i *a, const __m256i *b, const __m256i *c);
+template<unsigned N>
+static inline void NegateFixed(__m256i *digits, __m256i negative);
+template<unsigned N>
+static inline void DoubleProductFixed(__m256i *product, const __m256i *a, const __m256i *b);
+template<unsigned N>
+static inline void SquareFixed(__m256i *product, const __m256i *a);
+template<unsigned N, int SHIFT>
+static inline void NormalizeProduct(__m256i *product, const __m256i *lo, const __m256i *hi);
+
+static inline __m128i TailMask4(size_t n_left);
+static inline __m128i NarrowCounts(__v4di n);
+
+static uint64_t DivideFixed(FixedPoint *number, uint64_t divisor);
+
+// ================================================================================================================================================================================
+// Fixed-point numbers
+// ================================================================================================================================================================================
+
+FixedPoint FixedAdd(FixedPoint a, FixedPoint b)
+{
+    FixedPoint sum = {};
+
+    unsigned __int128 carry = 0;
+    for(unsigned i = 0; i < FIXED_MAX_LIMBS; i++)
+    {
+        carry += (unsigned __int128)a.limbs[i] + b.limbs[i];
+        sum.limbs[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+
+    return sum;
+}
+
+FixedPoint FixedSub(FixedPoint a, FixedPoint b)
+{
+    FixedPoint difference = {};
+
+    unsigned __int128 carry = 1;
+    for(unsigned i = 0; i < FIXED_MAX_LIMBS; i++)
+    {
+        carry += (unsigned __int128)a.limbs[i] + ~b.limbs[i];
+        difference.limbs[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+
+    return difference;
+}
+
+// Exact unless the value has bits below 2^-252, those are cut off.
+FixedPoint FixedFromDouble(double value)
+{
+    FixedPoint number = {};
+    if(value == 0 || !isfinite(value)) return number;
+
+    int      exponent = 0;
+    uint64_t mantissa = (uint64_t)ldexp(frexp(fabs(value), &exponent), 53);
+
+    int shift = exponent - 53 + (int)FIXED_FRACTION_BITS;
+    if(shift < 0)
+    {
+        if(shift > -64) number.limbs[0] = mantissa >> -shift;
+    }
+    else
+    {
+        unsigned limb = shift / 64;
+        unsigned bit  = shift % 64;
+
+        if(limb < FIXED_MAX_LIMBS)                 number.limbs[limb]     = mantissa << bit;
+        if(bit != 0 && limb + 1 < FIXED_MAX_LIMBS) number.limbs[limb + 1] = mantissa >> (64 - bit);
+    }
+
+    return (value < 0) ? FixedSub(FixedPoint{}, number) : number;
+}
+
+// Decimal number like -0.7436438870371587047521915061: optional sign, integer part below 8, any number of fraction
+// digits. The fraction is rounded down to a multiple of 2^-252.
+bool ParseFixed(const char *text, FixedPoint *number)
+{
+    bool negative = (*text == '-');
+    if(*text == '-' || *text == '+') text++;
+
+    unsigned integer  = 0;
+    size_t   n_digits = 0;
+    for(; *text >= '0' && *text <= '9'; text++, n_digits++)
+    {
+        integer = integer * 10 + (*text - '0');
+        if(integer >= 8) return false;
+    }
+
+    const char *fraction   = text;
+    size_t      n_fraction = 0;
+    if(*text == '.')
+    {
+        fraction = ++text;
+        for(; *text >= '0' && *text <= '9'; text++) n_fraction++;
+    }
+
+    if(*text != '\0' || n_digits + n_fraction == 0) return false;
+
+    // Horner's scheme from the last digit: f <- (digit + f) / 10.
+    FixedPoint value = {};
+    for(size_t i = n_fraction; i-- > 0;)
+    {
+        value.limbs[FIXED_MAX_LIMBS - 1] += (uint64_t)(fraction[i] - '0') << (FIXED_FRACTION_BITS % 64);
+        DivideFixed(&value, 10);
+    }
+    value.limbs[FIXED_MAX_LIMBS - 1] += (uint64_t)integer << (FIXED_FRACTION_BITS % 64);
+
+    *number = negative ? FixedSub(FixedPoint{}, value) : value;
+    return true;
+}
+
+// Sum of the 32 bit pieces of the magnitude, each of them exact as a double, from the least significant one up.
+DoubleDouble FixedToDoubleDouble(FixedPoint number)
+{
+    bool negative = (number.limbs[FIXED_MAX_LIMBS - 1] >> 63) != 0;
+    if(negative) number = FixedSub(FixedPoint{}, number);
+
+    double hi = 0;
+    double lo = 0;
+    for(unsigned piece = 0; piece < 2 * FIXED_MAX_LIMBS; piece++)
+    {
+        uint32_t bits  = (uint32_t)(number.limbs[piece / 2] >> (32 * (piece % 2)));
+        double   value = ldexp((double)bits, 32 * (int)piece - (int)FIXED_FRACTION_BITS);
+
+        AddDoubleDouble(hi, lo, value, 0.0, &hi, &lo);
+    }
+
+    return negative ? DoubleDouble{-hi, -lo} : DoubleDouble{hi, lo};
+}
+
+// Divides a non-negative number by a small divisor, returns the remainder.
+static uint64_t DivideFixed(FixedPoint *number, uint64_t divisor)
+{
+    unsigned __int128 remainder = 0;
+    for(unsigned i = FIXED_MAX_LIMBS; i-- > 0;)
+    {
+        remainder = (remainder << 64) | number->limbs[i];
+        number->limbs[i] = (uint64_t)(remainder / divisor);
+        remainder %= divisor;
+    }
+
+    return (uint64_t)remainder;
+}
+
+// ================================================================================================================================================================================
+// Fixed-point kernel
+// ================================================================================================================================================================================
+
+// AVX2 only multiplies 32 x 32 -> 64 bits, so every 64-bit limb is kept as two 32-bit digits, each in a 64-bit lane
+// of its own __m256i: digit i of 4 pixels. Sums of products then have room for their carries, which are propagated
+// once per operation instead of once per product. N is the number of digits, twice the number of limbs.
+void RenderMandelbrotFixedCounts(unsigned *counts, unsigned width, unsigned height, FixedPoint x_rend, FixedPoint y_rend, double delta,
+                                 unsigned n_limbs, unsigned n_iterations)
+{
+    switch(n_limbs)
+    {
+        case 2: RenderFixedCounts<4>(counts, width, height, x_rend, y_rend, delta, n_iterations); return;
+        case 3: RenderFixedCounts<6>(counts, width, height, x_rend, y_rend, delta, n_iterations); return;
+        case 4: RenderFixedCounts<8>(counts, width, height, x_rend, y_rend, delta, n_iterations); return;
+        default: return;
+    }
+}
+
+template<unsigned N>
+static void RenderFixedCounts(unsigned *counts, unsigned width, unsigned height, FixedPoint x_rend, FixedPoint y_rend, double delta,
+                              unsigned n_iterations)
+{
+    FixedPoint delta_fixed = FixedFromDouble(delta);
+    FixedPoint step        = FixedFromDouble(4 * delta);
+
+    FixedPoint lanes[4] = {x_rend};
+    for(unsigned lane = 1; lane < 4; lane++) lanes[lane] = FixedAdd(lanes[lane - 1], delta_fixed);
+
+    __m256i x_start[N] = {};
+    __m256i step_v[N]  = {};
+    LoadFixed<N>(x_start, lanes);
+    for(unsigned lane = 0; lane < 4; lane++) lanes[lane] = step;
+    LoadFixed<N>(step_v, lanes);
+
+    FixedPoint y_row = y_rend;
+    for(unsigned y_pos = 0; y_pos < height; y_pos++, y_row = FixedSub(y_row, delta_fixed))
+    {
+        unsigned *counts_p = counts + (size_t)y_pos * width;
+
+        __m256i y_c[N] = {};
+        for(unsigned lane = 0; lane < 4; lane++) lanes[lane] = y_row;
+        LoadFixed<N>(y_c, lanes);
+
+        __m256i x_c[N] = {};
+        memcpy(x_c, x_start, sizeof(x_c));
+
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 4, counts_p += 4)
+        {
+            __m128i mask = TailMask4(width - x_pos);
+            __v4di  n    = IterateFixed<N>(x_c, y_c, _mm256_cvtepi32_epi64(mask), n_iterations);
+
+            _mm_maskstore_epi32((int *)counts_p, mask, NarrowCounts(n));
+
+            AddFixed<N>(x_c, x_c, step_v);
+        }
+    }
+}
+
+// Lanes that left the escape radius (or are past the end of the row) stay out of active: their digits overflow and wrap
+// around, and could come back inside. Squares are only taken of magnitudes, so the products never see a sign, and |x|, |y|
+// are checked against 2 before x^2 + y^2 is trusted, as the squares of escaped lanes wrap around. Every pass over the
+// digits is a chain of carries, so x^2 - y^2 + x_c and y_c +- 2xy are one pass each.
+template<unsigned N>
+static inline __v4di IterateFixed(const __m256i *x_c, const __m256i *y_c, __m256i active, unsigned n_iterations)
+{
+    const __m256i TWO_V  = _mm256_set1_epi64x((uint64_t)2 << (FIXED_FRACTION_BITS % 32));
+    const __m256i FOUR_V = _mm256_set1_epi64x((uint64_t)4 << (FIXED_FRACTION_BITS % 32));
+    const __m256i ZERO_V = _mm256_setzero_si256();
+
+    __m256i x_n[N] = {};
+    __m256i y_n[N] = {};
+
+    __m256i n = ZERO_V;
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __m256i x_negative = _mm256_sub_epi64(ZERO_V, _mm256_srli_epi64(x_n[N - 1], 31));
+        __m256i y_negative = _mm256_sub_epi64(ZERO_V, _mm256_srli_epi64(y_n[N - 1], 31));
+
+        NegateFixed<N>(x_n, x_negative);
+        NegateFixed<N>(y_n, y_negative);
+
+        __m256i x2[N] = {};
+        __m256i y2[N] = {};
+        __m256i r2[N] = {};
+        SquareFixed<N>(x2, x_n);
+        SquareFixed<N>(y2, y_n);
+        AddFixed<N>(r2, x2, y2);
+
+        __m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi64(TWO_V, x_n[N - 1]), _mm256_cmpgt_epi64(TWO_V, y_n[N - 1])),
+                                          _mm256_cmpgt_epi64(FOUR_V, r2[N - 1]));
+
+        active = _mm256_and_si256(active, inside);
+        if(_mm256_testz_si256(active, active)) break;
+
+        n = _mm256_sub_epi64(n, active);
+
+        __m256i xy2[N] = {};
+        DoubleProductFixed<N>(xy2, x_n, y_n);
+
+        SubAddFixed<N>(x_n, x2, y2, x_c);
+        AddNegatedFixed<N>(y_n, y_c, xy2, _mm256_xor_si256(x_negative, y_negative));
+    }
+
+    return (__v4di)n;
+}
+
+// The N most significant digits of the 4 numbers.
+template<unsigned N>
+static inline void LoadFixed(__m256i *digits, const FixedPoint *lanes)
+{
+    for(unsigned digit = 0; digit < N; digit++)
+    {
+        unsigned limb  = FIXED_MAX_LIMBS - N / 2 + digit / 2;
+        unsigned shift = 32 * (digit % 2);
+
+        digits[digit] = _mm256_set_epi64x((lanes[3].limbs[limb] >> shift) & 0xFFFFFFFF, (lanes[2].limbs[limb] >> shift) & 0xFFFFFFFF,
+                                          (lanes[1].limbs[limb] >> shift) & 0xFFFFFFFF, (lanes[0].limbs[limb] >> shift) & 0xFFFFFFFF);
+    }
+}
+
+template<unsigned N>
+static inline void AddFixed(__m256i *sum, const __m256i *a, const __m256i *b)
+{
+    const __m256i DIGIT_V = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    __m256i carry = _mm256_setzero_si256();
+    for(unsigned i = 0; i < N; i++)
+    {
+        __m256i total = _mm256_add_epi64(_mm256_add_epi64(a[i], b[i]), carry);
+
+        carry  = _mm256_srli_epi64(total, 32);
+        sum[i] = _mm256_and_si256(total, DIGIT_V);
+    }
+}
+
+// a + b in the lanes where negative is zero, a - b = a + ~b + 1 where it is all ones.
+template<unsigned N>
+static inline void AddNegatedFixed(__m256i *sum, const __m256i *a, const __m256i *b, __m256i negative)
+{
+    const __m256i DIGIT_V = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    __m256i flip  = _mm256_and_si256(negative, DIGIT_V);
+    __m256i carry = _mm256_srli_epi64(negative, 63);
+    for(unsigned i = 0; i < N; i++)
+    {
+        __m256i total = _mm256_add_epi64(_mm256_add_epi64(a[i], _mm256_xor_si256(b[i], flip)), carry);
+
+        carry  = _mm256_srli_epi64(total, 32);
+        sum[i] = _mm256_and_si256(total, DIGIT_V);
+    }
+}
+
+// a - b + c = a + ~b + 1 + c, the carry between digits is at most 2.
+template<unsigned N>
+static inline void SubAddFixed(__m256i *result, const __m256i *a, const __m256i *b, const __m256i *c)
+{
+    const __m256i DIGIT_V = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    __m256i carry = _mm256_set1_epi64x(1);
+    for(unsigned i = 0; i < N; i++)
+    {
+        __m256i total = _mm256_add_epi64(_mm256_add_epi64(a[i], _mm256_xor_si256(b[i], DIGIT_V)), _mm256_add_epi64(c[i], carry));
+
+        carry     = _mm256_srli_epi64(total, 32);
+        result[i] = _mm256_and_si256(total, DIGIT_V);
+    }
+}
+
+// Negates the lanes where negative is all ones.
+template<unsigned N>
+static inline void NegateFixed(__m256i *digits, __m256i negative)
+{
+    const __m256i DIGIT_V = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    __m256i flip  = _mm256_and_si256(negative, DIGIT_V);
+    __m256i carry = _mm256_srli_epi64(negative, 63);
+    for(unsigned i = 0; i < N; i++)
+    {
+        __m256i total = _mm256_add_epi64(_mm256_xor_si256(digits[i], flip), carry);
+
+        carry     = _mm256_srli_epi64(total, 32);
+        digits[i] = _mm256_and_si256(total, DIGIT_V);
+    }
+}
+
+// 2ab of two magnitudes, doubled by shifting one bit less when normalizing. Only the columns of the digit products
+// that reach the N digits kept are summed, the carry of the dropped ones is less than N units of the lowest column, far
+// below the last digit kept. Column k collects the low and the high halves of its products separately, so N products
+// never overflow 64 bits.
+template<unsigned N>
+static inline void DoubleProductFixed(__m256i *product, const __m256i *a, const __m256i *b)
+{
+    const __m256i DIGIT_V = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    __m256i lo[N] = {};
+    __m256i hi[N] = {};
+#pragma GCC unroll 8
+    for(unsigned i = 0; i < N; i++)
+    {
+#pragma GCC unroll 8
+        for(unsigned j = N - 1 - i; j < N; j++)
+        {
+            __m256i digit_product = _mm256_mul_epu32(a[i], b[j]);
+
+            lo[i + j - (N - 1)] = _mm256_add_epi64(lo[i + j - (N - 1)], _mm256_and_si256(digit_product, DIGIT_V));
+            hi[i + j - (N - 1)] = _mm256_add_epi64(hi[i + j - (N - 1)], _mm256_srli_epi64(digit_product, 32));
+        }
+    }
+
+    NormalizeProduct<N, FIXED_FRACTION_BITS % 32 - 1>(product, lo, hi);
+}
+
+// a^2 the same way, with each product a_i a_j, i != j, computed once and doubled.
+template<unsigned N>
+static inline void SquareFixed(__m256i *product, const __m256i *a)
+{
+    const __m256i DIGIT_V = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    __m256i lo[N] = {};
+    __m256i hi[N] = {};
+#pragma GCC unroll 8
+    for(unsigned i = 0; i < N; i++)
+    {
+#pragma GCC unroll 8
+        for(unsigned j = (i > N - 1 - i) ? i + 1 : N - 1 - i; j < N; j++)
+        {
+            __m256i digit_product = _mm256_mul_epu32(a[i], a[j]);
+
+            lo[i + j - (N - 1)] = _mm256_add_epi64(lo[i + j - (N - 1)], _mm256_and_si256(digit_product, DIGIT_V));
+            hi[i + j - (N - 1)] = _mm256_add_epi64(hi[i + j - (N - 1)], _mm256_srli_epi64(digit_product, 32));
+        }
+    }
+
+#pragma GCC unroll 8
+    for(unsigned k = 0; k < N; k++)
+    {
+        lo[k] = _mm256_add_epi64(lo[k], lo[k]);
+        hi[k] = _mm256_add_epi64(hi[k], hi[k]);
+    }
+
+#pragma GCC unroll 8
+    for(unsigned i = (N - 1) / 2 + (N - 1) % 2; i < N; i++)
+    {
+        __m256i digit_product = _mm256_mul_epu32(a[i], a[i]);
+
+        lo[2 * i - (N - 1)] = _mm256_add_epi64(lo[2 * i - (N - 1)], _mm256_and_si256(digit_product, DIGIT_V));
+        hi[2 * i - (N - 1)] = _mm256_add_epi64(hi[2 * i - (N - 1)], _mm256_srli_epi64(digit_product, 32));
+    }
+
+    NormalizeProduct<N, FIXED_FRACTION_BITS % 32>(product, lo, hi);
+}
+
+// Columns N - 1 ... 2N - 2 of a product to its digits N - 1 ... 2N - 1, shifted right by the fraction bits of the
+// lowest digit: (column digits) * 2^(32 (N - 1)) / 2^(32 N - 4) for SHIFT = 28.
+template<unsigned N, int SHIFT>
+static inline void NormalizeProduct(__m256i *product, const __m256i *lo, const __m256i *hi)
+{
+    const __m256i DIGIT_V = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    __m256i digits[N + 1] = {};
+
+    __m256i carry = _mm256_srli_epi64(lo[0], 32);
+    digits[0] = _mm256_and_si256(lo[0], DIGIT_V);
+    for(unsigned k = 1; k < N; k++)
+    {
+        __m256i total = _mm256_add_epi64(_mm256_add_epi64(lo[k], hi[k - 1]), carry);
+
+        carry     = _mm256_srli_epi64(total, 32);
+        digits[k] = _mm256_and_si256(total, DIGIT_V);
+    }
+    digits[N] = _mm256_add_epi64(hi[N - 1], carry);
+
+    for(unsigned k = 0; k < N; k++)
+    {
+        product[k] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(digits[k], SHIFT), _mm256_slli_epi64(digits[k + 1], 32 - SHIFT)), DIGIT_V);
+    }
+}
+
+// ================================================================================================================================================================================
+// Double-double kernel
+// ================================================================================================================================================================================
+
+// The error-free transformations below rely on every operation being rounded on its own, so this file must not be
+// built with contraction into FMA (-mfma with -ffp-contract=fast) or with -ffast-math.
+void RenderMandelbrotDoubleDoubleCounts(unsigned *counts, unsigned width, unsigned height, DoubleDouble x_rend, DoubleDouble y_rend, double delta,
+                                        unsigned n_iterations)
+{
+    static const __v4df SHIFT_V = _mm256_set_pd(3, 2, 1, 0);
+
+    __v4df delta_v   = _mm256_set1_pd(delta);
+    __v4df x_rend_hi = _mm256_set1_pd(x_rend.hi);
+    __v4df x_rend_lo = _mm256_set1_pd(x_rend.lo);
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        unsigned *counts_p = counts + (size_t)y_pos * width;
+
+        double y_hi = 0;
+        double y_lo = 0;
+        AddDoubleDouble(y_rend.hi, y_rend.lo, -(double)y_pos * delta, 0.0, &y_hi, &y_lo);
+
+        __v4df y_c_hi = _mm256_set1_pd(y_hi);
+        __v4df y_c_lo = _mm256_set1_pd(y_lo);
+
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 4, counts_p += 4)
+        {
+            __v4df x_c_hi = {};
+            __v4df x_c_lo = {};
+            AddDoubleDouble(x_rend_hi, x_rend_lo, (SHIFT_V + x_pos) * delta_v, __v4df{}, &x_c_hi, &x_c_lo);
+
+            __m128i mask = TailMask4(width - x_pos);
+            __v4di  n    = IterateDoubleDouble(x_c_hi, x_c_lo, y_c_hi, y_c_lo, (__v4di)_mm256_cvtepi32_epi64(mask), n_iterations);
+
+            _mm_maskstore_epi32((int *)counts_p, mask, NarrowCounts(n));
+        }
+    }
+}
+
+static inline __v4di IterateDoubleDouble(__v4df x_c_hi, __v4df x_c_lo, __v4df y_c_hi, __v4df y_c_lo, __v4di active, unsigned n_iterations)
+{
+    static const __v4df MAX_ZERO_OFFSET2_V = _mm256_set1_pd(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+
+    __v4df x_hi = {};
+    __v4df x_lo = {};
+    __v4df y_hi = {};
+    __v4df y_lo = {};
+
+    __v4di n = {};
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __v4df x2_hi = {}, x2_lo = {};
+        __v4df y2_hi = {}, y2_lo = {};
+        TwoSquare(x_hi, &x2_hi, &x2_lo);
+        TwoSquare(y_hi, &y2_hi, &y2_lo);
+        x2_lo += 2 * x_hi * x_lo;
+        y2_lo += 2 * y_hi * y_lo;
+
+        active &= (x2_hi + y2_hi < MAX_ZERO_OFFSET2_V);
+        if(_mm256_testz_si256((__m256i)active, (__m256i)active)) break;
+
+        n -= active;
+
+        __v4df xy_hi = {}, xy_lo = {};
+        TwoProduct(x_hi, y_hi, &xy_hi, &xy_lo);
+        xy_lo += x_hi * y_lo + x_lo * y_hi;
+
+        AddDoubleDouble(x2_hi, x2_lo, -y2_hi, -y2_lo, &x_hi, &x_lo);
+        AddDoubleDouble(x_hi, x_lo, x_c_hi, x_c_lo, &x_hi, &x_lo);
+        AddDoubleDouble(2 * xy_hi, 2 * xy_lo, y_c_hi, y_c_lo, &y_hi, &y_lo);
+    }
+
+    return n;
+}
+
+template<typename REAL>
+static inline void TwoSum(REAL a, REAL b, REAL *sum, REAL *error)
+{
+    REAL s       = a + b;
+    REAL b_taken = s - a;
+
+    *sum   = s;
+    *error = (a - (s - b_taken)) + (b - b_taken);
+}
+
+// |a| >= |b|
+template<typename REAL>
+static inline void QuickTwoSum(REAL a, REAL b, REAL *sum, REAL *error)
+{
+    REAL s = a + b;
+
+    *sum   = s;
+    *error = b - (s - a);
+}
+
+// Dekker's product: without FMA the error of a * b comes from splitting both factors into halves of 26 bits.
+template<typename REAL>
+static inline void TwoProduct(REAL a, REAL b, REAL *product, REAL *error)
+{
+    REAL a_split = a * DEKKER_SPLITTER;
+    REAL b_split = b * DEKKER_SPLITTER;
+    REAL a_hi    = a_split - (a_split - a);
+    REAL b_hi    = b_split - (b_split - b);
+    REAL a_lo    = a - a_hi;
+    REAL b_lo    = b - b_hi;
+    REAL p       = a * b;
+
+    *product = p;
+    *error   = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+}
+
+template<typename REAL>
+static inline void TwoSquare(REAL a, REAL *product, REAL *error)
+{
+    REAL a_split = a * DEKKER_SPLITTER;
+    REAL a_hi    = a_split - (a_split - a);
+    REAL a_lo    = a - a_hi;
+    REAL p       = a * a;
+
+    *product = p;
+    *error   = ((a_hi * a_hi - p) + 2 * a_hi * a_lo) + a_lo * a_lo;
+}
+
+// The sum of the high parts is exact, the low parts are added to its error without a second two-sum. The error is
+// relative to |a| + |b| rather than to |a + b|, which is what the iteration needs: it only keeps absolute error down.
+template<typename REAL>
+static inline void AddDoubleDouble(REAL a_hi, REAL a_lo, REAL b_hi, REAL b_lo, REAL *hi, REAL *lo)
+{
+    REAL sum   = {};
+    REAL error = {};
+    TwoSum(a_hi, b_hi, &sum, &error);
+
+    error += a_lo + b_lo;
+    QuickTwoSum(sum, error, hi, lo);
+}
+
+// ================================================================================================================================================================================
+// Tails
+// ================================================================================================================================================================================
+
+static inline __m128i TailMask4(size_t n_left)
+{
+    static const __m128i LANES_V = _mm_set_epi32(3, 2, 1, 0);
+
+    return _mm_cmpgt_epi32(_mm_set1_epi32((n_left < 4) ? (int)n_left : 4), LANES_V);
+}
+
+static inline __m128i NarrowCounts(__v4di n)
+{
+    static const __m256i EVEN_V = _mm256_set_epi32(7, 5, 3, 1, 6, 4, 2, 0);
+
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32((__m256i)n, EVEN_V));
+}
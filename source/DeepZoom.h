@@ -0,0 +1,42 @@
+#ifndef DEEP_ZOOM_H
+#define DEEP_ZOOM_H
+
+#include <stdint.h>
+
+// Kernels for views deeper than [4 x double] can resolve. Near |c| ~ 1 double keeps about 16 significant digits, so a
+// view stops being exact when the distance between pixels gets close to 1e-16. Double-double numbers (about 32 digits)
+// and fixed-point numbers of 2, 3 or 4 64-bit limbs (about 37, 56 and 75 digits) go deeper, at a higher cost per
+// iteration. Both kernels compute [4 x double] or [4 x uint64] vectors, 4 pixels at a time, and write escape counts
+// like RenderMandelbrotCounts, without mirroring.
+
+const unsigned FIXED_MAX_LIMBS = 4;
+const unsigned FIXED_MIN_LIMBS = 2;
+
+// Two's complement fixed-point number, least significant limb first: a 256-bit integer times 2^-252, so 3 integer bits
+// and |value| < 8. Kernels with fewer limbs use the most significant ones.
+struct FixedPoint
+{
+    uint64_t limbs[FIXED_MAX_LIMBS];
+};
+
+// Unevaluated sum hi + lo with |lo| <= ulp(hi) / 2.
+struct DoubleDouble
+{
+    double hi;
+    double lo;
+};
+
+bool         ParseFixed(const char *text, FixedPoint *number);
+FixedPoint   FixedFromDouble(double value);
+DoubleDouble FixedToDoubleDouble(FixedPoint number);
+FixedPoint   FixedAdd(FixedPoint a, FixedPoint b);
+FixedPoint   FixedSub(FixedPoint a, FixedPoint b);
+
+// x_rend and y_rend are the coordinates of the top left pixel as in the other kernels, delta only has to be precise
+// relative to itself, so a double is enough for it. n_limbs is 2, 3 or 4, anything else renders nothing.
+void RenderMandelbrotFixedCounts(unsigned *counts, unsigned width, unsigned height, FixedPoint x_rend, FixedPoint y_rend, double delta,
+                                 unsigned n_limbs, unsigned n_iterations);
+void RenderMandelbrotDoubleDoubleCounts(unsigned *counts, unsigned width, unsigned height, DoubleDouble x_rend, DoubleDouble y_rend, double delta,
+                                        unsigned n_iterations);
+
+#endif // DEEP_ZOOM_H
@@ -0,0 +1,147 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+enum EnergyZoneId
+{
+    ENERGY_PACKAGE,
+    ENERGY_CORE,
+
+    N_ENERGY_ZONES,
+};
+
+const char     ENERGY_POWERCAP_DIR[] = "/sys/class/powercap";
+const unsigned ENERGY_MAX_DOMAINS    = 8;    // sockets, each with its package and its core domain
+const size_t   ENERGY_PATH_SIZE      = 128;
+
+// RAPL energy counters of Linux powercap: intel-rapl:N is package N, its subzone named "core" the cores in it. Domains
+// of all sockets are summed. energy_uj is readable by root only on most kernels since 5.10 and is not there at all in
+// most VMs and containers; a zone without a readable domain is reported as n/a, so the benchmarks still run.
+struct EnergyCounters
+{
+    unsigned n_domains[N_ENERGY_ZONES];
+    char     path[N_ENERGY_ZONES][ENERGY_MAX_DOMAINS][ENERGY_PATH_SIZE];  // energy_uj files
+    uint64_t max_range[N_ENERGY_ZONES][ENERGY_MAX_DOMAINS];              // where the counter wraps, in uJ
+    uint64_t start[N_ENERGY_ZONES][ENERGY_MAX_DOMAINS];
+
+    double joules[N_ENERGY_ZONES];  // between the last EnergyCountersStart and EnergyCountersStop
+};
+
+inline bool ReadPowercapValue(const char *path, uint64_t *value);
+inline bool ReadPowercapName(const char *zone, char *name, size_t size);
+inline void AddEnergyDomain(EnergyCounters *counters, EnergyZoneId id, const char *zone);
+
+inline void EnergyCountersOpen(EnergyCounters *counters);
+inline bool EnergyAvailable(const EnergyCounters *counters, EnergyZoneId id);
+inline void EnergyCountersStart(EnergyCounters *counters);
+inline void EnergyCountersStop(EnergyCounters *counters);
+
+inline bool ReadPowercapValue(const char *path, uint64_t *value)
+{
+    FILE *file = fopen(path, "r");
+    if(!file) return false;
+
+    bool read = (fscanf(file, "%" SCNu64, value) == 1);
+    fclose(file);
+
+    return read;
+}
+
+inline bool ReadPowercapName(const char *zone, char *name, size_t size)
+{
+    char path[ENERGY_PATH_SIZE] = "";
+    snprintf(path, sizeof(path), "%s/name", zone);
+
+    FILE *file = fopen(path, "r");
+    if(!file) return false;
+
+    bool read = (fgets(name, (int)size, file) != NULL);
+    fclose(file);
+
+    name[strcspn(name, "\n")] = '\0';
+    return read;
+}
+
+// Keeps the domain only if its counter can be read now, so a missing permission shows up here and not as zeros later.
+inline void AddEnergyDomain(EnergyCounters *counters, EnergyZoneId id, const char *zone)
+{
+    unsigned domain = counters->n_domains[id];
+    if(domain >= ENERGY_MAX_DOMAINS) return;
+
+    char    *path   = counters->path[id][domain];
+    uint64_t energy = 0;
+
+    snprintf(path, ENERGY_PATH_SIZE, "%s/energy_uj", zone);
+    if(!ReadPowercapValue(path, &energy)) return;
+
+    char range_path[ENERGY_PATH_SIZE] = "";
+    snprintf(range_path, sizeof(range_path), "%s/max_energy_range_uj", zone);
+    if(!ReadPowercapValue(range_path, counters->max_range[id] + domain)) counters->max_range[id][domain] = 0;
+
+    counters->n_domains[id]++;
+}
+
+inline void EnergyCountersOpen(EnergyCounters *counters)
+{
+    memset(counters, 0, sizeof(*counters));
+
+    char name[32] = "";
+    for(unsigned package = 0; package < ENERGY_MAX_DOMAINS; package++)
+    {
+        char zone[ENERGY_PATH_SIZE] = "";
+        snprintf(zone, sizeof(zone), "%s/intel-rapl:%u", ENERGY_POWERCAP_DIR, package);
+        if(!ReadPowercapName(zone, name, sizeof(name))) break;
+
+        if(strncmp(name, "package", strlen("package")) == 0) AddEnergyDomain(counters, ENERGY_PACKAGE, zone);
+
+        for(unsigned subzone = 0; subzone < ENERGY_MAX_DOMAINS; subzone++)
+        {
+            char sub[ENERGY_PATH_SIZE] = "";
+            snprintf(sub, sizeof(sub), "%s/intel-rapl:%u:%u", zone, package, subzone);
+            if(!ReadPowercapName(sub, name, sizeof(name))) break;
+
+            if(strcmp(name, "core") == 0) AddEnergyDomain(counters, ENERGY_CORE, sub);
+        }
+    }
+}
+
+inline bool EnergyAvailable(const EnergyCounters *counters, EnergyZoneId id)
+{
+    return counters->n_domains[id] > 0;
+}
+
+inline void EnergyCountersStart(EnergyCounters *counters)
+{
+    for(unsigned id = 0; id < N_ENERGY_ZONES; id++)
+    {
+        for(unsigned domain = 0; domain < counters->n_domains[id]; domain++)
+        {
+            if(!ReadPowercapValue(counters->path[id][domain], counters->start[id] + domain)) counters->start[id][domain] = 0;
+        }
+    }
+}
+
+// The counters wrap at max_energy_range_uj, after some minutes under load on big packages; a run shorter than that
+// wraps at most once.
+inline void EnergyCountersStop(EnergyCounters *counters)
+{
+    for(unsigned id = 0; id < N_ENERGY_ZONES; id++)
+    {
+        uint64_t total_uj = 0;
+        for(unsigned domain = 0; domain < counters->n_domains[id]; domain++)
+        {
+            uint64_t end = 0;
+            if(!ReadPowercapValue(counters->path[id][domain], &end)) continue;
+
+            uint64_t start = counters->start[id][domain];
+            total_uj += (end >= start) ? end - start : end + counters->max_range[id][domain] - start;
+        }
+
+        counters->joules[id] = (double)total_uj * 1e-6;
+    }
+}
+
+#endif // ENERGY_H
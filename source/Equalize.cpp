@@ -0,0 +1,199 @@
+#include <immintrin.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Equalize.h"
+
+// Sub-histograms per thread. Neighbouring pixels mostly have the same count, and increments of one bin one after
+// another wait for each other through memory; four copies, one per pixel mod 4, break that chain. They are only used
+// while all of them fit into L2, beyond that the cache misses cost more than the chain.
+const unsigned EQUALIZE_N_SUB     = 4;
+const size_t   EQUALIZE_SUB_LIMIT = 256 * 1024;
+
+const uint32_t EQUALIZE_INTERIOR = 0xFF000000;
+
+struct EqualizeTask
+{
+    const unsigned *counts;
+    uint8_t        *pixels;
+    size_t          n_pixels;
+    unsigned        n_iterations;
+
+    unsigned        n_sub;
+    uint32_t       *histogram;  // n_sub histograms of n_iterations + 1 bins
+    const uint32_t *colors;     // RGBA of every count
+};
+
+static void RunTasks(void *(*function)(void *), EqualizeTask *tasks, unsigned n_threads);
+static void *CountHistogram(void *task_p);
+static void *RemapColors(void *task_p);
+static const uint32_t *Palette(void);
+static bool FillPalette(uint32_t *palette);
+
+void ColorMandelbrotEqualized(uint8_t *pixels, const unsigned *counts, size_t n_pixels, unsigned n_iterations, unsigned n_threads)
+{
+    if(n_threads == 0) n_threads = 1;
+    if(n_threads > EQUALIZE_MAX_THREADS) n_threads = EQUALIZE_MAX_THREADS;
+
+    size_t   n_bins = (size_t)n_iterations + 1;
+    unsigned n_sub  = (n_bins * EQUALIZE_N_SUB * sizeof(uint32_t) <= EQUALIZE_SUB_LIMIT) ? EQUALIZE_N_SUB : 1;
+
+    uint32_t *histograms = (uint32_t *)calloc(n_bins * n_sub * n_threads, sizeof(uint32_t));
+    uint32_t *colors     = (uint32_t *)calloc(n_bins, sizeof(uint32_t));
+
+    // Shares are whole vectors, the last thread takes the rest.
+    EqualizeTask tasks[EQUALIZE_MAX_THREADS] = {};
+    size_t share = (n_pixels / n_threads) & ~(size_t)7;
+    for(unsigned i = 0; i < n_threads; i++)
+    {
+        tasks[i].counts       = counts + i * share;
+        tasks[i].pixels       = pixels + 4 * i * share;
+        tasks[i].n_pixels     = (i + 1 < n_threads) ? share : n_pixels - i * share;
+        tasks[i].n_iterations = n_iterations;
+        tasks[i].n_sub        = n_sub;
+        tasks[i].histogram    = histograms + i * n_sub * n_bins;
+        tasks[i].colors       = colors;
+    }
+
+    RunTasks(CountHistogram, tasks, n_threads);
+
+    // Every escaped count goes to the palette position of the middle of its rank range, so a count that covers half of
+    // the frame lands in the middle of the palette instead of at one end.
+    for(size_t sub = 1; sub < (size_t)n_sub * n_threads; sub++)
+    {
+        for(size_t bin = 0; bin < n_bins; bin++) histograms[bin] += histograms[sub * n_bins + bin];
+    }
+
+    const uint32_t *palette = Palette();
+
+    uint64_t n_escaped = n_pixels - histograms[n_iterations];
+    uint64_t rank      = 0;
+    for(size_t bin = 0; bin < n_iterations; bin++)
+    {
+        uint64_t middle = 2 * rank + histograms[bin];
+        colors[bin] = palette[(n_escaped > 0) ? middle * (EQUALIZE_PALETTE_SIZE - 1) / (2 * n_escaped) : 0];
+
+        rank += histograms[bin];
+    }
+    colors[n_iterations] = EQUALIZE_INTERIOR;
+
+    RunTasks(RemapColors, tasks, n_threads);
+
+    free(colors);
+    free(histograms);
+}
+
+// One thread needs no thread: the caller runs the task itself.
+static void RunTasks(void *(*function)(void *), EqualizeTask *tasks, unsigned n_threads)
+{
+    if(n_threads == 1)
+    {
+        function(tasks);
+        return;
+    }
+
+    pthread_t threads[EQUALIZE_MAX_THREADS] = {};
+    for(unsigned i = 0; i < n_threads; i++) pthread_create(threads + i, NULL, function, tasks + i);
+    for(unsigned i = 0; i < n_threads; i++) pthread_join(threads[i], NULL);
+}
+
+// Vectors of 8 equal counts, the interior and the flat bands far from the set, are one increment by 8. Counts above
+// n_iterations are clamped, so a damaged buffer cannot write outside the histogram.
+static void *CountHistogram(void *task_p)
+{
+    EqualizeTask *task = (EqualizeTask *)task_p;
+
+    size_t    n_bins = (size_t)task->n_iterations + 1;
+    uint32_t *sub[EQUALIZE_N_SUB] = {};
+    for(unsigned i = 0; i < EQUALIZE_N_SUB; i++) sub[i] = task->histogram + (i % task->n_sub) * n_bins;
+
+    const __m256i N_ITERATIONS_V = _mm256_set1_epi32(task->n_iterations);
+
+    size_t n_vectors = task->n_pixels & ~(size_t)7;
+    for(size_t pix = 0; pix < n_vectors; pix += 8)
+    {
+        __m256i n     = _mm256_min_epu32(_mm256_loadu_si256((const __m256i *)(task->counts + pix)), N_ITERATIONS_V);
+        __m256i first = _mm256_permutevar8x32_epi32(n, _mm256_setzero_si256());
+
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(n, first)) == -1)
+        {
+            sub[0][_mm256_cvtsi256_si32(n)] += 8;
+            continue;
+        }
+
+        unsigned lanes[8] = {};
+        _mm256_storeu_si256((__m256i *)lanes, n);
+
+        sub[0][lanes[0]]++;
+        sub[1][lanes[1]]++;
+        sub[2][lanes[2]]++;
+        sub[3][lanes[3]]++;
+        sub[0][lanes[4]]++;
+        sub[1][lanes[5]]++;
+        sub[2][lanes[6]]++;
+        sub[3][lanes[7]]++;
+    }
+
+    for(size_t pix = n_vectors; pix < task->n_pixels; pix++)
+    {
+        unsigned count = task->counts[pix];
+        sub[0][(count < task->n_iterations) ? count : task->n_iterations]++;
+    }
+
+    return NULL;
+}
+
+static void *RemapColors(void *task_p)
+{
+    EqualizeTask *task = (EqualizeTask *)task_p;
+
+    const __m256i N_ITERATIONS_V = _mm256_set1_epi32(task->n_iterations);
+
+    size_t n_vectors = task->n_pixels & ~(size_t)7;
+    for(size_t pix = 0; pix < n_vectors; pix += 8)
+    {
+        __m256i n = _mm256_min_epu32(_mm256_loadu_si256((const __m256i *)(task->counts + pix)), N_ITERATIONS_V);
+        _mm256_storeu_si256((__m256i *)(task->pixels + 4 * pix), _mm256_i32gather_epi32((const int *)task->colors, n, 4));
+    }
+
+    for(size_t pix = n_vectors; pix < task->n_pixels; pix++)
+    {
+        unsigned count = task->counts[pix];
+        memcpy(task->pixels + 4 * pix, task->colors + ((count < task->n_iterations) ? count : task->n_iterations), sizeof(uint32_t));
+    }
+
+    return NULL;
+}
+
+static const uint32_t *Palette(void)
+{
+    static uint32_t   palette[EQUALIZE_PALETTE_SIZE] = {};
+    static const bool filled = FillPalette(palette);
+
+    (void)filled;
+    return palette;
+}
+
+// Cosine gradient from dark blue over white to orange: 0.5 + 0.5 cos(2 pi (0.85 t + phase)) per channel, RGBA bytes.
+static bool FillPalette(uint32_t *palette)
+{
+    const float PHASES[3] = {0.5f, 0.6f, 0.7f};
+
+    for(unsigned i = 0; i < EQUALIZE_PALETTE_SIZE; i++)
+    {
+        float t = 0.85f * i / (EQUALIZE_PALETTE_SIZE - 1);
+
+        uint32_t color = EQUALIZE_INTERIOR;
+        for(unsigned channel = 0; channel < 3; channel++)
+        {
+            float value = 0.5f + 0.5f * cosf(2 * (float)M_PI * (t + PHASES[channel]));
+            color |= (uint32_t)lrintf(255 * value) << (8 * channel);
+        }
+
+        palette[i] = color;
+    }
+
+    return true;
+}
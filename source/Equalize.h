@@ -0,0 +1,21 @@
+#ifndef EQUALIZE_H
+#define EQUALIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Histogram-equalized coloring of escape counts. The plain coloring spends a fixed share of the palette on every count,
+// so when the counts of a view cluster in a narrow band, as they do in any deep zoom, most of the picture gets a few
+// colors. Here the palette position of a count is its rank among the escaped pixels of the frame: every color covers
+// about the same area. Pixels that reached n_iterations are black.
+//
+// Both passes run on n_threads threads, each on its own share of the buffer: first every thread counts its share into
+// private sub-histograms, then the histograms are summed and turned into a table of colors per count, and the threads
+// fill their share of pixels from it with AVX2 gathers.
+
+const unsigned EQUALIZE_PALETTE_SIZE = 1024;
+const unsigned EQUALIZE_MAX_THREADS  = 64;
+
+void ColorMandelbrotEqualized(uint8_t *pixels, const unsigned *counts, size_t n_pixels, unsigned n_iterations, unsigned n_threads);
+
+#endif // EQUALIZE_H
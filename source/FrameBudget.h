@@ -0,0 +1,188 @@
+#ifndef FRAME_BUDGET_H
+#define FRAME_BUDGET_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Frame-time budget of the interactive viewers. After every frame the escape counts it rendered and the time it took
+// predict the cost of the next frame at any resolution and iteration cap, and the budget picks the best quality that
+// fits: full resolution is given up first (1/2, 1/4, 1/8 of the window in each direction), the iteration cap only when
+// even 1/8 does not fit. The prediction assumes the next view looks like the last one, which holds while panning; after
+// a jump the next measurement corrects it. Costs are planned with the worse of the smoothed and the last measurement,
+// and the plan shrinks by the worst recent ratio of measured to predicted frame time, so a slower frame is not followed
+// by one planned on the faster past.
+
+const unsigned BUDGET_N_SCALES                = 4;
+const unsigned BUDGET_SCALES[BUDGET_N_SCALES] = {1, 2, 4, 8};
+
+const unsigned BUDGET_MIN_ITERATIONS = 64;
+const double   BUDGET_TARGET         = 0.8;  // part of the budget the next frame is planned for
+const double   BUDGET_SMOOTHING      = 0.5;  // weight of the newest frame in the measured costs
+const double   BUDGET_ERROR_DECAY    = 0.95; // per frame, of the part of the prediction error above 1
+const double   BUDGET_IDLE_MS        = 250;  // input pause after which the viewer renders at full quality
+
+struct FrameBudget
+{
+    double   budget_ms;
+    unsigned max_iterations;
+    unsigned lanes;            // pixels per vector of the kernel, a vector iterates as long as its slowest lane
+
+    unsigned scale;            // the next frame is rendered at 1/scale of the window resolution
+    unsigned n_iterations;     // with this iteration cap
+
+    double ns_per_iteration;   // time of one vector iteration, 0 until the first frame is measured
+    double overhead_ms;        // the rest of the frame: coloring, texture upload, drawing
+    double last_ns_per_iteration;
+    double last_overhead_ms;
+
+    double   planned_ms;       // predicted time of the planned frame, 0 if there is no plan
+    unsigned planned_width;
+    unsigned planned_height;
+    double   error;            // worst recent measured / predicted frame time, at least 1
+
+    unsigned last_iterations;  // iteration cap of the measured frame
+    size_t   last_vectors;
+    size_t  *histogram;        // vectors of the measured frame by iterations of their slowest lane
+};
+
+inline void FrameBudgetInit(FrameBudget *budget, double budget_ms, unsigned max_iterations, unsigned lanes);
+inline void FrameBudgetFree(FrameBudget *budget);
+
+inline void   FrameBudgetUpdate(FrameBudget *budget, const unsigned *counts, unsigned width, unsigned height, unsigned n_iterations,
+                                double render_ms, double frame_ms);
+inline void   FrameBudgetPlan(FrameBudget *budget, unsigned window_width, unsigned window_height);
+inline double FrameBudgetPredict(const FrameBudget *budget, unsigned window_width, unsigned window_height, unsigned scale, unsigned n_iterations);
+
+inline void FrameBudgetInit(FrameBudget *budget, double budget_ms, unsigned max_iterations, unsigned lanes)
+{
+    memset(budget, 0, sizeof(FrameBudget));
+
+    budget->budget_ms      = budget_ms;
+    budget->max_iterations = max_iterations;
+    budget->lanes          = lanes;
+
+    budget->scale        = 1;
+    budget->n_iterations = max_iterations;
+    budget->error        = 1;
+
+    budget->histogram = (size_t *)calloc(max_iterations + 1, sizeof(size_t));
+}
+
+inline void FrameBudgetFree(FrameBudget *budget)
+{
+    free(budget->histogram);
+    budget->histogram = NULL;
+}
+
+// Takes the counts of a frame rendered at width x height with n_iterations, the time of the kernel alone and of the
+// whole frame. A frame rendered as planned also updates the prediction error; refined full-quality frames do not.
+inline void FrameBudgetUpdate(FrameBudget *budget, const unsigned *counts, unsigned width, unsigned height, unsigned n_iterations,
+                              double render_ms, double frame_ms)
+{
+    unsigned cap = (n_iterations < budget->max_iterations) ? n_iterations : budget->max_iterations;
+
+    memset(budget->histogram, 0, (budget->max_iterations + 1) * sizeof(size_t));
+
+    size_t n_vectors  = 0;
+    double iterations = 0;
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        const unsigned *row = counts + (size_t)y_pos * width;
+        for(unsigned x_pos = 0; x_pos < width; x_pos += budget->lanes)
+        {
+            unsigned slowest = 0;
+            for(unsigned lane = x_pos; lane < x_pos + budget->lanes && lane < width; lane++)
+            {
+                if(row[lane] > slowest) slowest = row[lane];
+            }
+            if(slowest > cap) slowest = cap;
+
+            budget->histogram[slowest]++;
+            iterations += slowest;
+            n_vectors++;
+        }
+    }
+
+    budget->last_iterations = cap;
+    budget->last_vectors    = n_vectors;
+
+    double ns_per_iteration = (iterations > 0) ? render_ms * 1e6 / iterations : 0;
+    double overhead_ms      = (frame_ms > render_ms) ? frame_ms - render_ms : 0;
+
+    bool as_planned = (budget->planned_ms > 0 && width == budget->planned_width && height == budget->planned_height &&
+                       n_iterations == budget->n_iterations);
+    if(as_planned)
+    {
+        double error = frame_ms / budget->planned_ms;
+        budget->error = 1 + BUDGET_ERROR_DECAY * (budget->error - 1);
+        if(error > budget->error) budget->error = error;
+    }
+
+    budget->last_ns_per_iteration = ns_per_iteration;
+    budget->last_overhead_ms      = overhead_ms;
+
+    if(budget->ns_per_iteration == 0)
+    {
+        budget->ns_per_iteration = ns_per_iteration;
+        budget->overhead_ms      = overhead_ms;
+    }
+    else
+    {
+        budget->ns_per_iteration += BUDGET_SMOOTHING * (ns_per_iteration - budget->ns_per_iteration);
+        budget->overhead_ms      += BUDGET_SMOOTHING * (overhead_ms      - budget->overhead_ms);
+    }
+}
+
+// Predicted time of a frame from the last measured one. Vectors that hit the last cap are assumed to run to the new one.
+// Each cost is the worse of its smoothed and its last value.
+inline double FrameBudgetPredict(const FrameBudget *budget, unsigned window_width, unsigned window_height, unsigned scale, unsigned n_iterations)
+{
+    if(budget->last_vectors == 0) return 0;
+
+    double iterations = 0;
+    for(unsigned count = 0; count <= budget->last_iterations; count++)
+    {
+        if(budget->histogram[count] == 0) continue;
+
+        unsigned cost = (count == budget->last_iterations || count > n_iterations) ? n_iterations : count;
+        iterations += (double)cost * budget->histogram[count];
+    }
+
+    unsigned width  = (window_width  + scale - 1) / scale;
+    unsigned height = (window_height + scale - 1) / scale;
+    double n_vectors = (double)((width + budget->lanes - 1) / budget->lanes) * height;
+
+    double ns_per_iteration = (budget->last_ns_per_iteration > budget->ns_per_iteration) ? budget->last_ns_per_iteration : budget->ns_per_iteration;
+    double overhead_ms      = (budget->last_overhead_ms      > budget->overhead_ms)      ? budget->last_overhead_ms      : budget->overhead_ms;
+
+    return overhead_ms + iterations / budget->last_vectors * n_vectors * ns_per_iteration * 1e-6;
+}
+
+inline void FrameBudgetPlan(FrameBudget *budget, unsigned window_width, unsigned window_height)
+{
+    double target_ms = budget->budget_ms * BUDGET_TARGET / budget->error;
+
+    bool fits = false;
+    for(unsigned i = 0; i < BUDGET_N_SCALES && !fits; i++)
+    {
+        budget->scale        = BUDGET_SCALES[i];
+        budget->n_iterations = budget->max_iterations;
+        budget->planned_ms   = FrameBudgetPredict(budget, window_width, window_height, budget->scale, budget->n_iterations);
+
+        fits = (budget->planned_ms <= target_ms);
+    }
+
+    while(!fits && budget->n_iterations > BUDGET_MIN_ITERATIONS)
+    {
+        budget->n_iterations = budget->n_iterations * 3 / 4;
+        if(budget->n_iterations < BUDGET_MIN_ITERATIONS) budget->n_iterations = BUDGET_MIN_ITERATIONS;
+        budget->planned_ms = FrameBudgetPredict(budget, window_width, window_height, budget->scale, budget->n_iterations);
+
+        fits = (budget->planned_ms <= target_ms);
+    }
+
+    budget->planned_width  = (window_width  + budget->scale - 1) / budget->scale;
+    budget->planned_height = (window_height + budget->scale - 1) / budget->scale;
+}
+
+#endif // FRAME_BUDGET_H
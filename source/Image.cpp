@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Image.h"
+
+const uint32_t PNG_STORED_BLOCK = 65535;
+
+static inline void WritePNGChunk(FILE *stream, const char *type, const uint8_t *data, uint32_t size);
+static inline void WriteBigEndian(uint8_t *bytes, uint32_t value);
+static inline uint32_t UpdateCRC32(uint32_t crc, const uint8_t *data, size_t size);
+
+void WritePPM(FILE *stream, const uint8_t *pixels, unsigned width, unsigned height)
+{
+    uint8_t *row = (uint8_t *)calloc(width, 3 * sizeof(uint8_t));
+
+    fprintf(stream, "P6\n%u %u\n255\n", width, height);
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        const uint8_t *rgba = pixels + 4 * (size_t)y_pos * width;
+        for(unsigned x_pos = 0; x_pos < width; x_pos++)
+        {
+            memcpy(row + 3 * x_pos, rgba + 4 * x_pos, 3);
+        }
+        fwrite(row, 3 * sizeof(uint8_t), width, stream);
+    }
+
+    free(row);
+}
+
+// RGBA PNG with the image data in stored (uncompressed) deflate blocks: no zlib needed, and a render node spends its
+// time on rendering rather than compression. Files are about as large as PPM with alpha.
+void WritePNG(FILE *stream, const uint8_t *pixels, unsigned width, unsigned height)
+{
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(SIGNATURE, 1, sizeof(SIGNATURE), stream);
+
+    uint8_t header[13] = {};
+    WriteBigEndian(header + 0, width);
+    WriteBigEndian(header + 4, height);
+    header[8] = 8; // bits per channel
+    header[9] = 6; // RGBA
+    WritePNGChunk(stream, "IHDR", header, sizeof(header));
+
+    // Every row starts with filter type 0 (none).
+    size_t   row_size = 1 + 4 * (size_t)width;
+    size_t   raw_size = row_size * height;
+    uint8_t *raw      = (uint8_t *)calloc(raw_size, 1);
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        memcpy(raw + y_pos * row_size + 1, pixels + 4 * (size_t)y_pos * width, 4 * (size_t)width);
+    }
+
+    size_t   n_blocks  = (raw_size + PNG_STORED_BLOCK - 1) / PNG_STORED_BLOCK;
+    size_t   zlib_size = 2 + 5 * n_blocks + raw_size + 4;
+    uint8_t *zlib      = (uint8_t *)calloc(zlib_size, 1);
+
+    uint8_t *zlib_p = zlib;
+    *(zlib_p++) = 0x78; // deflate, 32K window
+    *(zlib_p++) = 0x01; // no preset dictionary, fastest, header % 31 == 0
+
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+    for(size_t block = 0; block < n_blocks; block++)
+    {
+        size_t   offset = block * PNG_STORED_BLOCK;
+        uint32_t size   = (uint32_t)((raw_size - offset < PNG_STORED_BLOCK) ? raw_size - offset : PNG_STORED_BLOCK);
+
+        *(zlib_p++) = (block + 1 == n_blocks) ? 1 : 0;
+        *(zlib_p++) = size & 0xFF;
+        *(zlib_p++) = size >> 8;
+        *(zlib_p++) = ~size & 0xFF;
+        *(zlib_p++) = (~size >> 8) & 0xFF;
+
+        memcpy(zlib_p, raw + offset, size);
+        zlib_p += size;
+
+        for(uint32_t i = 0; i < size; i++)
+        {
+            adler_a = (adler_a + raw[offset + i]) % 65521;
+            adler_b = (adler_b + adler_a)         % 65521;
+        }
+    }
+    WriteBigEndian(zlib_p, (adler_b << 16) | adler_a);
+
+    WritePNGChunk(stream, "IDAT", zlib, (uint32_t)zlib_size);
+    WritePNGChunk(stream, "IEND", NULL, 0);
+
+    free(zlib);
+    free(raw);
+}
+
+void WriteCounts(FILE *stream, const unsigned *counts, unsigned width, unsigned height)
+{
+    fwrite(counts, sizeof(unsigned), (size_t)width * height, stream);
+}
+
+static inline void WritePNGChunk(FILE *stream, const char *type, const uint8_t *data, uint32_t size)
+{
+    uint8_t length[4] = {};
+    WriteBigEndian(length, size);
+
+    uint32_t crc = UpdateCRC32(0xFFFFFFFF, (const uint8_t *)type, 4);
+    crc = UpdateCRC32(crc, data, size) ^ 0xFFFFFFFF;
+
+    uint8_t crc_bytes[4] = {};
+    WriteBigEndian(crc_bytes, crc);
+
+    fwrite(length, 1, 4, stream);
+    fwrite(type,   1, 4, stream);
+    if(size) fwrite(data, 1, size, stream);
+    fwrite(crc_bytes, 1, 4, stream);
+}
+
+static inline void WriteBigEndian(uint8_t *bytes, uint32_t value)
+{
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+}
+
+static inline uint32_t UpdateCRC32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    static uint32_t table[256] = {};
+    static bool     table_set  = false;
+
+    if(!table_set)
+    {
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            for(unsigned bit = 0; bit < 8; bit++)
+            {
+                value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        table_set = true;
+    }
+
+    for(size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
@@ -0,0 +1,14 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Writers for rendered buffers: pixels are RGBA and counts are escape counts, both width * height values row after
+// row. Streams may be files, pipes or memory streams (open_memstream).
+
+void WritePPM(FILE *stream, const uint8_t *pixels, unsigned width, unsigned height);
+void WritePNG(FILE *stream, const uint8_t *pixels, unsigned width, unsigned height);
+void WriteCounts(FILE *stream, const unsigned *counts, unsigned width, unsigned height);
+
+#endif // IMAGE_H
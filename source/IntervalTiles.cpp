@@ -0,0 +1,286 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "IntervalTiles.h"
+#include "Mandelbrot.h"
+
+// Padding of every step relative to its largest value: a few roundings of half an ulp.
+const double INTERVAL_EPSILON = 4 * DBL_EPSILON;
+
+const unsigned INTERVAL_UNDECIDED = (unsigned)-1;
+
+struct Interval
+{
+    double low;
+    double high;
+};
+
+struct Rect
+{
+    unsigned x;
+    unsigned y;
+    unsigned width;
+    unsigned height;
+};
+
+template<typename REAL>
+struct TileWork
+{
+    unsigned   *counts;
+    unsigned    width;
+    const REAL *x_grid;  // x of every column and y of every row
+    const REAL *y_grid;
+    unsigned    n_iterations;
+
+    REAL   *x;          // undecided pixels of the current tile
+    REAL   *y;
+    size_t *positions;
+    size_t  n_points;
+
+    size_t n_proven;    // pixels filled from proofs
+};
+
+template<typename REAL>
+static size_t RenderTiles(unsigned *counts, unsigned width, unsigned height, REAL x_rend, REAL y_rend, REAL delta, unsigned n_iterations);
+template<typename REAL>
+static bool FillIfProven(TileWork<REAL> *work, Rect rect);
+template<typename REAL>
+static void SplitRect(TileWork<REAL> *work, Rect rect);
+template<typename REAL>
+static void AddPoints(TileWork<REAL> *work, Rect rect);
+static unsigned ProveTile(Interval c_x, Interval c_y, unsigned n_iterations);
+static inline Interval Square(Interval a);
+static inline Interval Multiply(Interval a, Interval b);
+static inline bool Contains(Interval outer, Interval inner);
+
+size_t RenderMandelbrotIntervalCounts(unsigned *counts, unsigned width, unsigned height, float x_rend, float y_rend, float delta,
+                                      unsigned n_iterations)
+{
+    return RenderTiles<float>(counts, width, height, x_rend, y_rend, delta, n_iterations);
+}
+
+size_t RenderMandelbrotIntervalCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta,
+                                      unsigned n_iterations)
+{
+    return RenderTiles<double>(counts, width, height, x_rend, y_rend, delta, n_iterations);
+}
+
+// The coordinates are those of the grid kernels to the last bit, so that the pixels the proof leaves to
+// RenderMandelbrotPoints get the same counts as from RenderMandelbrotCounts, and the rectangle a proof is run on holds
+// exactly the points of its pixels.
+template<typename REAL>
+static size_t RenderTiles(unsigned *counts, unsigned width, unsigned height, REAL x_rend, REAL y_rend, REAL delta, unsigned n_iterations)
+{
+    REAL *x_grid = (REAL *)calloc(width,  sizeof(REAL));
+    REAL *y_grid = (REAL *)calloc(height, sizeof(REAL));
+
+    GridCoordinates(x_grid, y_grid, width, height, x_rend, y_rend, delta);
+
+    TileWork<REAL> work = {counts, width, x_grid, y_grid, n_iterations};
+    work.x         = (REAL   *)calloc(INTERVAL_TILE * INTERVAL_TILE, sizeof(REAL));
+    work.y         = (REAL   *)calloc(INTERVAL_TILE * INTERVAL_TILE, sizeof(REAL));
+    work.positions = (size_t *)calloc(INTERVAL_TILE * INTERVAL_TILE, sizeof(size_t));
+
+    unsigned *point_counts = (unsigned *)calloc(INTERVAL_TILE * INTERVAL_TILE, sizeof(unsigned));
+
+    for(unsigned tile_y = 0; tile_y < height; tile_y += INTERVAL_TILE)
+    {
+        unsigned tile_height = (height - tile_y < INTERVAL_TILE) ? height - tile_y : INTERVAL_TILE;
+
+        for(unsigned tile_x = 0; tile_x < width; tile_x += INTERVAL_TILE)
+        {
+            unsigned tile_width = (width - tile_x < INTERVAL_TILE) ? width - tile_x : INTERVAL_TILE;
+
+            Rect tile = {tile_x, tile_y, tile_width, tile_height};
+            if(FillIfProven(&work, tile)) continue;
+
+            work.n_points = 0;
+            SplitRect(&work, tile);
+            if(work.n_points == 0) continue;
+
+            RenderMandelbrotPoints(point_counts, NULL, work.x, work.y, work.n_points, n_iterations);
+            for(size_t point = 0; point < work.n_points; point++) counts[work.positions[point]] = point_counts[point];
+        }
+    }
+
+    free(point_counts);
+    free(work.positions);
+    free(work.y);
+    free(work.x);
+    free(y_grid);
+    free(x_grid);
+
+    return work.n_proven;
+}
+
+// Fills the rectangle if the proof holds for it.
+template<typename REAL>
+static bool FillIfProven(TileWork<REAL> *work, Rect rect)
+{
+    // Rounded coordinates need not grow with the pixel number, the ends of the rectangle are searched for.
+    Interval c_x = {(double)work->x_grid[rect.x], (double)work->x_grid[rect.x]};
+    Interval c_y = {(double)work->y_grid[rect.y], (double)work->y_grid[rect.y]};
+    for(unsigned column = rect.x + 1; column < rect.x + rect.width; column++)
+    {
+        if(work->x_grid[column] < c_x.low)  c_x.low  = work->x_grid[column];
+        if(work->x_grid[column] > c_x.high) c_x.high = work->x_grid[column];
+    }
+    for(unsigned row = rect.y + 1; row < rect.y + rect.height; row++)
+    {
+        if(work->y_grid[row] < c_y.low)  c_y.low  = work->y_grid[row];
+        if(work->y_grid[row] > c_y.high) c_y.high = work->y_grid[row];
+    }
+
+    unsigned count = ProveTile(c_x, c_y, work->n_iterations);
+    if(count == INTERVAL_UNDECIDED) return false;
+
+    for(unsigned row = rect.y; row < rect.y + rect.height; row++)
+    {
+        unsigned *counts_p = work->counts + (size_t)row * work->width + rect.x;
+        for(unsigned column = 0; column < rect.width; column++) counts_p[column] = count;
+    }
+
+    work->n_proven += (size_t)rect.width * rect.height;
+    return true;
+}
+
+// A rectangle the proof failed on is tried in quarters down to INTERVAL_MIN_TILE. Only quarters with a proven sibling
+// are split again: where none of the four holds, the boundary runs all over the rectangle and smaller proofs would
+// fail as well, at a cost that adds up to several percent of the kernel.
+template<typename REAL>
+static void SplitRect(TileWork<REAL> *work, Rect rect)
+{
+    if(rect.width <= INTERVAL_MIN_TILE && rect.height <= INTERVAL_MIN_TILE)
+    {
+        AddPoints(work, rect);
+        return;
+    }
+
+    unsigned left_width = (rect.width  > INTERVAL_MIN_TILE) ? rect.width  / 2 : rect.width;
+    unsigned top_height = (rect.height > INTERVAL_MIN_TILE) ? rect.height / 2 : rect.height;
+
+    Rect     quarters[4] = {};
+    unsigned n_quarters  = 0;
+    for(unsigned top = 0; top < 2; top++)
+    {
+        for(unsigned left = 0; left < 2; left++)
+        {
+            Rect quarter = {rect.x + left * left_width, rect.y + top * top_height,
+                            left ? rect.width - left_width : left_width, top ? rect.height - top_height : top_height};
+            if(quarter.width > 0 && quarter.height > 0) quarters[n_quarters++] = quarter;
+        }
+    }
+
+    bool proven[4] = {};
+    bool any       = false;
+    for(unsigned i = 0; i < n_quarters; i++)
+    {
+        proven[i] = FillIfProven(work, quarters[i]);
+        any      |= proven[i];
+    }
+
+    for(unsigned i = 0; i < n_quarters; i++)
+    {
+        if(proven[i]) continue;
+
+        if(any) SplitRect(work, quarters[i]);
+        else AddPoints(work, quarters[i]);
+    }
+}
+
+template<typename REAL>
+static void AddPoints(TileWork<REAL> *work, Rect rect)
+{
+    for(unsigned row = rect.y; row < rect.y + rect.height; row++)
+    {
+        for(unsigned column = rect.x; column < rect.x + rect.width; column++)
+        {
+            work->x[work->n_points]         = work->x_grid[column];
+            work->y[work->n_points]         = work->y_grid[row];
+            work->positions[work->n_points] = (size_t)row * work->width + column;
+            work->n_points++;
+        }
+    }
+}
+
+// The count every c of the rectangle gets, or INTERVAL_UNDECIDED. Follows the kernels: z_n counts while |z_n|^2 < 4.
+static unsigned ProveTile(Interval c_x, Interval c_y, unsigned n_iterations)
+{
+    static const double MAX_ZERO_OFFSET2 = MAX_ZERO_OFFSET * MAX_ZERO_OFFSET;
+
+    double c_x_abs = (fabs(c_x.low) > fabs(c_x.high)) ? fabs(c_x.low) : fabs(c_x.high);
+    double c_y_abs = (fabs(c_y.low) > fabs(c_y.high)) ? fabs(c_y.low) : fabs(c_y.high);
+
+    Interval saved_x = {};
+    Interval saved_y = {};
+    unsigned saved_i = 0;
+
+    Interval x_n = {0, 0};
+    Interval y_n = {0, 0};
+    for(unsigned i = 0; i < n_iterations; i++)
+    {
+        Interval x2 = Square(x_n);
+        Interval y2 = Square(y_n);
+
+        // Every operation of the step rounds by at most half an ulp of the largest value in it, so padding by
+        // INTERVAL_EPSILON of that value covers all of them at once.
+        double   r2_pad = INTERVAL_EPSILON * (x2.high + y2.high);
+        Interval r2     = {x2.low + y2.low - r2_pad, x2.high + y2.high + r2_pad};
+
+        if(r2.low >= MAX_ZERO_OFFSET2) return i;
+        if(r2.high >= MAX_ZERO_OFFSET2) return INTERVAL_UNDECIDED;
+
+        // If z_i lies in the interval of an earlier z_s, every later one lies in one of z_s ... z_i-1, which all stayed
+        // inside. Only the intervals at powers of 2 are kept, as in Brent's cycle search: a cycle of any period p is
+        // found by the first saved s >= p past the transient, at one comparison per iteration.
+        if(i > 0 && Contains(saved_x, x_n) && Contains(saved_y, y_n)) return n_iterations;
+        if(i >= 2 * saved_i)
+        {
+            saved_x = x_n;
+            saved_y = y_n;
+            saved_i = i;
+        }
+
+        Interval xy = Multiply(x_n, y_n);
+
+        double x_pad = INTERVAL_EPSILON * (r2.high + c_x_abs) + DBL_MIN;
+        double y_pad = INTERVAL_EPSILON * (2 * ((-xy.low > xy.high) ? -xy.low : xy.high) + c_y_abs) + DBL_MIN;
+
+        x_n = {x2.low - y2.high + c_x.low - x_pad, x2.high - y2.low + c_x.high + x_pad};
+        y_n = {2 * xy.low + c_y.low - y_pad,       2 * xy.high + c_y.high + y_pad};
+    }
+
+    return n_iterations;
+}
+
+// Unpadded, the caller pads the step as a whole.
+static inline Interval Square(Interval a)
+{
+    double low2  = a.low  * a.low;
+    double high2 = a.high * a.high;
+
+    double low  = (a.low > 0) ? low2 : ((a.high < 0) ? high2 : 0);
+    double high = (low2 > high2) ? low2 : high2;
+    return {low, high};
+}
+
+static inline Interval Multiply(Interval a, Interval b)
+{
+    double p1 = a.low  * b.low;
+    double p2 = a.low  * b.high;
+    double p3 = a.high * b.low;
+    double p4 = a.high * b.high;
+
+    double low12  = (p1 < p2) ? p1 : p2;
+    double low34  = (p3 < p4) ? p3 : p4;
+    double high12 = (p1 > p2) ? p1 : p2;
+    double high34 = (p3 > p4) ? p3 : p4;
+
+    return {(low12 < low34) ? low12 : low34, (high12 > high34) ? high12 : high34};
+}
+
+static inline bool Contains(Interval outer, Interval inner)
+{
+    return outer.low <= inner.low && inner.high <= outer.high;
+}
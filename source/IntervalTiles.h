@@ -0,0 +1,28 @@
+#ifndef INTERVAL_TILES_H
+#define INTERVAL_TILES_H
+
+#include <stddef.h>
+
+// Escape counts like RenderMandelbrotCounts, without mirroring, but tile by tile with a proof first. The whole
+// rectangle of c a tile covers is iterated once as an interval: z_n+1 = z_n^2 + c on intervals of x and y holds every
+// orbit of the tile. When the bounds of |z_n|^2 show that all of them escape on the same iteration, or that none
+// escapes within n_iterations, the tile is filled with that count without touching its pixels. None escapes when every
+// bound stays below the escape radius, or earlier, when the interval of some z_n lies inside the one of z_n-p: from then
+// on the intervals repeat inside the last p ones, so the orbits stay bounded for good. A tile the intervals cannot
+// decide is split into quarters down to INTERVAL_MIN_TILE, and the pixels still undecided, those near the boundary of
+// the set or of an escape band, go to RenderMandelbrotPoints with the coordinates of the grid kernels.
+//
+// The intervals are double for both overloads and are widened by a few ulps on every step, so rounding cannot
+// move a point out of its bounds. A rounding error of the kernel itself can still give a point on the edge of a band
+// another count than the proof, like it does between the float and double kernels.
+
+const unsigned INTERVAL_TILE     = 32;  // tile side in pixels
+const unsigned INTERVAL_MIN_TILE = 8;   // smallest quarter a proof is tried on
+
+// Returns the number of pixels filled from proofs.
+size_t RenderMandelbrotIntervalCounts(unsigned *counts, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta,
+                                      unsigned n_iterations);
+size_t RenderMandelbrotIntervalCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta,
+                                      unsigned n_iterations);
+
+#endif // INTERVAL_TILES_H
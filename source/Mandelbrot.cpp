@@ -0,0 +1,1228 @@
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+
+#include "Mandelbrot.h"
+
+const float MIRROR_TOLERANCE = 1e-3f;
+const float MIRROR_MAX_SUM   = 1 << 22;
+
+const double MIRROR_TOLERANCE_HIGH = 1e-6;
+const double MIRROR_MAX_SUM_HIGH   = 1 << 30;
+
+// The distance estimate converges as 1/log|z|: lanes keep iterating z and dz/dc after escaping until |z| reaches
+// DISTANCE_BAILOUT, a few more iterations, which makes it several times more accurate than at |z| = 2.
+const float DISTANCE_BAILOUT = 64;
+
+// mu = n + 1 - log2(log2|z_n|) is only continuous in the limit of a large escape radius: at |z| = 2 the bands of n still
+// show as steps of a few percent. The smooth kernels run on to SMOOTH_BAILOUT as the distance estimate does.
+const float SMOOTH_BAILOUT = 64;
+
+template<FractalType FRACTAL, typename REAL_V>
+static inline void StepFractal(REAL_V *x_n, REAL_V *y_n, REAL_V x2, REAL_V y2, REAL_V xy, REAL_V x_c, REAL_V y_c);
+template<FractalType FRACTAL>
+static inline __v8si IterateFractal(__v8sf x_0, __v8sf y_0, __v8sf x_c, __v8sf y_c, unsigned n_iterations);
+template<FractalType FRACTAL>
+static inline __v4di IterateFractal(__v4df x_0, __v4df y_0, __v4df x_c, __v4df y_c, unsigned n_iterations);
+
+template<FractalType FRACTAL>
+static void RenderPixels(uint8_t *pixels, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta, unsigned n_iterations,
+                         double c_x, double c_y);
+template<FractalType FRACTAL>
+static void RenderPixels(uint8_t *pixels, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations,
+                         double c_x, double c_y);
+template<FractalType FRACTAL>
+static void RenderCounts(unsigned *counts, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta, unsigned n_iterations,
+                         double c_x, double c_y, bool mirror);
+template<FractalType FRACTAL>
+static void RenderCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations,
+                         double c_x, double c_y, bool mirror);
+
+static inline bool MirrorsRows(FractalType type, double c_y);
+
+static inline __v8si IterateMandelbrot(__v8sf x_0, __v8sf y_0, unsigned n_iterations);
+static inline __v8si IterateMandelbrotSmooth(__v8sf x_0, __v8sf y_0, unsigned n_iterations, __v8sf *r2_final);
+static inline __v4di IterateMandelbrot(__v4df x_0, __v4df y_0, unsigned n_iterations);
+static inline __v4di IterateMandelbrotSmooth(__v4df x_0, __v4df y_0, unsigned n_iterations, __v4df *r2_final);
+static inline __v8si IterateMandelbrotDistance(__v8sf x_0, __v8sf y_0, unsigned n_iterations, __v8sf *estimate);
+static inline __v4di IterateMandelbrotDistance(__v4df x_0, __v4df y_0, unsigned n_iterations, __m128 *estimate);
+static inline __v8sf DistanceEstimate(__v8sf r2, __v8sf ratio);
+
+static inline __m256i TailMask(size_t n_left);
+static inline __m128i TailMask4(size_t n_left);
+static inline __v8sf TailPosition(__v8sf x_0, __m256i mask);
+static inline __v4df TailPosition(__v4df x_0, __m128i mask);
+static inline __m128i NarrowCounts(__v4di n);
+static inline __m256i PackColor(__m256i n);
+static inline __v8sf FastLog2(__v8sf x);
+static inline __v8sf AbsValue(__v8sf x);
+static inline __v4df AbsValue(__v4df x);
+
+typedef void (*RenderPixelsFloat) (uint8_t *, unsigned, unsigned, float,  float,  float,  unsigned, double, double);
+typedef void (*RenderPixelsDouble)(uint8_t *, unsigned, unsigned, double, double, double, unsigned, double, double);
+typedef void (*RenderCountsFloat) (unsigned *, unsigned, unsigned, float,  float,  float,  unsigned, double, double, bool);
+typedef void (*RenderCountsDouble)(unsigned *, unsigned, unsigned, double, double, double, unsigned, double, double, bool);
+
+// ================================================================================================================================================================================
+// Formulas
+// ================================================================================================================================================================================
+
+const char *FractalName(FractalType type)
+{
+    static const char *NAMES[N_FRACTALS] = {"Mandelbrot", "Julia", "Burning Ship", "Multibrot z^3", "Multibrot z^4"};
+
+    return (type < N_FRACTALS) ? NAMES[type] : "unknown";
+}
+
+// One step (x_n, y_n) <- f(x_n, y_n) + c of the formula, given the squares and the product that the escape test has
+// already computed. Shared by the float and double kernels.
+template<FractalType FRACTAL, typename REAL_V>
+static inline void StepFractal(REAL_V *x_n, REAL_V *y_n, REAL_V x2, REAL_V y2, REAL_V xy, REAL_V x_c, REAL_V y_c)
+{
+    if constexpr(FRACTAL == FRACTAL_MULTIBROT3)
+    {
+        REAL_V x = *x_n;
+        REAL_V y = *y_n;
+
+        *x_n = x * (x2 - 3 * y2) + x_c;
+        *y_n = y * (3 * x2 - y2) + y_c;
+    }
+    else if constexpr(FRACTAL == FRACTAL_MULTIBROT4)
+    {
+        REAL_V x = x2 - y2;
+        REAL_V y = xy + xy;
+        REAL_V p = x * y;
+
+        *x_n = x * x - y * y + x_c;
+        *y_n = p + p + y_c;
+    }
+    else
+    {
+        if constexpr(FRACTAL == FRACTAL_BURNING_SHIP) xy = AbsValue(xy);
+
+        *x_n = x2 - y2 + x_c;
+        *y_n = xy + xy + y_c;
+    }
+}
+
+// All formulas but the Burning Ship commute with conjugation when c is real, Julia sets only have that c.
+static inline bool MirrorsRows(FractalType type, double c_y)
+{
+    return type != FRACTAL_BURNING_SHIP && (type != FRACTAL_JULIA || c_y == 0);
+}
+
+void RenderFractal(uint8_t *pixels, unsigned width, unsigned height, float x_rend, float y_rend, float delta, unsigned n_iterations, Fractal fractal)
+{
+    static const RenderPixelsFloat KERNELS[N_FRACTALS] = {RenderPixels<FRACTAL_MANDELBROT>, RenderPixels<FRACTAL_JULIA>,
+                                                          RenderPixels<FRACTAL_BURNING_SHIP>, RenderPixels<FRACTAL_MULTIBROT3>,
+                                                          RenderPixels<FRACTAL_MULTIBROT4>};
+
+    if(fractal.type < N_FRACTALS) KERNELS[fractal.type](pixels, width, height, x_rend, y_rend, delta, n_iterations, fractal.c_x, fractal.c_y);
+}
+
+void RenderFractal(uint8_t *pixels, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations, Fractal fractal)
+{
+    static const RenderPixelsDouble KERNELS[N_FRACTALS] = {RenderPixels<FRACTAL_MANDELBROT>, RenderPixels<FRACTAL_JULIA>,
+                                                           RenderPixels<FRACTAL_BURNING_SHIP>, RenderPixels<FRACTAL_MULTIBROT3>,
+                                                           RenderPixels<FRACTAL_MULTIBROT4>};
+
+    if(fractal.type < N_FRACTALS) KERNELS[fractal.type](pixels, width, height, x_rend, y_rend, delta, n_iterations, fractal.c_x, fractal.c_y);
+}
+
+void RenderFractalCounts(unsigned *counts, unsigned width, unsigned height, float x_rend, float y_rend, float delta, unsigned n_iterations,
+                         Fractal fractal, bool mirror)
+{
+    static const RenderCountsFloat KERNELS[N_FRACTALS] = {RenderCounts<FRACTAL_MANDELBROT>, RenderCounts<FRACTAL_JULIA>,
+                                                          RenderCounts<FRACTAL_BURNING_SHIP>, RenderCounts<FRACTAL_MULTIBROT3>,
+                                                          RenderCounts<FRACTAL_MULTIBROT4>};
+
+    if(fractal.type < N_FRACTALS) KERNELS[fractal.type](counts, width, height, x_rend, y_rend, delta, n_iterations, fractal.c_x, fractal.c_y, mirror);
+}
+
+void RenderFractalCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations,
+                         Fractal fractal, bool mirror)
+{
+    static const RenderCountsDouble KERNELS[N_FRACTALS] = {RenderCounts<FRACTAL_MANDELBROT>, RenderCounts<FRACTAL_JULIA>,
+                                                           RenderCounts<FRACTAL_BURNING_SHIP>, RenderCounts<FRACTAL_MULTIBROT3>,
+                                                           RenderCounts<FRACTAL_MULTIBROT4>};
+
+    if(fractal.type < N_FRACTALS) KERNELS[fractal.type](counts, width, height, x_rend, y_rend, delta, n_iterations, fractal.c_x, fractal.c_y, mirror);
+}
+
+// ================================================================================================================================================================================
+// [8 x float]
+// ================================================================================================================================================================================
+
+// Escape counts of the pixels (x_0, y_0). c is the pixel itself, except for Julia sets, which start from the pixel and
+// add the fixed (x_c, y_c).
+template<FractalType FRACTAL>
+static inline __v8si IterateFractal(__v8sf x_0, __v8sf y_0, __v8sf x_c, __v8sf y_c, unsigned n_iterations)
+{
+    static const __v8sf MAX_ZERO_OFFSET2_V = _mm256_set1_ps(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+
+    __v8sf x_n = {};
+    __v8sf y_n = {};
+    if constexpr(FRACTAL == FRACTAL_JULIA)
+    {
+        x_n = x_0;
+        y_n = y_0;
+    }
+    else
+    {
+        x_c = x_0;
+        y_c = y_0;
+    }
+
+    __v8si n = {};
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __v8sf x2 = x_n * x_n;
+        __v8sf y2 = y_n * y_n;
+        __v8sf xy = x_n * y_n;
+
+        __v8sf cmp = ((x2 + y2) < MAX_ZERO_OFFSET2_V);
+
+        unsigned mask = _mm256_movemask_ps(cmp);
+        if(mask == 0) break;
+
+        n -= reinterpret_cast<__v8si>(cmp);
+
+        StepFractal<FRACTAL>(&x_n, &y_n, x2, y2, xy, x_c, y_c);
+    }
+
+    return n;
+}
+
+static inline __v8si IterateMandelbrot(__v8sf x_0, __v8sf y_0, unsigned n_iterations)
+{
+    return IterateFractal<FRACTAL_MANDELBROT>(x_0, y_0, x_0, y_0, n_iterations);
+}
+
+// Same iteration, but also gives the |z|^2 that mu = n + 1 - log2(log2|z_n|) needs (the last one for the interior). Lanes
+// run on after escaping until |z| passes SMOOTH_BAILOUT, k iterations later, and their |z|^2 is taken back to the
+// escape as if z had only been squared on the way: k square roots, so that log2(log2|z|) drops by exactly k. Lanes that
+// hit n_iterations before the bailout keep their last |z|^2.
+static inline __v8si IterateMandelbrotSmooth(__v8sf x_0, __v8sf y_0, unsigned n_iterations, __v8sf *r2_final)
+{
+    static const __v8sf MAX_ZERO_OFFSET2_V = _mm256_set1_ps(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+    static const __v8sf BAILOUT2_V         = _mm256_set1_ps(SMOOTH_BAILOUT * SMOOTH_BAILOUT);
+
+    __v8sf x_n = {};
+    __v8sf y_n = {};
+
+    __v8sf r2_n     = {};
+    __v8sf active   = (__v8sf)_mm256_cmp_ps(x_n, x_n, _CMP_EQ_OQ);
+    __v8sf tracking = active;
+
+    __v8si n     = {};
+    __v8si extra = {};
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __v8sf x2 = x_n * x_n;
+        __v8sf y2 = y_n * y_n;
+        __v8sf xy = x_n * y_n;
+
+        __v8sf r2 = x2 + y2;
+        r2_n = _mm256_blendv_ps(r2_n, r2, tracking);
+
+        active   = _mm256_and_ps(active,   (__v8sf)(r2 < MAX_ZERO_OFFSET2_V));
+        tracking = _mm256_and_ps(tracking, (__v8sf)(r2 < BAILOUT2_V));
+
+        unsigned mask = _mm256_movemask_ps(tracking);
+        if(mask == 0) break;
+
+        n     -= reinterpret_cast<__v8si>(active);
+        extra -= reinterpret_cast<__v8si>(_mm256_andnot_ps(active, tracking));
+
+        StepFractal<FRACTAL_MANDELBROT>(&x_n, &y_n, x2, y2, xy, x_0, y_0);
+    }
+
+    extra = (__v8si)_mm256_and_si256((__m256i)extra, (__m256i)(r2_n >= BAILOUT2_V));
+    for(__v8si left = (__v8si)_mm256_cmpgt_epi32((__m256i)extra, _mm256_setzero_si256()); _mm256_movemask_ps((__m256)left);
+        left = (__v8si)_mm256_cmpgt_epi32((__m256i)extra, _mm256_setzero_si256()))
+    {
+        r2_n   = _mm256_blendv_ps(r2_n, _mm256_sqrt_ps(r2_n), (__v8sf)left);
+        extra += left;
+    }
+
+    *r2_final = r2_n;
+    return n;
+}
+
+void RenderMandelbrot(uint8_t *pixels, unsigned width, unsigned height, float x_rend, float y_rend, float delta, unsigned n_iterations)
+{
+    RenderPixels<FRACTAL_MANDELBROT>(pixels, width, height, x_rend, y_rend, delta, n_iterations, 0, 0);
+}
+
+template<FractalType FRACTAL>
+static void RenderPixels(uint8_t *pixels, unsigned width, unsigned height, float x_rend, float y_rend, float delta, unsigned n_iterations,
+                         double c_x, double c_y)
+{
+    static const __v8sf SHIFT_V = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+
+    __v8sf delta_v         = _mm256_set1_ps(delta);
+    __v8sf delta_v_shifted = SHIFT_V * delta_v;
+    __v8sf packed_adj_v    = 8 * delta_v;
+
+    __v8sf x_c = _mm256_set1_ps((float)c_x);
+    __v8sf y_c = _mm256_set1_ps((float)c_y);
+
+    float y_offset   = 0;
+    int   mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!MirrorsRows(FRACTAL, c_y)) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        size_t pix_pos = (size_t)y_pos * width;
+
+        __v8sf y_0 = _mm256_set1_ps((y_offset - y_pos) * delta);
+        __v8sf x_0 = delta_v_shifted + x_rend;
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 8, x_0 += packed_adj_v, pix_pos += 8)
+        {
+            __m256i mask = TailMask(width - x_pos);
+            __v8si  n    = IterateFractal<FRACTAL>(TailPosition(x_0, mask), y_0, x_c, y_c, n_iterations);
+
+            _mm256_maskstore_epi32((int *)(pixels + 4 * pix_pos), mask, PackColor((__m256i)n));
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(pixels + 4 * (size_t)y_pos * width, pixels + 4 * (size_t)source * width, 4 * (size_t)width);
+    }
+}
+
+// Escape counts of the whole screen. Rows below the real axis that mirror already computed ones are copied after all
+// other rows are done, so the rows left to compute may be split between tiles or threads in any order.
+void RenderMandelbrotCounts(unsigned *counts, unsigned width, unsigned height, float x_rend, float y_rend, float delta, unsigned n_iterations, bool mirror)
+{
+    RenderCounts<FRACTAL_MANDELBROT>(counts, width, height, x_rend, y_rend, delta, n_iterations, 0, 0, mirror);
+}
+
+template<FractalType FRACTAL>
+static void RenderCounts(unsigned *counts, unsigned width, unsigned height, float x_rend, float y_rend, float delta, unsigned n_iterations,
+                         double c_x, double c_y, bool mirror)
+{
+    static const __v8sf SHIFT_V = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+
+    __v8sf delta_v         = _mm256_set1_ps(delta);
+    __v8sf delta_v_shifted = SHIFT_V * delta_v;
+    __v8sf packed_adj_v    = 8 * delta_v;
+
+    __v8sf x_c = _mm256_set1_ps((float)c_x);
+    __v8sf y_c = _mm256_set1_ps((float)c_y);
+
+    float y_offset   = 0;
+    int   mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!mirror || !MirrorsRows(FRACTAL, c_y)) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        unsigned *counts_p = counts + (size_t)y_pos * width;
+
+        __v8sf y_0 = _mm256_set1_ps((y_offset - y_pos) * delta);
+        __v8sf x_0 = delta_v_shifted + x_rend;
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 8, x_0 += packed_adj_v, counts_p += 8)
+        {
+            __m256i mask = TailMask(width - x_pos);
+            _mm256_maskstore_epi32((int *)counts_p, mask, (__m256i)IterateFractal<FRACTAL>(TailPosition(x_0, mask), y_0, x_c, y_c, n_iterations));
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(counts + (size_t)y_pos * width, counts + (size_t)source * width, width * sizeof(unsigned));
+    }
+}
+
+void RenderMandelbrotSmooth(uint8_t *pixels, unsigned *counts, float *r2, unsigned width, unsigned height,
+                            float x_rend, float y_rend, float delta, unsigned n_iterations, bool mirror)
+{
+    static const __v8sf SHIFT_V = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+
+    __v8sf delta_v         = _mm256_set1_ps(delta);
+    __v8sf delta_v_shifted = SHIFT_V * delta_v;
+    __v8sf packed_adj_v    = 8 * delta_v;
+
+    float y_offset   = 0;
+    int   mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!mirror) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        size_t pix_pos = (size_t)y_pos * width;
+
+        __v8sf y_0 = _mm256_set1_ps((y_offset - y_pos) * delta);
+        __v8sf x_0 = delta_v_shifted + x_rend;
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 8, x_0 += packed_adj_v, pix_pos += 8)
+        {
+            __m256i mask = TailMask(width - x_pos);
+
+            __v8sf r2_final = {};
+            __v8si n = IterateMandelbrotSmooth(TailPosition(x_0, mask), y_0, n_iterations, &r2_final);
+
+            _mm256_maskstore_epi32((int *)(counts + pix_pos), mask, (__m256i)n);
+            _mm256_maskstore_ps(r2 + pix_pos, mask, r2_final);
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(counts + (size_t)y_pos * width, counts + (size_t)source * width, width * sizeof(unsigned));
+        memcpy(r2     + (size_t)y_pos * width, r2     + (size_t)source * width, width * sizeof(float));
+    }
+
+    ColorMandelbrotSmooth(pixels, counts, r2, (size_t)width * height, n_iterations);
+}
+
+void RenderMandelbrotPoints(unsigned *counts, float *r2, const float *x, const float *y, size_t n_points, unsigned n_iterations)
+{
+    for(size_t pix = 0; pix < n_points; pix += 8)
+    {
+        __m256i mask = TailMask(n_points - pix);
+
+        __v8sf x_0 = TailPosition((__v8sf)_mm256_maskload_ps(x + pix, mask), mask);
+        __v8sf y_0 = (__v8sf)_mm256_maskload_ps(y + pix, mask);
+
+        if(!r2)
+        {
+            _mm256_maskstore_epi32((int *)(counts + pix), mask, (__m256i)IterateMandelbrot(x_0, y_0, n_iterations));
+            continue;
+        }
+
+        __v8sf r2_final = {};
+        __v8si n = IterateMandelbrotSmooth(x_0, y_0, n_iterations, &r2_final);
+
+        _mm256_maskstore_epi32((int *)(counts + pix), mask, (__m256i)n);
+        _mm256_maskstore_ps(r2 + pix, mask, r2_final);
+    }
+}
+
+// The float x step along a row 8 pixels at a time, as x_0 += packed_adj_v does.
+void GridCoordinates(float *x, float *y, unsigned width, unsigned height, float x_rend, float y_rend, float delta)
+{
+    for(unsigned lane = 0; lane < 8; lane++)
+    {
+        float x_0 = (float)lane * delta + x_rend;
+        for(unsigned x_pos = lane; x_pos < width; x_pos += 8, x_0 += 8 * delta) x[x_pos] = x_0;
+    }
+
+    float y_offset = 0;
+    FindMirrorSum(y_rend, delta, &y_offset);
+    for(unsigned y_pos = 0; y_pos < height; y_pos++) y[y_pos] = (y_offset - y_pos) * delta;
+}
+
+// Escape counts as IterateMandelbrot, and the exterior distance estimate |z| ln|z| / |dz/dc| with dz/dc carried along:
+// dz_n+1 = 2 z_n dz_n + 1. |z|^2 and |dz|^2 are kept from the iteration |z| passes DISTANCE_BAILOUT, like r2 in the
+// smooth kernel; z and dz themselves run on and may overflow in the lanes waiting for the rest of the vector, which
+// costs less than blending them, as a blend of z would lengthen the dependency chain of the loop. Lanes still inside
+// the set at the end get garbage, the caller masks it.
+static inline __v8si IterateMandelbrotDistance(__v8sf x_0, __v8sf y_0, unsigned n_iterations, __v8sf *estimate)
+{
+    static const __v8sf MAX_ZERO_OFFSET2_V = _mm256_set1_ps(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+    static const __v8sf BAILOUT2_V         = _mm256_set1_ps(DISTANCE_BAILOUT * DISTANCE_BAILOUT);
+    static const __v8sf ONE_V              = _mm256_set1_ps(1);
+
+    __v8sf x_n  = {};
+    __v8sf y_n  = {};
+    __v8sf dx_n = {};
+    __v8sf dy_n = {};
+
+    __v8sf r2_n  = {};
+    __v8sf dr2_n = {};
+
+    __v8sf active   = (__v8sf)_mm256_cmp_ps(x_n, x_n, _CMP_EQ_OQ);
+    __v8sf tracking = active;
+
+    __v8si n = {};
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __v8sf x2 = x_n * x_n;
+        __v8sf y2 = y_n * y_n;
+        __v8sf xy = x_n * y_n;
+
+        __v8sf r2 = x2 + y2;
+        r2_n  = _mm256_blendv_ps(r2_n,  r2,                        tracking);
+        dr2_n = _mm256_blendv_ps(dr2_n, dx_n * dx_n + dy_n * dy_n, tracking);
+
+        active   = _mm256_and_ps(active,   (__v8sf)(r2 < MAX_ZERO_OFFSET2_V));
+        tracking = _mm256_and_ps(tracking, (__v8sf)(r2 < BAILOUT2_V));
+
+        unsigned mask = _mm256_movemask_ps(tracking);
+        if(mask == 0) break;
+
+        n -= reinterpret_cast<__v8si>(active);
+
+        __v8sf dx = x_n * dx_n - y_n * dy_n;
+        __v8sf dy = x_n * dy_n + y_n * dx_n;
+        dx_n = dx + dx + ONE_V;
+        dy_n = dy + dy;
+
+        StepFractal<FRACTAL_MANDELBROT>(&x_n, &y_n, x2, y2, xy, x_0, y_0);
+    }
+
+    *estimate = DistanceEstimate(r2_n, r2_n / dr2_n);
+    return n;
+}
+
+// Escape counts and the distance of every escaped pixel to the set, in pixels; 0 for the pixels that reached
+// n_iterations. Pixels with a distance below one are the ones that the boundary passes through. pixels may be NULL,
+// otherwise they get ColorMandelbrotDistance.
+void RenderMandelbrotDistance(uint8_t *pixels, unsigned *counts, float *distance, unsigned width, unsigned height,
+                              float x_rend, float y_rend, float delta, unsigned n_iterations, bool mirror)
+{
+    static const __v8sf SHIFT_V = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+
+    __v8sf delta_v         = _mm256_set1_ps(delta);
+    __v8sf delta_v_shifted = SHIFT_V * delta_v;
+    __v8sf packed_adj_v    = 8 * delta_v;
+    __v8sf inv_delta_v     = _mm256_set1_ps(1 / delta);
+
+    const __m256i N_ITERATIONS_V = _mm256_set1_epi32(n_iterations);
+
+    float y_offset   = 0;
+    int   mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!mirror) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        size_t pix_pos = (size_t)y_pos * width;
+
+        __v8sf y_0 = _mm256_set1_ps((y_offset - y_pos) * delta);
+        __v8sf x_0 = delta_v_shifted + x_rend;
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 8, x_0 += packed_adj_v, pix_pos += 8)
+        {
+            __m256i mask = TailMask(width - x_pos);
+
+            __v8sf estimate = {};
+            __v8si n = IterateMandelbrotDistance(TailPosition(x_0, mask), y_0, n_iterations, &estimate);
+
+            __v8sf interior = _mm256_castsi256_ps(_mm256_cmpeq_epi32((__m256i)n, N_ITERATIONS_V));
+            estimate = _mm256_andnot_ps(interior, estimate * inv_delta_v);
+
+            _mm256_maskstore_epi32((int *)(counts + pix_pos), mask, (__m256i)n);
+            _mm256_maskstore_ps(distance + pix_pos, mask, estimate);
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(counts   + (size_t)y_pos * width, counts   + (size_t)source * width, width * sizeof(unsigned));
+        memcpy(distance + (size_t)y_pos * width, distance + (size_t)source * width, width * sizeof(float));
+    }
+
+    if(pixels) ColorMandelbrotDistance(pixels, counts, distance, (size_t)width * height, n_iterations);
+}
+
+// One sample per pixel into counts, then AA_SAMPLES more for every pixel whose escape count differs from one of its
+// neighbours by at least AA_MIN_DIFFERENCE. Sub-samples of all such pixels are packed back to back, so the kernel
+// always gets full vectors whatever the shape of the boundary is. Returns the number of supersampled pixels.
+size_t RenderMandelbrotAA(uint8_t *pixels, unsigned *counts, unsigned *edges, unsigned width, unsigned height,
+                          float x_rend, float y_rend, float delta, unsigned n_iterations)
+{
+    RenderMandelbrotCounts(counts, width, height, x_rend, y_rend, delta, n_iterations, true);
+    ColorMandelbrot(pixels, counts, (size_t)width * height);
+
+    size_t n_edges = FindEdges(counts, edges, width, height);
+
+    // Rows at the coordinates of the first pass, so the sub-samples are centred on the pixels they refine.
+    float y_offset = 0;
+    FindMirrorSum(y_rend, delta, &y_offset);
+
+    float sub_x[AA_SAMPLES] = {};
+    float sub_y[AA_SAMPLES] = {};
+    for(unsigned i = 0; i < AA_SAMPLES; i++)
+    {
+        sub_x[i] = ((i % AA_GRID + 0.5f) / AA_GRID - 0.5f) * delta;
+        sub_y[i] = ((i / AA_GRID + 0.5f) / AA_GRID - 0.5f) * delta;
+    }
+
+    unsigned sum[3] = {};
+
+    size_t n_samples = n_edges * AA_SAMPLES;
+    for(size_t sample = 0; sample < n_samples; sample += 8)
+    {
+        float x_arr[8] = {};
+        float y_arr[8] = {};
+        for(unsigned i = 0; i < 8; i++)
+        {
+            size_t   lane_sample = (sample + i < n_samples) ? sample + i : n_samples - 1;
+            unsigned pix_pos     = edges[lane_sample / AA_SAMPLES];
+            unsigned sub         = lane_sample % AA_SAMPLES;
+
+            x_arr[i] = x_rend + (pix_pos % width) * delta + sub_x[sub];
+            y_arr[i] = (y_offset - pix_pos / width) * delta - sub_y[sub];
+        }
+
+        __v8si n = IterateMandelbrot(_mm256_loadu_ps(x_arr), _mm256_loadu_ps(y_arr), n_iterations);
+
+        unsigned *n_p = (unsigned *)&n;
+        for(unsigned i = 0; i < 8 && sample + i < n_samples; i++)
+        {
+            uint8_t color = *(n_p++);
+            sum[0] += color;
+            sum[1] += color;
+            sum[2] += (uint8_t)(color * 32);
+
+            if((sample + i + 1) % AA_SAMPLES == 0)
+            {
+                size_t edge_arr_pos = 4 * (size_t)edges[(sample + i) / AA_SAMPLES];
+                pixels[edge_arr_pos + 0] = sum[0] / AA_SAMPLES;
+                pixels[edge_arr_pos + 1] = sum[1] / AA_SAMPLES;
+                pixels[edge_arr_pos + 2] = sum[2] / AA_SAMPLES;
+
+                sum[0] = sum[1] = sum[2] = 0;
+            }
+        }
+    }
+
+    return n_edges;
+}
+
+// Writes positions of pixels whose count differs from a 4-neighbour by at least AA_MIN_DIFFERENCE, returns how many.
+size_t FindEdges(const unsigned *counts, unsigned *edges, unsigned width, unsigned height)
+{
+    static const __m256i SHIFT_LEFT_V  = _mm256_set_epi32(6, 5, 4, 3, 2, 1, 0, 0);
+    static const __m256i SHIFT_RIGHT_V = _mm256_set_epi32(8, 7, 6, 5, 4, 3, 2, 1);
+
+    const __m256i MIN_DIFFERENCE_V = _mm256_set1_epi32(AA_MIN_DIFFERENCE - 1);
+
+    size_t n_edges = 0;
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        const unsigned *row = counts + (size_t)y_pos * width;
+        const unsigned *up  = (y_pos == 0)          ? row : row - width;
+        const unsigned *dn  = (y_pos == height - 1) ? row : row + width;
+
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 8)
+        {
+            unsigned n_lanes = (width - x_pos < 8) ? width - x_pos : 8;
+            __m256i  mask    = TailMask(n_lanes);
+
+            __m256i center = _mm256_maskload_epi32((const int *)(row + x_pos), mask);
+
+            // Lanes outside of the row are replaced by the edge pixel itself, so they never count as different.
+            __m256i left  = (x_pos == 0)          ? _mm256_permutevar8x32_epi32(center, SHIFT_LEFT_V)
+                                                  : _mm256_maskload_epi32((const int *)(row + x_pos - 1), mask);
+            __m256i right = (x_pos + 8 >= width)  ? _mm256_permutevar8x32_epi32(center, _mm256_min_epi32(SHIFT_RIGHT_V, _mm256_set1_epi32(n_lanes - 1)))
+                                                  : _mm256_loadu_si256((const __m256i *)(row + x_pos + 1));
+
+            __m256i diff = _mm256_abs_epi32(_mm256_sub_epi32(center, left));
+            diff = _mm256_max_epu32(diff, _mm256_abs_epi32(_mm256_sub_epi32(center, right)));
+            diff = _mm256_max_epu32(diff, _mm256_abs_epi32(_mm256_sub_epi32(center, _mm256_maskload_epi32((const int *)(up + x_pos), mask))));
+            diff = _mm256_max_epu32(diff, _mm256_abs_epi32(_mm256_sub_epi32(center, _mm256_maskload_epi32((const int *)(dn + x_pos), mask))));
+
+            unsigned edge_mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(diff, MIN_DIFFERENCE_V), mask)));
+            while(edge_mask)
+            {
+                unsigned lane = __builtin_ctz(edge_mask);
+                edges[n_edges++] = y_pos * width + x_pos + lane;
+                edge_mask &= edge_mask - 1;
+            }
+        }
+    }
+
+    return n_edges;
+}
+
+// The set is symmetric about the real axis, so when y_rend / delta is a multiple of 1/2, row y_pos samples the mirror image
+// of row mirror_sum - y_pos. Returns mirror_sum, or -1 if rows do not land on symmetric positions. *y_offset gets
+// y_rend / delta, snapped to that multiple of 1/2 in the symmetric case: a row at (y_offset - y_pos) * delta then gets
+// exactly the opposite y of its mirror, and so exactly the same escape counts. The snap moves the whole view by up to
+// MIRROR_TOLERANCE / 2 of a pixel, whether rows are mirrored or not.
+int FindMirrorSum(float y_rend, float delta, float *y_offset)
+{
+    float offset = y_rend / delta;
+    float sum    = roundf(2 * offset);
+
+    *y_offset = offset;
+    if(fabsf(2 * offset - sum) > MIRROR_TOLERANCE || fabsf(sum) >= MIRROR_MAX_SUM) return -1;
+
+    *y_offset = sum / 2;
+    return (int)sum;
+}
+
+// Row to copy y_pos from, or -1 if y_pos has to be computed. Of each mirrored pair the upper row is computed.
+int MirrorSource(unsigned y_pos, int mirror_sum)
+{
+    if(mirror_sum < 0) return -1;
+
+    int source = mirror_sum - (int)y_pos;
+    return (source >= 0 && source < (int)y_pos) ? source : -1;
+}
+
+// ================================================================================================================================================================================
+// [4 x double]
+// ================================================================================================================================================================================
+
+template<FractalType FRACTAL>
+static inline __v4di IterateFractal(__v4df x_0, __v4df y_0, __v4df x_c, __v4df y_c, unsigned n_iterations)
+{
+    static const __v4df MAX_ZERO_OFFSET2_V = _mm256_set1_pd(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+
+    __v4df x_n = {};
+    __v4df y_n = {};
+    if constexpr(FRACTAL == FRACTAL_JULIA)
+    {
+        x_n = x_0;
+        y_n = y_0;
+    }
+    else
+    {
+        x_c = x_0;
+        y_c = y_0;
+    }
+
+    __v4di n = {};
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __v4df x2 = x_n * x_n;
+        __v4df y2 = y_n * y_n;
+        __v4df xy = x_n * y_n;
+
+        __v4df cmp = ((x2 + y2) < MAX_ZERO_OFFSET2_V);
+
+        unsigned mask = _mm256_movemask_pd(cmp);
+        if(mask == 0) break;
+
+        n -= reinterpret_cast<__v4di>(cmp);
+
+        StepFractal<FRACTAL>(&x_n, &y_n, x2, y2, xy, x_c, y_c);
+    }
+
+    return n;
+}
+
+static inline __v4di IterateMandelbrot(__v4df x_0, __v4df y_0, unsigned n_iterations)
+{
+    return IterateFractal<FRACTAL_MANDELBROT>(x_0, y_0, x_0, y_0, n_iterations);
+}
+
+// As the [8 x float] one.
+static inline __v4di IterateMandelbrotSmooth(__v4df x_0, __v4df y_0, unsigned n_iterations, __v4df *r2_final)
+{
+    static const __v4df MAX_ZERO_OFFSET2_V = _mm256_set1_pd(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+    static const __v4df BAILOUT2_V         = _mm256_set1_pd(SMOOTH_BAILOUT * SMOOTH_BAILOUT);
+
+    __v4df x_n = {};
+    __v4df y_n = {};
+
+    __v4df r2_n     = {};
+    __v4df active   = (__v4df)_mm256_cmp_pd(x_n, x_n, _CMP_EQ_OQ);
+    __v4df tracking = active;
+
+    __v4di n     = {};
+    __v4di extra = {};
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __v4df x2 = x_n * x_n;
+        __v4df y2 = y_n * y_n;
+        __v4df xy = x_n * y_n;
+
+        __v4df r2 = x2 + y2;
+        r2_n = _mm256_blendv_pd(r2_n, r2, tracking);
+
+        active   = _mm256_and_pd(active,   (__v4df)(r2 < MAX_ZERO_OFFSET2_V));
+        tracking = _mm256_and_pd(tracking, (__v4df)(r2 < BAILOUT2_V));
+
+        unsigned mask = _mm256_movemask_pd(tracking);
+        if(mask == 0) break;
+
+        n     -= reinterpret_cast<__v4di>(active);
+        extra -= reinterpret_cast<__v4di>(_mm256_andnot_pd(active, tracking));
+
+        StepFractal<FRACTAL_MANDELBROT>(&x_n, &y_n, x2, y2, xy, x_0, y_0);
+    }
+
+    extra = (__v4di)_mm256_and_si256((__m256i)extra, (__m256i)(r2_n >= BAILOUT2_V));
+    for(__v4di left = (__v4di)_mm256_cmpgt_epi64((__m256i)extra, _mm256_setzero_si256()); _mm256_movemask_pd((__m256d)left);
+        left = (__v4di)_mm256_cmpgt_epi64((__m256i)extra, _mm256_setzero_si256()))
+    {
+        r2_n   = _mm256_blendv_pd(r2_n, _mm256_sqrt_pd(r2_n), (__v4df)left);
+        extra += left;
+    }
+
+    *r2_final = r2_n;
+    return n;
+}
+
+void RenderMandelbrot(uint8_t *pixels, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations)
+{
+    RenderPixels<FRACTAL_MANDELBROT>(pixels, width, height, x_rend, y_rend, delta, n_iterations, 0, 0);
+}
+
+template<FractalType FRACTAL>
+static void RenderPixels(uint8_t *pixels, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations,
+                         double c_x, double c_y)
+{
+    static const __v4df SHIFT_V = _mm256_set_pd(3, 2, 1, 0);
+
+    __v4df delta_v         = _mm256_set1_pd(delta);
+    __v4df delta_v_shifted = SHIFT_V * delta_v;
+
+    __v4df x_c = _mm256_set1_pd(c_x);
+    __v4df y_c = _mm256_set1_pd(c_y);
+
+    double y_offset   = 0;
+    int    mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!MirrorsRows(FRACTAL, c_y)) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        size_t pix_pos = (size_t)y_pos * width;
+
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 4, pix_pos += 4)
+        {
+            __v4df y_0 = _mm256_set1_pd((y_offset - y_pos) * delta);
+            __v4df x_0 = x_rend + delta_v_shifted + x_pos * delta_v;
+
+            __m128i mask = TailMask4(width - x_pos);
+            __v4di  n    = IterateFractal<FRACTAL>(TailPosition(x_0, mask), y_0, x_c, y_c, n_iterations);
+
+            __m128i rgba = _mm256_castsi256_si128(PackColor(_mm256_castsi128_si256(NarrowCounts(n))));
+            _mm_maskstore_epi32((int *)(pixels + 4 * pix_pos), mask, rgba);
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(pixels + 4 * (size_t)y_pos * width, pixels + 4 * (size_t)source * width, 4 * (size_t)width);
+    }
+}
+
+void RenderMandelbrotCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations, bool mirror)
+{
+    RenderCounts<FRACTAL_MANDELBROT>(counts, width, height, x_rend, y_rend, delta, n_iterations, 0, 0, mirror);
+}
+
+template<FractalType FRACTAL>
+static void RenderCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations,
+                         double c_x, double c_y, bool mirror)
+{
+    static const __v4df SHIFT_V = _mm256_set_pd(3, 2, 1, 0);
+
+    __v4df delta_v         = _mm256_set1_pd(delta);
+    __v4df delta_v_shifted = SHIFT_V * delta_v;
+
+    __v4df x_c = _mm256_set1_pd(c_x);
+    __v4df y_c = _mm256_set1_pd(c_y);
+
+    double y_offset   = 0;
+    int    mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!mirror || !MirrorsRows(FRACTAL, c_y)) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        unsigned *counts_p = counts + (size_t)y_pos * width;
+
+        __v4df y_0 = _mm256_set1_pd((y_offset - y_pos) * delta);
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 4, counts_p += 4)
+        {
+            __v4df x_0 = x_rend + delta_v_shifted + x_pos * delta_v;
+
+            __m128i mask = TailMask4(width - x_pos);
+            __v4di  n    = IterateFractal<FRACTAL>(TailPosition(x_0, mask), y_0, x_c, y_c, n_iterations);
+
+            _mm_maskstore_epi32((int *)counts_p, mask, NarrowCounts(n));
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(counts + (size_t)y_pos * width, counts + (size_t)source * width, width * sizeof(unsigned));
+    }
+}
+
+void RenderMandelbrotSmooth(uint8_t *pixels, unsigned *counts, float *r2, unsigned width, unsigned height,
+                            double x_rend, double y_rend, double delta, unsigned n_iterations, bool mirror)
+{
+    static const __v4df SHIFT_V = _mm256_set_pd(3, 2, 1, 0);
+
+    __v4df delta_v         = _mm256_set1_pd(delta);
+    __v4df delta_v_shifted = SHIFT_V * delta_v;
+
+    double y_offset   = 0;
+    int    mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!mirror) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        size_t pix_pos = (size_t)y_pos * width;
+
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 4, pix_pos += 4)
+        {
+            __v4df y_0 = _mm256_set1_pd((y_offset - y_pos) * delta);
+            __v4df x_0 = x_rend + delta_v_shifted + x_pos * delta_v;
+
+            __m128i mask = TailMask4(width - x_pos);
+
+            __v4df r2_final = {};
+            __v4di n = IterateMandelbrotSmooth(TailPosition(x_0, mask), y_0, n_iterations, &r2_final);
+
+            _mm_maskstore_epi32((int *)(counts + pix_pos), mask, NarrowCounts(n));
+            _mm_maskstore_ps(r2 + pix_pos, mask, _mm256_cvtpd_ps(r2_final));
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(counts + (size_t)y_pos * width, counts + (size_t)source * width, width * sizeof(unsigned));
+        memcpy(r2     + (size_t)y_pos * width, r2     + (size_t)source * width, width * sizeof(float));
+    }
+
+    ColorMandelbrotSmooth(pixels, counts, r2, (size_t)width * height, n_iterations);
+}
+
+void RenderMandelbrotPoints(unsigned *counts, float *r2, const double *x, const double *y, size_t n_points, unsigned n_iterations)
+{
+    for(size_t pix = 0; pix < n_points; pix += 4)
+    {
+        __m128i mask      = TailMask4(n_points - pix);
+        __m256i mask_wide = _mm256_cvtepi32_epi64(mask);
+
+        __v4df x_0 = TailPosition((__v4df)_mm256_maskload_pd(x + pix, mask_wide), mask);
+        __v4df y_0 = (__v4df)_mm256_maskload_pd(y + pix, mask_wide);
+
+        if(!r2)
+        {
+            _mm_maskstore_epi32((int *)(counts + pix), mask, NarrowCounts(IterateMandelbrot(x_0, y_0, n_iterations)));
+            continue;
+        }
+
+        __v4df r2_final = {};
+        __v4di n = IterateMandelbrotSmooth(x_0, y_0, n_iterations, &r2_final);
+
+        _mm_maskstore_epi32((int *)(counts + pix), mask, NarrowCounts(n));
+        _mm_maskstore_ps(r2 + pix, mask, _mm256_cvtpd_ps(r2_final));
+    }
+}
+
+void GridCoordinates(double *x, double *y, unsigned width, unsigned height, double x_rend, double y_rend, double delta)
+{
+    for(unsigned x_pos = 0; x_pos < width; x_pos++) x[x_pos] = x_rend + (double)(x_pos % 4) * delta + (double)(x_pos - x_pos % 4) * delta;
+
+    double y_offset = 0;
+    FindMirrorSum(y_rend, delta, &y_offset);
+    for(unsigned y_pos = 0; y_pos < height; y_pos++) y[y_pos] = (y_offset - y_pos) * delta;
+}
+
+// The estimate is computed in float from |z|^2 / |dz|^2 taken in double, where |dz|^2 does not overflow.
+static inline __v4di IterateMandelbrotDistance(__v4df x_0, __v4df y_0, unsigned n_iterations, __m128 *estimate)
+{
+    static const __v4df MAX_ZERO_OFFSET2_V = _mm256_set1_pd(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+    static const __v4df BAILOUT2_V         = _mm256_set1_pd(DISTANCE_BAILOUT * DISTANCE_BAILOUT);
+    static const __v4df ONE_V              = _mm256_set1_pd(1);
+
+    __v4df x_n  = {};
+    __v4df y_n  = {};
+    __v4df dx_n = {};
+    __v4df dy_n = {};
+
+    __v4df r2_n  = {};
+    __v4df dr2_n = {};
+
+    __v4df active   = (__v4df)_mm256_cmp_pd(x_n, x_n, _CMP_EQ_OQ);
+    __v4df tracking = active;
+
+    __v4di n = {};
+    for(volatile unsigned i = 0; i < n_iterations; i++)
+    {
+        __v4df x2 = x_n * x_n;
+        __v4df y2 = y_n * y_n;
+        __v4df xy = x_n * y_n;
+
+        __v4df r2 = x2 + y2;
+        r2_n  = _mm256_blendv_pd(r2_n,  r2,                        tracking);
+        dr2_n = _mm256_blendv_pd(dr2_n, dx_n * dx_n + dy_n * dy_n, tracking);
+
+        active   = _mm256_and_pd(active,   (__v4df)(r2 < MAX_ZERO_OFFSET2_V));
+        tracking = _mm256_and_pd(tracking, (__v4df)(r2 < BAILOUT2_V));
+
+        unsigned mask = _mm256_movemask_pd(tracking);
+        if(mask == 0) break;
+
+        n -= reinterpret_cast<__v4di>(active);
+
+        __v4df dx = x_n * dx_n - y_n * dy_n;
+        __v4df dy = x_n * dy_n + y_n * dx_n;
+        dx_n = dx + dx + ONE_V;
+        dy_n = dy + dy;
+
+        StepFractal<FRACTAL_MANDELBROT>(&x_n, &y_n, x2, y2, xy, x_0, y_0);
+    }
+
+    *estimate = _mm256_castps256_ps128(DistanceEstimate(_mm256_castps128_ps256(_mm256_cvtpd_ps(r2_n)),
+                                                        _mm256_castps128_ps256(_mm256_cvtpd_ps(r2_n / dr2_n))));
+    return n;
+}
+
+void RenderMandelbrotDistance(uint8_t *pixels, unsigned *counts, float *distance, unsigned width, unsigned height,
+                              double x_rend, double y_rend, double delta, unsigned n_iterations, bool mirror)
+{
+    static const __v4df SHIFT_V = _mm256_set_pd(3, 2, 1, 0);
+
+    __v4df delta_v         = _mm256_set1_pd(delta);
+    __v4df delta_v_shifted = SHIFT_V * delta_v;
+    __m128 inv_delta_v     = _mm_set1_ps((float)(1 / delta));
+
+    const __m128i N_ITERATIONS_V = _mm_set1_epi32(n_iterations);
+
+    double y_offset   = 0;
+    int    mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+    if(!mirror) mirror_sum = -1;
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos += 1)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) continue;
+
+        size_t pix_pos = (size_t)y_pos * width;
+
+        for(unsigned x_pos = 0; x_pos < width; x_pos += 4, pix_pos += 4)
+        {
+            __v4df y_0 = _mm256_set1_pd((y_offset - y_pos) * delta);
+            __v4df x_0 = x_rend + delta_v_shifted + x_pos * delta_v;
+
+            __m128i mask = TailMask4(width - x_pos);
+
+            __m128  estimate = {};
+            __m128i n        = NarrowCounts(IterateMandelbrotDistance(TailPosition(x_0, mask), y_0, n_iterations, &estimate));
+
+            __m128 interior = _mm_castsi128_ps(_mm_cmpeq_epi32(n, N_ITERATIONS_V));
+
+            _mm_maskstore_epi32((int *)(counts + pix_pos), mask, n);
+            _mm_maskstore_ps(distance + pix_pos, mask, _mm_andnot_ps(interior, _mm_mul_ps(estimate, inv_delta_v)));
+        }
+    }
+
+    for(unsigned y_pos = 0; y_pos < height; y_pos++)
+    {
+        int source = MirrorSource(y_pos, mirror_sum);
+        if(source < 0) continue;
+
+        memcpy(counts   + (size_t)y_pos * width, counts   + (size_t)source * width, width * sizeof(unsigned));
+        memcpy(distance + (size_t)y_pos * width, distance + (size_t)source * width, width * sizeof(float));
+    }
+
+    if(pixels) ColorMandelbrotDistance(pixels, counts, distance, (size_t)width * height, n_iterations);
+}
+
+int FindMirrorSum(double y_rend, double delta, double *y_offset)
+{
+    double offset = y_rend / delta;
+    double sum    = round(2 * offset);
+
+    *y_offset = offset;
+    if(fabs(2 * offset - sum) > MIRROR_TOLERANCE_HIGH || fabs(sum) >= MIRROR_MAX_SUM_HIGH) return -1;
+
+    *y_offset = sum / 2;
+    return (int)sum;
+}
+
+// ================================================================================================================================================================================
+// Coloring and tails
+// ================================================================================================================================================================================
+
+void ColorMandelbrot(uint8_t *pixels, const unsigned *counts, size_t n_pixels)
+{
+    for(size_t pix_pos = 0; pix_pos < n_pixels; pix_pos += 8)
+    {
+        __m256i mask = TailMask(n_pixels - pix_pos);
+        __m256i n    = _mm256_maskload_epi32((const int *)(counts + pix_pos), mask);
+
+        _mm256_maskstore_epi32((int *)(pixels + 4 * pix_pos), mask, PackColor(n));
+    }
+}
+
+// Continuous count mu = n + 1 - log2(log2|z_n|) for escaped pixels. Red and green rise with mu over 256 iterations and blue
+// over 8, as in the plain coloring, but as triangle waves so nothing jumps where n * 32 or n would wrap around a byte.
+void ColorMandelbrotSmooth(uint8_t *pixels, const unsigned *counts, const float *r2, size_t n_pixels, unsigned n_iterations)
+{
+    static const __v8sf ONE_V        = _mm256_set1_ps(1);
+    static const __v8sf HALF_V       = _mm256_set1_ps(0.5f);
+    static const __v8sf RED_FREQ_V   = _mm256_set1_ps(1.0f / 512);
+    static const __v8sf BLUE_FREQ_V  = _mm256_set1_ps(1.0f / 16);
+    static const __v8sf COLOR_MAX_V  = _mm256_set1_ps(255);
+    static const __m256i ALPHA_V     = _mm256_set1_epi32(0xFF000000);
+
+    const __m256i N_ITERATIONS_V = _mm256_set1_epi32(n_iterations);
+
+    for(size_t pix_pos = 0; pix_pos < n_pixels; pix_pos += 8)
+    {
+        __m256i mask = TailMask(n_pixels - pix_pos);
+
+        __m256i n = _mm256_maskload_epi32((const int *)(counts + pix_pos), mask);
+        __v8sf n_f = _mm256_cvtepi32_ps(n);
+
+        __v8sf mu = n_f + ONE_V - FastLog2(HALF_V * FastLog2(_mm256_maskload_ps(r2 + pix_pos, mask)));
+        mu = _mm256_blendv_ps(mu, n_f, _mm256_castsi256_ps(_mm256_cmpeq_epi32(n, N_ITERATIONS_V)));
+
+        __v8sf red  = mu * RED_FREQ_V;
+        __v8sf blue = mu * BLUE_FREQ_V;
+        red  = ONE_V - _mm256_andnot_ps(_mm256_set1_ps(-0.0f), 2 * (red  - _mm256_floor_ps(red))  - ONE_V);
+        blue = ONE_V - _mm256_andnot_ps(_mm256_set1_ps(-0.0f), 2 * (blue - _mm256_floor_ps(blue)) - ONE_V);
+
+        __m256i red_i  = _mm256_cvtps_epi32(red  * COLOR_MAX_V);
+        __m256i blue_i = _mm256_cvtps_epi32(blue * COLOR_MAX_V);
+
+        __m256i rgba = _mm256_or_si256(_mm256_or_si256(red_i, _mm256_slli_epi32(red_i, 8)),
+                                       _mm256_or_si256(_mm256_slli_epi32(blue_i, 16), ALPHA_V));
+
+        _mm256_maskstore_epi32((int *)(pixels + 4 * pix_pos), mask, rgba);
+    }
+}
+
+// Grey levels from the distance in pixels: black on the boundary and inside the set, white from DISTANCE_WHITE pixels
+// away, with a square root in between so thin filaments stay visible.
+void ColorMandelbrotDistance(uint8_t *pixels, const unsigned *counts, const float *distance, size_t n_pixels, unsigned n_iterations)
+{
+    static const __v8sf  INV_WHITE_V = _mm256_set1_ps(1.0f / DISTANCE_WHITE);
+    static const __v8sf  ONE_V       = _mm256_set1_ps(1);
+    static const __v8sf  COLOR_MAX_V = _mm256_set1_ps(255);
+    static const __m256i ALPHA_V     = _mm256_set1_epi32(0xFF000000);
+
+    const __m256i N_ITERATIONS_V = _mm256_set1_epi32(n_iterations);
+
+    for(size_t pix_pos = 0; pix_pos < n_pixels; pix_pos += 8)
+    {
+        __m256i mask = TailMask(n_pixels - pix_pos);
+
+        __m256i n    = _mm256_maskload_epi32((const int *)(counts + pix_pos), mask);
+        __v8sf  grey = _mm256_sqrt_ps(_mm256_min_ps(_mm256_maskload_ps(distance + pix_pos, mask) * INV_WHITE_V, ONE_V));
+
+        __m256i grey_i = _mm256_cvtps_epi32(grey * COLOR_MAX_V);
+        grey_i = _mm256_andnot_si256(_mm256_cmpeq_epi32(n, N_ITERATIONS_V), grey_i);
+
+        __m256i rgba = _mm256_or_si256(_mm256_or_si256(grey_i, _mm256_slli_epi32(grey_i, 8)),
+                                       _mm256_or_si256(_mm256_slli_epi32(grey_i, 16), ALPHA_V));
+
+        _mm256_maskstore_epi32((int *)(pixels + 4 * pix_pos), mask, rgba);
+    }
+}
+
+// All lanes for n_left >= 8, otherwise the first n_left of them: the part of the last vector of a row or a buffer that
+// is still inside it. Loads and stores through this mask never touch memory past the end.
+static inline __m256i TailMask(size_t n_left)
+{
+    static const __m256i LANES_V = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32((n_left < 8) ? (int)n_left : 8), LANES_V);
+}
+
+// Same for the 4 lanes of the [4 x double] kernel, as 32 bit lanes to store the narrowed counts with.
+static inline __m128i TailMask4(size_t n_left)
+{
+    static const __m128i LANES_V = _mm_set_epi32(3, 2, 1, 0);
+
+    return _mm_cmpgt_epi32(_mm_set1_epi32((n_left < 4) ? (int)n_left : 4), LANES_V);
+}
+
+// Lanes past the end of the row start outside of the escape radius, so they leave the kernel with the first lane that
+// escapes and a partial vector never loops longer than its pixels need.
+static inline __v8sf TailPosition(__v8sf x_0, __m256i mask)
+{
+    static const __v8sf OUTSIDE_V = _mm256_set1_ps(2 * MAX_ZERO_OFFSET);
+
+    return _mm256_blendv_ps(OUTSIDE_V, x_0, _mm256_castsi256_ps(mask));
+}
+
+static inline __v4df TailPosition(__v4df x_0, __m128i mask)
+{
+    static const __v4df OUTSIDE_V = _mm256_set1_pd(2 * MAX_ZERO_OFFSET);
+
+    return _mm256_blendv_pd(OUTSIDE_V, x_0, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(mask)));
+}
+
+// Low halves of the 4 64 bit counts, packed into 4 32 bit lanes.
+static inline __m128i NarrowCounts(__v4di n)
+{
+    static const __m256i EVEN_V = _mm256_set_epi32(7, 5, 3, 1, 6, 4, 2, 0);
+
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32((__m256i)n, EVEN_V));
+}
+
+// RGBA of the plain coloring (n, n, n * 32, 255) for 8 escape counts at once.
+static inline __m256i PackColor(__m256i n)
+{
+    static const __m256i BYTE_V  = _mm256_set1_epi32(0xFF);
+    static const __m256i ALPHA_V = _mm256_set1_epi32(0xFF000000);
+
+    __m256i color = _mm256_and_si256(n, BYTE_V);
+    __m256i blue  = _mm256_and_si256(_mm256_slli_epi32(n, 5), BYTE_V);
+
+    return _mm256_or_si256(_mm256_or_si256(color, _mm256_slli_epi32(color, 8)),
+                           _mm256_or_si256(_mm256_slli_epi32(blue, 16), ALPHA_V));
+}
+
+// log2 with the exponent taken from the float bits and a degree 5 polynomial on the mantissa, |error| < 3e-5.
+static inline __v8sf FastLog2(__v8sf x)
+{
+    static const __m256i MANTISSA_MASK_V = _mm256_set1_epi32(0x007FFFFF);
+    static const __m256i ONE_BITS_V      = _mm256_set1_epi32(0x3F800000);
+    static const __m256i EXP_BIAS_V      = _mm256_set1_epi32(127);
+
+    __m256i bits = _mm256_castps_si256(x);
+
+    __v8sf exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), EXP_BIAS_V));
+    __v8sf t        = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, MANTISSA_MASK_V), ONE_BITS_V)) - 1;
+
+    __v8sf poly = 0.0458789501f * t - 0.194408323f;
+    poly = poly * t + 0.415411186f;
+    poly = poly * t - 0.708678912f;
+    poly = poly * t + 1.44182550f;
+
+    return exponent + poly * t;
+}
+
+static inline __v8sf AbsValue(__v8sf x)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+static inline __v4df AbsValue(__v4df x)
+{
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+}
+
+// |z| ln|z| / |dz| = ln 2 / 2 * log2(|z|^2) * sqrt(|z|^2 / |dz|^2). An overflowed |dz| gives a ratio of 0 or NaN, a
+// point too close to the boundary to tell, and maxps returns its second operand for NaN.
+static inline __v8sf DistanceEstimate(__v8sf r2, __v8sf ratio)
+{
+    static const __v8sf HALF_LN2_V = _mm256_set1_ps(0.34657359f);
+
+    return _mm256_max_ps(HALF_LN2_V * FastLog2(r2) * _mm256_sqrt_ps(ratio), _mm256_setzero_ps());
+}
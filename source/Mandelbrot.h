@@ -0,0 +1,89 @@
+#ifndef MANDELBROT_H
+#define MANDELBROT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Escape-time rendering with AVX2, without any dependencies besides the C++ standard library, so it can be linked into
+// programs that never open a window. A view is given by the coordinates of its top left pixel (x_rend, y_rend) and the
+// distance between neighbouring pixels delta. Buffers hold width * height values row after row, pixels are RGBA.
+// Functions taking float coordinates compute [8 x float] vectors, the ones taking double coordinates [4 x double].
+
+const float MAX_ZERO_OFFSET = 2;
+
+const unsigned AA_GRID           = 4;
+const unsigned AA_SAMPLES        = AA_GRID * AA_GRID;
+const unsigned AA_MIN_DIFFERENCE = 1;
+
+const float DISTANCE_WHITE = 8;
+
+// Escape-time formulas. Every one is compiled as its own kernel, so the choice costs nothing in the iteration loop.
+enum FractalType
+{
+    FRACTAL_MANDELBROT,   // z -> z^2 + c, z_0 = 0, c = pixel
+    FRACTAL_JULIA,        // z -> z^2 + c, z_0 = pixel, c fixed
+    FRACTAL_BURNING_SHIP, // z -> (|Re z| + i |Im z|)^2 + c
+    FRACTAL_MULTIBROT3,   // z -> z^3 + c
+    FRACTAL_MULTIBROT4,   // z -> z^4 + c
+    N_FRACTALS,
+};
+
+struct Fractal
+{
+    FractalType type;
+
+    double c_x; // fixed c of Julia sets
+    double c_y;
+};
+
+const char *FractalName(FractalType type);
+
+void RenderMandelbrot(uint8_t *pixels, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta, unsigned n_iterations);
+void RenderMandelbrot(uint8_t *pixels, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations);
+
+void RenderMandelbrotCounts(unsigned *counts, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta, unsigned n_iterations, bool mirror);
+void RenderMandelbrotCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations, bool mirror);
+
+void RenderMandelbrotSmooth(uint8_t *pixels, unsigned *counts, float *r2, unsigned width, unsigned height,
+                            float  x_rend, float  y_rend, float  delta, unsigned n_iterations, bool mirror);
+void RenderMandelbrotSmooth(uint8_t *pixels, unsigned *counts, float *r2, unsigned width, unsigned height,
+                            double x_rend, double y_rend, double delta, unsigned n_iterations, bool mirror);
+
+// Escape counts of arbitrary points instead of a grid: jittered supersamples, refinement points, random samples. The
+// coordinates come as two arrays, x and y of every point. r2 gets |z|^2 at the escape as in RenderMandelbrotSmooth; it
+// may be NULL, then the cheaper loop of RenderMandelbrotCounts runs.
+void RenderMandelbrotPoints(unsigned *counts, float *r2, const float  *x, const float  *y, size_t n_points, unsigned n_iterations);
+void RenderMandelbrotPoints(unsigned *counts, float *r2, const double *x, const double *y, size_t n_points, unsigned n_iterations);
+
+// x of every column and y of every row of a view exactly as the grid kernels compute them, without mirroring: points
+// taken from here get the same counts from RenderMandelbrotPoints as from RenderMandelbrotCounts.
+void GridCoordinates(float  *x, float  *y, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta);
+void GridCoordinates(double *x, double *y, unsigned width, unsigned height, double x_rend, double y_rend, double delta);
+
+void RenderFractal(uint8_t *pixels, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta, unsigned n_iterations, Fractal fractal);
+void RenderFractal(uint8_t *pixels, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations, Fractal fractal);
+
+void RenderFractalCounts(unsigned *counts, unsigned width, unsigned height, float  x_rend, float  y_rend, float  delta, unsigned n_iterations,
+                         Fractal fractal, bool mirror);
+void RenderFractalCounts(unsigned *counts, unsigned width, unsigned height, double x_rend, double y_rend, double delta, unsigned n_iterations,
+                         Fractal fractal, bool mirror);
+
+// Escape counts and the exterior distance estimate in pixels, from dz/dc carried in the same loop; 0 inside the set.
+void RenderMandelbrotDistance(uint8_t *pixels, unsigned *counts, float *distance, unsigned width, unsigned height,
+                              float  x_rend, float  y_rend, float  delta, unsigned n_iterations, bool mirror);
+void RenderMandelbrotDistance(uint8_t *pixels, unsigned *counts, float *distance, unsigned width, unsigned height,
+                              double x_rend, double y_rend, double delta, unsigned n_iterations, bool mirror);
+
+size_t RenderMandelbrotAA(uint8_t *pixels, unsigned *counts, unsigned *edges, unsigned width, unsigned height,
+                          float x_rend, float y_rend, float delta, unsigned n_iterations);
+size_t FindEdges(const unsigned *counts, unsigned *edges, unsigned width, unsigned height);
+
+int FindMirrorSum(float  y_rend, float  delta, float  *y_offset);
+int FindMirrorSum(double y_rend, double delta, double *y_offset);
+int MirrorSource(unsigned y_pos, int mirror_sum);
+
+void ColorMandelbrot(uint8_t *pixels, const unsigned *counts, size_t n_pixels);
+void ColorMandelbrotSmooth(uint8_t *pixels, const unsigned *counts, const float *r2, size_t n_pixels, unsigned n_iterations);
+void ColorMandelbrotDistance(uint8_t *pixels, const unsigned *counts, const float *distance, size_t n_pixels, unsigned n_iterations);
+
+#endif // MANDELBROT_H
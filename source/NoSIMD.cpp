@@ -1,12 +1,16 @@
+#ifdef RENDER
 #include "SFML/Graphics.hpp"
 #include "SFML/Window.hpp"
 #include "SFML/System.hpp"
+#endif
 
 #include <immintrin.h>
 #include <inttypes.h>
 #include <math.h>
 #include <string.h>
 
+#include "PerfCounters.h"
+
 const unsigned SCREEN_WIDTH  = 1920;
 const unsigned SCREEN_HEIGHT = 1080;
 
@@ -14,12 +18,14 @@ const unsigned PIXELS_PER_OFFSET = 20;
 
 const float MAX_ZERO_OFFSET = 2.0;
 
+#ifdef RENDER
 inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render);
-inline size_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels);
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels);
+#endif
 
-inline int64_t TimeCounter(void);
-void TestNoSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
+inline size_t RenderMandelbrot(uint8_t *pixels, float x_rend, float y_rend, float delta);
+
+void TestNoSIMD(uint8_t *pixels, float x_rend, float y_rend, float delta);
 
 int main(void)
 {
@@ -32,8 +38,8 @@ int main(void)
     float x_rend = -MAX_ZERO_OFFSET;
     float y_rend = MAX_ZERO_OFFSET * ratio;
 // ================================================================================================================================================================================
-    sf::Uint8 *pixels = (sf::Uint8 *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(sf::Uint8));
-    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(sf::Uint8)));
+    uint8_t *pixels = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(uint8_t));
+    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(uint8_t)));
 // ================================================================================================================================================================================
 #ifndef RENDER
     TestNoSIMD(pixels, x_rend, y_rend, delta);
@@ -64,26 +70,7 @@ int main(void)
 // ================================================================================================================================================================================
 }
 
-inline int64_t TimeCounter(void)
-{
-    int64_t result = 0;
-
-    asm volatile
-    (
-        ".intel_syntax noprefix\n\t"
-        "rdtsc\n\t"
-        "shl rdx, 32\n\t"
-        "add rax, rdx\n\t"
-        "mov %0, rax\n\t"
-        ".att_syntax prefix\n\t"
-        : "=r"(result)
-        :
-        : "%rdx", "%rax"
-    );
-
-    return result;
-}
-
+#ifdef RENDER
 inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render)
 {
     switch(event.type)
@@ -146,11 +133,12 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_re
         }
     }
 }
+#endif
 
-inline size_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+inline size_t RenderMandelbrot(uint8_t *pixels, float x_rend, float y_rend, float delta)
 {
 #ifndef RENDER
-    int64_t start = TimeCounter();
+    int64_t start = TimeCounterStart();
 #endif
 
     static const unsigned N_ITERATIONS = 255;
@@ -189,14 +177,15 @@ inline size_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, fl
     }
 
 #ifndef RENDER
-    int64_t end = TimeCounter();
+    int64_t end = TimeCounterEnd();
     return (end - start);
 #endif
 
     return 0;
 }
 
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
+#ifdef RENDER
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels)
 {
     static sf::Texture texture;
     static sf::Sprite sprite;
@@ -210,8 +199,9 @@ inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
     window.draw(sprite);
     window.display();
 }
+#endif
 
-void TestNoSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+void TestNoSIMD(uint8_t *pixels, float x_rend, float y_rend, float delta)
 {
     const size_t N_TESTS = 100;
     int64_t results[N_TESTS] = {};
@@ -219,9 +209,17 @@ void TestNoSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
     double result_time = 0;
     double error       = 0;
 
+    PrintTSCCalibration();
+
+    PerfCounters counters = {};
+    PerfCountersOpen(&counters);
+
     for(size_t i = 0; i < N_TESTS; i++)
     {
+        PerfCountersStart(&counters);
         int64_t delta_time = RenderMandelbrot(pixels, x_rend, y_rend, delta);
+        PerfCountersStop(&counters);
+
         results[i]   = delta_time;
         result_time += (double)delta_time;
     }
@@ -238,4 +236,7 @@ void TestNoSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
     error       = round(error       / exp) * exp;
     result_time = round(result_time / exp) * exp;
     printf("%lg ± %lg\n", result_time, error);
+
+    PrintPerfCounters(&counters);
+    PerfCountersClose(&counters);
 }
\ No newline at end of file
@@ -1,10 +1,14 @@
+#ifdef RENDER
 #include "SFML/Graphics.hpp"
 #include "SFML/Window.hpp"
 #include "SFML/System.hpp"
+#endif
 
 #include <immintrin.h>
 #include <inttypes.h>
 #include <string.h>
+
+#include "PerfCounters.h"
 #include <math.h>
 
 const unsigned VECTOR_SZ = 8;
@@ -15,12 +19,14 @@ const unsigned SCREEN_HEIGHT = 1080;
 const unsigned PIXELS_PER_OFFSET = 20;
 const float MAX_ZERO_OFFSET      = 2;
 
+#ifdef RENDER
 inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render);
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels);
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels);
+#endif
 
-inline int64_t TimeCounter(void);
-void TestNoSIMD2(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
+inline int64_t RenderMandelbrot(uint8_t *pixels, float x_rend, float y_rend, float delta);
+
+void TestNoSIMD2(uint8_t *pixels, float x_rend, float y_rend, float delta);
 
 inline void vset1(float vec[VECTOR_SZ], float val);
 inline void vadd(float result[VECTOR_SZ], float vec1[VECTOR_SZ], float vec2[VECTOR_SZ]);
@@ -37,8 +43,8 @@ int main(void)
     float x_rend = -MAX_ZERO_OFFSET;
     float y_rend = MAX_ZERO_OFFSET * ratio;
 // ================================================================================================================================================================================
-    sf::Uint8 *pixels = (sf::Uint8 *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(sf::Uint8));
-    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(sf::Uint8)));
+    uint8_t *pixels = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(uint8_t));
+    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(uint8_t)));
 // ================================================================================================================================================================================
 #ifndef RENDER
     TestNoSIMD2(pixels, x_rend, y_rend, delta);
@@ -69,26 +75,7 @@ int main(void)
 // ================================================================================================================================================================================
 }
 
-inline int64_t TimeCounter(void)
-{
-    int64_t result = 0;
-
-    asm volatile
-    (
-        ".intel_syntax noprefix\n\t"
-        "rdtsc\n\t"
-        "shl rdx, 32\n\t"
-        "add rax, rdx\n\t"
-        "mov %0, rax\n\t"
-        ".att_syntax prefix\n\t"
-        : "=r"(result)
-        :
-        : "%rdx", "%rax"
-    );
-
-    return result;
-}
-
+#ifdef RENDER
 inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render)
 {
     switch(event.type)
@@ -151,11 +138,12 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_re
         }
     }
 }
+#endif
 
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+inline int64_t RenderMandelbrot(uint8_t *pixels, float x_rend, float y_rend, float delta)
 {
 #ifndef RENDER
-    int64_t start = TimeCounter();
+    int64_t start = TimeCounterStart();
 #endif
 
     static const unsigned N_ITERATIONS = 255;
@@ -205,7 +193,7 @@ inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, f
 #ifdef RENDER
             for(unsigned i = 0; i < VECTOR_SZ; i++, pix_arr_pos += 4)
             {
-                sf::Uint8 color = n[i];
+                uint8_t color = n[i];
                 pixels[pix_arr_pos + 0] = color;
                 pixels[pix_arr_pos + 1] = color;
                 pixels[pix_arr_pos + 2] = color * 32;
@@ -215,14 +203,15 @@ inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, f
     }
 
 #ifndef RENDER
-    int64_t end = TimeCounter();
+    int64_t end = TimeCounterEnd();
     return (end - start);
 #endif
 
     return 0;
 }
 
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
+#ifdef RENDER
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels)
 {
     static sf::Texture texture;
     static sf::Sprite sprite;
@@ -236,8 +225,9 @@ inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
     window.draw(sprite);
     window.display();
 }
+#endif
 
-void TestNoSIMD2(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+void TestNoSIMD2(uint8_t *pixels, float x_rend, float y_rend, float delta)
 {
     const size_t N_TESTS = 100;
     int64_t results[N_TESTS] = {};
@@ -245,9 +235,17 @@ void TestNoSIMD2(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
     double result_time = 0;
     double error       = 0;
 
+    PrintTSCCalibration();
+
+    PerfCounters counters = {};
+    PerfCountersOpen(&counters);
+
     for(size_t i = 0; i < N_TESTS; i++)
     {
+        PerfCountersStart(&counters);
         int64_t delta_time = RenderMandelbrot(pixels, x_rend, y_rend, delta);
+        PerfCountersStop(&counters);
+
         results[i]   = delta_time;
         result_time += (double)delta_time;
     }
@@ -264,6 +262,9 @@ void TestNoSIMD2(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
     error       = round(error       / exp) * exp;
     result_time = round(result_time / exp) * exp;
     printf("%lg ± %lg\n", result_time, error);
+
+    PrintPerfCounters(&counters);
+    PerfCountersClose(&counters);
 }
 
 inline void vset1(float vec[VECTOR_SZ], float val)
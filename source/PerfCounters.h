@@ -0,0 +1,264 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <linux/perf_event.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+enum PerfCounterId
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_FP_VECTOR_OPS,
+
+    N_PERF_COUNTERS,
+};
+
+// Hardware counters of the calling thread. A counter the kernel refused to open keeps fd == -1 and is reported as n/a,
+// so the benchmarks still run in containers, VMs and with a strict perf_event_paranoid.
+struct PerfCounters
+{
+    int fd[N_PERF_COUNTERS];
+
+    double value[N_PERF_COUNTERS];
+    size_t n_runs;
+};
+
+inline int64_t TimeCounterStart(void);
+inline int64_t TimeCounterEnd(void);
+inline double  FrameClockMs(void);
+
+inline bool IsIntelCPU(void);
+inline int OpenPerfEvent(uint32_t type, uint64_t config);
+
+inline void PerfCountersOpen(PerfCounters *counters);
+inline void PerfCountersClose(PerfCounters *counters);
+inline void PerfCountersStart(PerfCounters *counters);
+inline void PerfCountersStop(PerfCounters *counters);
+inline void PrintPerfCounter(const PerfCounters *counters, PerfCounterId id, const char *name);
+inline void PrintPerfCounters(const PerfCounters *counters);
+
+inline double CalibrateTSC(double *core_ghz);
+inline void PrintTSCCalibration(void);
+
+// lfence keeps rdtsc from being executed before the preceding instructions finish
+// and the following ones from starting before it.
+inline int64_t TimeCounterStart(void)
+{
+    int64_t result = 0;
+
+    asm volatile
+    (
+        ".intel_syntax noprefix\n\t"
+        "lfence\n\t"
+        "rdtsc\n\t"
+        "lfence\n\t"
+        "shl rdx, 32\n\t"
+        "add rax, rdx\n\t"
+        "mov %0, rax\n\t"
+        ".att_syntax prefix\n\t"
+        : "=r"(result)
+        :
+        : "%rdx", "%rax", "memory"
+    );
+
+    return result;
+}
+
+// rdtscp waits for all previous instructions, lfence keeps later ones from starting before the read.
+inline int64_t TimeCounterEnd(void)
+{
+    int64_t result = 0;
+
+    asm volatile
+    (
+        ".intel_syntax noprefix\n\t"
+        "rdtscp\n\t"
+        "lfence\n\t"
+        "shl rdx, 32\n\t"
+        "add rax, rdx\n\t"
+        "mov %0, rax\n\t"
+        ".att_syntax prefix\n\t"
+        : "=r"(result)
+        :
+        : "%rdx", "%rax", "%rcx", "memory"
+    );
+
+    return result;
+}
+
+// Wall-clock milliseconds for frame timing in the viewers, where the TSC would need a calibration first.
+inline double FrameClockMs(void)
+{
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+inline bool IsIntelCPU(void)
+{
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0));
+
+    return ebx == 0x756E6547 && edx == 0x49656E69 && ecx == 0x6C65746E; // "GenuineIntel"
+}
+
+inline int OpenPerfEvent(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr = {};
+
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+inline void PerfCountersOpen(PerfCounters *counters)
+{
+    memset(counters, 0, sizeof(*counters));
+
+    counters->fd[PERF_CYCLES]        = OpenPerfEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->fd[PERF_INSTRUCTIONS]  = OpenPerfEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fd[PERF_BRANCH_MISSES] = OpenPerfEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+    // FP_ARITH_INST_RETIRED (event 0xC7) with the 128 and 256 bit packed single and double umasks. There is no generic
+    // perf event for it, and the raw encoding is Intel specific.
+    counters->fd[PERF_FP_VECTOR_OPS] = IsIntelCPU() ? OpenPerfEvent(PERF_TYPE_RAW, 0x3CC7) : -1;
+}
+
+inline void PerfCountersClose(PerfCounters *counters)
+{
+    for(unsigned i = 0; i < N_PERF_COUNTERS; i++)
+    {
+        if(counters->fd[i] >= 0) close(counters->fd[i]);
+        counters->fd[i] = -1;
+    }
+}
+
+inline void PerfCountersStart(PerfCounters *counters)
+{
+    for(unsigned i = 0; i < N_PERF_COUNTERS; i++)
+    {
+        if(counters->fd[i] < 0) continue;
+
+        ioctl(counters->fd[i], PERF_EVENT_IOC_RESET,  0);
+        ioctl(counters->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+// Adds the counts since PerfCountersStart, scaled up if the kernel had to multiplex the counters.
+inline void PerfCountersStop(PerfCounters *counters)
+{
+    for(unsigned i = 0; i < N_PERF_COUNTERS; i++)
+    {
+        if(counters->fd[i] < 0) continue;
+
+        ioctl(counters->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+        uint64_t data[3] = {}; // value, time enabled, time running
+        if(read(counters->fd[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+
+        counters->value[i] += (double)data[0] * ((double)data[1] / (double)data[2]);
+    }
+
+    counters->n_runs++;
+}
+
+inline void PrintPerfCounter(const PerfCounters *counters, PerfCounterId id, const char *name)
+{
+    if(counters->fd[id] < 0 || counters->n_runs == 0)
+    {
+        printf("%s n/a", name);
+        return;
+    }
+
+    printf("%s %.4lg", name, counters->value[id] / (double)counters->n_runs);
+}
+
+// Averages per run: cycles, instructions, IPC, branch misses, FP vector ops.
+inline void PrintPerfCounters(const PerfCounters *counters)
+{
+    PrintPerfCounter(counters, PERF_CYCLES,        "cycles");
+    printf(", ");
+    PrintPerfCounter(counters, PERF_INSTRUCTIONS,  "instructions");
+
+    if(counters->fd[PERF_CYCLES] >= 0 && counters->fd[PERF_INSTRUCTIONS] >= 0 && counters->value[PERF_CYCLES] > 0)
+    {
+        printf(", IPC %.2lf", counters->value[PERF_INSTRUCTIONS] / counters->value[PERF_CYCLES]);
+    }
+    else
+    {
+        printf(", IPC n/a");
+    }
+
+    printf(", ");
+    PrintPerfCounter(counters, PERF_BRANCH_MISSES, "branch misses");
+    printf(", ");
+    PrintPerfCounter(counters, PERF_FP_VECTOR_OPS, "FP vector ops");
+    printf("\n");
+}
+
+// Returns the TSC frequency in GHz, measured against CLOCK_MONOTONIC over a busy loop. If the cycles counter is
+// available, *core_ghz gets the core clock over the same loop (0 otherwise), so TSC ticks can be read as core cycles.
+inline double CalibrateTSC(double *core_ghz)
+{
+    const int64_t CALIBRATION_NS = 100000000;
+
+    int cycles_fd = OpenPerfEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    if(cycles_fd >= 0)
+    {
+        ioctl(cycles_fd, PERF_EVENT_IOC_RESET,  0);
+        ioctl(cycles_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    timespec start_ts = {};
+    timespec now_ts   = {};
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
+    int64_t start = TimeCounterStart();
+
+    int64_t elapsed_ns = 0;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now_ts);
+        elapsed_ns = (now_ts.tv_sec - start_ts.tv_sec) * 1000000000 + (now_ts.tv_nsec - start_ts.tv_nsec);
+    } while(elapsed_ns < CALIBRATION_NS);
+
+    int64_t end = TimeCounterEnd();
+
+    *core_ghz = 0;
+    if(cycles_fd >= 0)
+    {
+        ioctl(cycles_fd, PERF_EVENT_IOC_DISABLE, 0);
+
+        uint64_t data[3] = {};
+        if(read(cycles_fd, data, sizeof(data)) == sizeof(data) && data[2] != 0)
+        {
+            *core_ghz = (double)data[0] * ((double)data[1] / (double)data[2]) / (double)elapsed_ns;
+        }
+        close(cycles_fd);
+    }
+
+    return (double)(end - start) / (double)elapsed_ns;
+}
+
+inline void PrintTSCCalibration(void)
+{
+    double core_ghz = 0;
+    double tsc_ghz  = CalibrateTSC(&core_ghz);
+
+    if(core_ghz > 0) printf("TSC %.3lf GHz, core %.3lf GHz (1 tick = %.3lf core cycles)\n", tsc_ghz, core_ghz, core_ghz / tsc_ghz);
+    else             printf("TSC %.3lf GHz, core clock n/a\n", tsc_ghz);
+}
+
+#endif // PERF_COUNTERS_H
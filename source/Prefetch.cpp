@@ -0,0 +1,293 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Mandelbrot.h"
+#include "Prefetch.h"
+
+static void *PrefetchWorker(void *prefetcher_p);
+static PrefetchEntry *NextEntry(Prefetcher *prefetcher);
+static void SetupEntry(Prefetcher *prefetcher, PrefetchEntry *entry, ViewMove move);
+static inline bool SameView(const PrefetchView *a, const PrefetchView *b);
+static void SetIdlePriority(void);
+
+const char *MoveName(ViewMove move)
+{
+    static const char *const NAMES[PREFETCH_N_MOVES] = {"left", "right", "up", "down", "in", "out"};
+
+    return (move < PREFETCH_N_MOVES) ? NAMES[move] : "";
+}
+
+// The moves of the viewer keys; the viewer calls this too, so a predicted view is equal to the real one to the bit.
+void MoveView(float *x_rend, float *y_rend, float *delta, unsigned width, unsigned height, ViewMove move, unsigned pan_pixels)
+{
+    switch(move)
+    {
+        case MOVE_LEFT:
+        {
+            *x_rend -= pan_pixels * *delta;
+            return;
+        }
+        case MOVE_RIGHT:
+        {
+            *x_rend += pan_pixels * *delta;
+            return;
+        }
+        case MOVE_UP:
+        {
+            *y_rend += pan_pixels * *delta;
+            return;
+        }
+        case MOVE_DOWN:
+        {
+            *y_rend -= pan_pixels * *delta;
+            return;
+        }
+        case MOVE_ZOOM_OUT:
+        {
+            *x_rend -= *delta * (width  / 2);
+            *y_rend += *delta * (height / 2);
+
+            *delta *= 2;
+            return;
+        }
+        case MOVE_ZOOM_IN:
+        {
+            *delta /= 2;
+
+            *x_rend += *delta * (width  / 2);
+            *y_rend -= *delta * (height / 2);
+            return;
+        }
+        default:
+        {
+            return;
+        }
+    }
+}
+
+void PrefetchInit(Prefetcher *prefetcher, unsigned n_iterations, unsigned pan_pixels)
+{
+    memset(prefetcher, 0, sizeof(Prefetcher));
+
+    prefetcher->n_iterations = n_iterations;
+    prefetcher->pan_pixels   = pan_pixels;
+    prefetcher->last_move    = PREFETCH_N_MOVES;
+
+    pthread_mutex_init(&prefetcher->lock, NULL);
+    pthread_cond_init(&prefetcher->wake, NULL);
+    pthread_create(&prefetcher->thread, NULL, PrefetchWorker, prefetcher);
+}
+
+void PrefetchFree(Prefetcher *prefetcher)
+{
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetcher->quit = true;
+    pthread_cond_signal(&prefetcher->wake);
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    pthread_join(prefetcher->thread, NULL);
+
+    for(unsigned move = 0; move < PREFETCH_N_MOVES; move++)
+    {
+        free(prefetcher->entries[move].counts);
+        free(prefetcher->entries[move].x);
+        free(prefetcher->entries[move].y);
+    }
+
+    pthread_cond_destroy(&prefetcher->wake);
+    pthread_mutex_destroy(&prefetcher->lock);
+}
+
+// The entries still hold the neighbours of the previous view, so the move that led here is the one whose view this is.
+void PrefetchStart(Prefetcher *prefetcher, const PrefetchView *view)
+{
+    pthread_mutex_lock(&prefetcher->lock);
+
+    prefetcher->generation++;
+    prefetcher->running   = true;
+    prefetcher->base      = *view;
+    prefetcher->last_move = PREFETCH_N_MOVES;
+
+    for(unsigned move = 0; move < PREFETCH_N_MOVES; move++)
+    {
+        if(SameView(&prefetcher->entries[move].view, view)) prefetcher->last_move = (ViewMove)move;
+    }
+
+    for(unsigned move = 0; move < PREFETCH_N_MOVES; move++) SetupEntry(prefetcher, prefetcher->entries + move, (ViewMove)move);
+
+    pthread_cond_signal(&prefetcher->wake);
+    pthread_mutex_unlock(&prefetcher->lock);
+}
+
+void PrefetchStop(Prefetcher *prefetcher)
+{
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetcher->generation++;
+    prefetcher->running = false;
+    pthread_mutex_unlock(&prefetcher->lock);
+}
+
+// Fills counts if view is a neighbour of the last started one and all of it is rendered.
+bool PrefetchTake(Prefetcher *prefetcher, const PrefetchView *view, unsigned *counts)
+{
+    bool hit = false;
+
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetcher->n_taken++;
+
+    for(unsigned move = 0; move < PREFETCH_N_MOVES && !hit; move++)
+    {
+        const PrefetchEntry *entry = prefetcher->entries + move;
+        if(entry->view.height == 0 || entry->n_rows < entry->view.height || !SameView(&entry->view, view)) continue;
+
+        memcpy(counts, entry->counts, (size_t)view->width * view->height * sizeof(unsigned));
+        for(unsigned row = 0; row < view->height; row++)
+        {
+            int source = MirrorSource(row, entry->mirror_sum);
+            if(source >= 0) memcpy(counts + (size_t)row * view->width, counts + (size_t)source * view->width, view->width * sizeof(unsigned));
+        }
+
+        hit = true;
+    }
+
+    prefetcher->n_hits += hit;
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    return hit;
+}
+
+// Takes the coordinates of a band under the lock, renders it without, and keeps it only if nothing was started or
+// stopped meanwhile.
+static void *PrefetchWorker(void *prefetcher_p)
+{
+    Prefetcher *prefetcher = (Prefetcher *)prefetcher_p;
+
+    SetIdlePriority();
+
+    float    *x        = NULL;
+    float    *y        = NULL;
+    unsigned *counts   = NULL;
+    size_t    capacity = 0;
+
+    pthread_mutex_lock(&prefetcher->lock);
+    while(!prefetcher->quit)
+    {
+        PrefetchEntry *entry = NextEntry(prefetcher);
+        if(!entry)
+        {
+            pthread_cond_wait(&prefetcher->wake, &prefetcher->lock);
+            continue;
+        }
+
+        unsigned generation = prefetcher->generation;
+        unsigned width      = entry->view.width;
+        unsigned first_row  = entry->n_rows;
+        unsigned n_rows     = (PREFETCH_BAND_PIXELS > width) ? PREFETCH_BAND_PIXELS / width : 1;
+        if(n_rows > entry->view.height - first_row) n_rows = entry->view.height - first_row;
+
+        size_t n_pixels = (size_t)n_rows * width;
+        if(capacity < n_pixels)
+        {
+            x        = (float    *)realloc(x,      n_pixels * sizeof(float));
+            y        = (float    *)realloc(y,      n_pixels * sizeof(float));
+            counts   = (unsigned *)realloc(counts, n_pixels * sizeof(unsigned));
+            capacity = n_pixels;
+        }
+
+        size_t n_points = 0;
+        for(unsigned row = first_row; row < first_row + n_rows; row++)
+        {
+            if(MirrorSource(row, entry->mirror_sum) >= 0) continue;
+
+            for(unsigned column = 0; column < width; column++, n_points++)
+            {
+                x[n_points] = entry->x[column];
+                y[n_points] = entry->y[row];
+            }
+        }
+        unsigned n_iterations = prefetcher->n_iterations;
+
+        pthread_mutex_unlock(&prefetcher->lock);
+        RenderMandelbrotPoints(counts, NULL, x, y, n_points, n_iterations);
+        pthread_mutex_lock(&prefetcher->lock);
+
+        if(generation != prefetcher->generation) continue;
+
+        size_t point = 0;
+        for(unsigned row = first_row; row < first_row + n_rows; row++)
+        {
+            if(MirrorSource(row, entry->mirror_sum) >= 0) continue;
+
+            memcpy(entry->counts + (size_t)row * width, counts + point, width * sizeof(unsigned));
+            point += width;
+        }
+        entry->n_rows += n_rows;
+    }
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    free(counts);
+    free(y);
+    free(x);
+
+    return NULL;
+}
+
+// The last move again first, then pans, then zooming in before zooming out.
+static PrefetchEntry *NextEntry(Prefetcher *prefetcher)
+{
+    if(!prefetcher->running) return NULL;
+
+    if(prefetcher->last_move < PREFETCH_N_MOVES)
+    {
+        PrefetchEntry *entry = prefetcher->entries + prefetcher->last_move;
+        if(entry->n_rows < entry->view.height) return entry;
+    }
+
+    for(unsigned move = 0; move < PREFETCH_N_MOVES; move++)
+    {
+        PrefetchEntry *entry = prefetcher->entries + move;
+        if(entry->n_rows < entry->view.height) return entry;
+    }
+
+    return NULL;
+}
+
+// Called under the lock.
+static void SetupEntry(Prefetcher *prefetcher, PrefetchEntry *entry, ViewMove move)
+{
+    PrefetchView view = prefetcher->base;
+    MoveView(&view.x_rend, &view.y_rend, &view.delta, view.width, view.height, move, prefetcher->pan_pixels);
+
+    float y_offset = 0;
+
+    entry->view       = view;
+    entry->mirror_sum = FindMirrorSum(view.y_rend, view.delta, &y_offset);
+    entry->n_rows     = 0;
+
+    size_t n_pixels = (size_t)view.width * view.height;
+    if(entry->capacity < n_pixels)
+    {
+        entry->counts   = (unsigned *)realloc(entry->counts, n_pixels * sizeof(unsigned));
+        entry->capacity = n_pixels;
+    }
+
+    entry->x = (float *)realloc(entry->x, view.width  * sizeof(float));
+    entry->y = (float *)realloc(entry->y, view.height * sizeof(float));
+    GridCoordinates(entry->x, entry->y, view.width, view.height, view.x_rend, view.y_rend, view.delta);
+}
+
+static inline bool SameView(const PrefetchView *a, const PrefetchView *b)
+{
+    return a->x_rend == b->x_rend && a->y_rend == b->y_rend && a->delta == b->delta && a->width == b->width && a->height == b->height;
+}
+
+// Below every normal thread, so the worker only gets cores nobody else wants.
+static void SetIdlePriority(void)
+{
+#ifdef SCHED_IDLE
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+}
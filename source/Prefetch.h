@@ -0,0 +1,88 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+// Speculative rendering of the views the viewer is likely to show next, while it waits for input. From any view the
+// keys lead to one of PREFETCH_N_MOVES others: four pans by pan_pixels and the zooms by 2. After a frame is shown,
+// PrefetchStart hands its view to a worker thread at the lowest priority (SCHED_IDLE where there is one), which renders
+// every neighbour as a whole frame, the one the last move would lead to first, since keys are often held. The worker
+// renders PREFETCH_BAND_PIXELS at a time and drops its work at the end of a band once PrefetchStop or PrefetchStart has
+// been called, so real work never waits more than a band for it.
+//
+// Only the plain escape counts of the Mandelbrot set with the [8 x float] kernel are speculated on. Every neighbour
+// gets the coordinates of GridCoordinates and so the same counts as RenderMandelbrotCounts. A pan is not shifted from
+// the frame shown: the coordinates of the new view differ from the old ones by the rounding of x_rend and y_rend, and
+// over a series of pans the shifted counts drift away from a fresh render.
+
+const unsigned PREFETCH_BAND_PIXELS = 16384;
+
+enum ViewMove
+{
+    MOVE_LEFT,
+    MOVE_RIGHT,
+    MOVE_UP,
+    MOVE_DOWN,
+    MOVE_ZOOM_IN,
+    MOVE_ZOOM_OUT,
+    PREFETCH_N_MOVES,
+};
+
+struct PrefetchView
+{
+    float    x_rend;
+    float    y_rend;
+    float    delta;
+    unsigned width;
+    unsigned height;
+};
+
+// One neighbour; x and y are the coordinates of every column and row of its view. Rows that mirror others across the
+// real axis are skipped by the worker and copied by PrefetchTake, as RenderMandelbrotCounts does with mirror on.
+struct PrefetchEntry
+{
+    PrefetchView view;
+    int          mirror_sum;
+
+    unsigned *counts;
+    float    *x;
+    float    *y;
+    size_t    capacity;  // pixels counts has room for
+
+    unsigned n_rows;     // rows rendered so far
+};
+
+struct Prefetcher
+{
+    pthread_t       thread;
+    pthread_mutex_t lock;  // guards everything below
+    pthread_cond_t  wake;
+
+    unsigned n_iterations;
+    unsigned pan_pixels;
+
+    unsigned generation;   // changed by PrefetchStart and PrefetchStop, bands of an older one are dropped
+    bool     running;      // the entries are worth rendering
+    bool     quit;
+
+    PrefetchView base;       // the frame shown
+    ViewMove     last_move;  // the move that led to it, PREFETCH_N_MOVES if none did
+
+    PrefetchEntry entries[PREFETCH_N_MOVES];
+
+    size_t n_taken;
+    size_t n_hits;
+};
+
+const char *MoveName(ViewMove move);
+void MoveView(float *x_rend, float *y_rend, float *delta, unsigned width, unsigned height, ViewMove move, unsigned pan_pixels);
+
+void PrefetchInit(Prefetcher *prefetcher, unsigned n_iterations, unsigned pan_pixels);
+void PrefetchFree(Prefetcher *prefetcher);
+
+void PrefetchStart(Prefetcher *prefetcher, const PrefetchView *view);
+void PrefetchStop(Prefetcher *prefetcher);
+bool PrefetchTake(Prefetcher *prefetcher, const PrefetchView *view, unsigned *counts);
+
+#endif // PREFETCH_H
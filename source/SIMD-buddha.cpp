@@ -0,0 +1,330 @@
+#include <immintrin.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Image.h"
+#include "Mandelbrot.h"
+
+// Buddhabrot: instead of coloring c by its escape count, every point z_1 ... z_n of the orbit of an escaping c is
+// counted in a histogram over the same plane. The orbit of the conjugate of c is the conjugate of the orbit of c, so only
+// c with y >= 0 are sampled and the histogram is folded onto its mirror image at the end.
+const float VIEW_X_MIN = -2.0f;
+const float VIEW_X_MAX =  1.0f;
+const float VIEW_Y_MAX =  1.5f;
+
+const unsigned MAX_THREADS = 256;
+
+struct BuddhaOptions
+{
+    unsigned width;
+    unsigned height;
+
+    double   n_samples;
+    unsigned n_iterations;
+    unsigned min_iterations; // orbits escaping sooner are not plotted
+    unsigned n_threads;
+
+    const char *output;
+};
+
+// One thread's share of the samples. Every thread writes only to its own histogram, so the hot loop needs no atomics;
+// histograms are summed after all threads are joined.
+struct BuddhaTask
+{
+    const BuddhaOptions *options;
+
+    size_t    n_samples;
+    uint32_t  seed;
+    uint32_t *histogram;
+
+    size_t n_orbits;
+    size_t n_points;
+};
+
+bool ParseOptions(BuddhaOptions *options, int argc, const char *argv[]);
+void *TraceOrbits(void *task_p);
+
+inline size_t PlotOrbits(uint32_t *histogram, const BuddhaOptions *options, __v8sf x_0, __v8sf y_0, __v8si n_escape, __m256i plot);
+inline __m256i InsideBulbs(__v8sf x_0, __v8sf y_0);
+inline __v8sf RandomFloats(__v8su *state);
+
+int main(int argc, const char *argv[])
+{
+// ================================================================================================================================================================================
+    long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    BuddhaOptions options = {1000, 1000, 1e7, 1000, 0, (unsigned)((n_cpus > 0) ? n_cpus : 1), NULL};
+    if(!ParseOptions(&options, argc, argv))
+    {
+        fprintf(stderr,
+                "usage: %s [options] output.ppm|output.png\n"
+                "  --width N --height N   image size (1000x1000)\n"
+                "  --samples N            random c values in total (1e7)\n"
+                "  --iterations N         iteration limit (1000)\n"
+                "  --min N                shortest orbit to plot (0)\n"
+                "  --threads N            worker threads (one per CPU)\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t n_pixels = (size_t)options.width * options.height;
+// ================================================================================================================================================================================
+    BuddhaTask *tasks   = (BuddhaTask *)calloc(options.n_threads, sizeof(BuddhaTask));
+    pthread_t  *threads = (pthread_t  *)calloc(options.n_threads, sizeof(pthread_t));
+
+    size_t n_samples = (size_t)options.n_samples;
+    for(unsigned i = 0; i < options.n_threads; i++)
+    {
+        tasks[i].options   = &options;
+        tasks[i].n_samples = n_samples / options.n_threads + (i < n_samples % options.n_threads);
+        tasks[i].seed      = 0x9E3779B9u * (i + 1);
+        tasks[i].histogram = (uint32_t *)calloc(n_pixels, sizeof(uint32_t));
+    }
+
+    timespec start_ts = {};
+    timespec end_ts   = {};
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
+
+    for(unsigned i = 0; i < options.n_threads; i++) pthread_create(threads + i, NULL, TraceOrbits, tasks + i);
+    for(unsigned i = 0; i < options.n_threads; i++) pthread_join(threads[i], NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &end_ts);
+    double elapsed_s = (end_ts.tv_sec - start_ts.tv_sec) + (end_ts.tv_nsec - start_ts.tv_nsec) * 1e-9;
+// ================================================================================================================================================================================
+    uint32_t *histogram = tasks[0].histogram;
+    size_t    n_orbits  = tasks[0].n_orbits;
+    size_t    n_points  = tasks[0].n_points;
+    for(unsigned i = 1; i < options.n_threads; i++)
+    {
+        for(size_t pix = 0; pix < n_pixels; pix++) histogram[pix] += tasks[i].histogram[pix];
+
+        n_orbits += tasks[i].n_orbits;
+        n_points += tasks[i].n_points;
+    }
+
+    // Fold onto the mirror image and map the density through a square root, so the faint outer orbits stay visible.
+    uint32_t max_density = 1;
+    for(unsigned y_pos = 0; y_pos < (options.height + 1) / 2; y_pos++)
+    {
+        uint32_t *row    = histogram + (size_t)y_pos * options.width;
+        uint32_t *mirror = histogram + (size_t)(options.height - 1 - y_pos) * options.width;
+        for(unsigned x_pos = 0; x_pos < options.width; x_pos++)
+        {
+            uint32_t density = (row == mirror) ? 2 * row[x_pos] : row[x_pos] + mirror[x_pos];
+            row[x_pos] = mirror[x_pos] = density;
+
+            if(density > max_density) max_density = density;
+        }
+    }
+
+    uint8_t *pixels = (uint8_t *)calloc(n_pixels, 4 * sizeof(uint8_t));
+    for(size_t pix = 0; pix < n_pixels; pix++)
+    {
+        uint8_t value = (uint8_t)(255 * sqrtf((float)histogram[pix] / max_density));
+
+        pixels[4 * pix + 0] = value;
+        pixels[4 * pix + 1] = value;
+        pixels[4 * pix + 2] = value;
+        pixels[4 * pix + 3] = 255;
+    }
+
+    const char *extension = strrchr(options.output, '.');
+    FILE       *stream    = fopen(options.output, "wb");
+    if(!stream)
+    {
+        perror(options.output);
+        return EXIT_FAILURE;
+    }
+
+    if(extension && strcmp(extension, ".png") == 0) WritePNG(stream, pixels, options.width, options.height);
+    else WritePPM(stream, pixels, options.width, options.height);
+
+    bool written = (fclose(stream) == 0);
+
+    printf("%zu samples, %zu orbits plotted (%.2lf%%), %zu points, %u threads: %.2lf s\n",
+           n_samples, n_orbits, 100.0 * n_orbits / n_samples, n_points, options.n_threads, elapsed_s);
+    printf("%.2lf M samples/s, %.3lf M orbits/s, %.1lf M points/s\n",
+           n_samples * 1e-6 / elapsed_s, n_orbits * 1e-6 / elapsed_s, n_points * 1e-6 / elapsed_s);
+// ================================================================================================================================================================================
+    for(unsigned i = 0; i < options.n_threads; i++) free(tasks[i].histogram);
+
+    free(pixels);
+    free(threads);
+    free(tasks);
+
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+// ================================================================================================================================================================================
+}
+
+bool ParseOptions(BuddhaOptions *options, int argc, const char *argv[])
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char *arg   = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(arg[0] != '-')
+        {
+            if(options->output) return false;
+            options->output = arg;
+            continue;
+        }
+
+        if(!value) return false;
+        i++;
+
+        char *end = NULL;
+        if     (strcmp(arg, "--width")      == 0) options->width          = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--height")     == 0) options->height         = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--samples")    == 0) options->n_samples      = strtod(value, &end);
+        else if(strcmp(arg, "--iterations") == 0) options->n_iterations   = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--min")        == 0) options->min_iterations = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--threads")    == 0) options->n_threads      = (unsigned)strtoul(value, &end, 10);
+        else return false;
+
+        if(end == value || *end != '\0') return false;
+    }
+
+    if(options->n_threads > MAX_THREADS) options->n_threads = MAX_THREADS;
+
+    return options->output && options->width > 0 && options->height > 0 && options->n_samples >= 1 &&
+           options->n_iterations > options->min_iterations && options->n_threads > 0;
+}
+
+// Samples c uniformly in a vector of 8, finds which of them escape, and traces the orbits of the escaping ones again to
+// plot them. The orbits are not kept from the first pass: they would need n_iterations points per lane, while tracing
+// twice costs only as much as the first pass for the few samples that escape.
+void *TraceOrbits(void *task_p)
+{
+    BuddhaTask          *task    = (BuddhaTask *)task_p;
+    const BuddhaOptions *options = task->options;
+
+    __v8su state = {};
+    for(unsigned lane = 0; lane < 8; lane++)
+    {
+        uint32_t seed = task->seed ^ (0x85EBCA6Bu * (lane + 1));
+        state[lane] = seed ? seed : 1;
+    }
+
+    __v8sf x_scale = _mm256_set1_ps(VIEW_X_MAX - VIEW_X_MIN);
+    __v8sf x_min   = _mm256_set1_ps(VIEW_X_MIN);
+    __v8sf y_scale = _mm256_set1_ps(VIEW_Y_MAX);
+
+    __v8si n_max = (__v8si)_mm256_set1_epi32((int)options->n_iterations);
+    __v8si n_min = (__v8si)_mm256_set1_epi32((int)options->min_iterations);
+
+    for(size_t sample = 0; sample < task->n_samples; sample += 8)
+    {
+        __v8sf x_0 = RandomFloats(&state) * x_scale + x_min;
+        __v8sf y_0 = RandomFloats(&state) * y_scale;
+
+        // The main cardioid and the period 2 bulb never escape and would run the whole iteration limit.
+        __m256i outside = ~InsideBulbs(x_0, y_0);
+        if(sample + 8 > task->n_samples) outside &= (__m256i)(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0) < (int)(task->n_samples - sample));
+        if(_mm256_testz_si256(outside, outside)) continue;
+
+        // The escape pass is the library's own loop: the vector goes through RenderMandelbrotPoints as a list of 8 points.
+        alignas(32) float    x_start[8]  = {};
+        alignas(32) float    y_start[8]  = {};
+        alignas(32) unsigned n_escape[8] = {};
+        _mm256_store_ps(x_start, _mm256_blendv_ps(_mm256_set1_ps(2 * MAX_ZERO_OFFSET), x_0, (__m256)outside));
+        _mm256_store_ps(y_start, y_0);
+
+        RenderMandelbrotPoints(n_escape, NULL, x_start, y_start, 8, options->n_iterations);
+        __v8si n = (__v8si)_mm256_load_si256((const __m256i *)n_escape);
+
+        __m256i plot = outside & (__m256i)(n < n_max) & (__m256i)(n >= n_min);
+        if(_mm256_testz_si256(plot, plot)) continue;
+
+        task->n_orbits += __builtin_popcount(_mm256_movemask_ps((__m256)plot));
+        task->n_points += PlotOrbits(task->histogram, options, x_0, y_0, n, plot);
+    }
+
+    return NULL;
+}
+
+// Runs the orbits again for as long as the longest plotted lane lives and counts z_1 ... z_n of every plotted lane in
+// its pixel. AVX2 has no scatter, so pixel indices are computed in vectors and incremented one by one; lanes of one
+// vector may hit the same pixel, which a scatter would have to resolve as well.
+inline size_t PlotOrbits(uint32_t *histogram, const BuddhaOptions *options, __v8sf x_0, __v8sf y_0, __v8si n_escape, __m256i plot)
+{
+    __v8sf width_v  = _mm256_set1_ps((float)options->width);
+    __v8sf height_v = _mm256_set1_ps((float)options->height);
+    __v8sf x_factor = width_v  / (VIEW_X_MAX - VIEW_X_MIN);
+    __v8sf y_factor = height_v / (2 * VIEW_Y_MAX);
+    __v8si width_i  = (__v8si)_mm256_set1_epi32((int)options->width);
+
+    n_escape = (__v8si)((__m256i)n_escape & plot);
+
+    int n_steps = 0;
+    for(unsigned lane = 0; lane < 8; lane++)
+    {
+        if(n_escape[lane] > n_steps) n_steps = n_escape[lane];
+    }
+
+    __v8sf x_n = {};
+    __v8sf y_n = {};
+
+    size_t n_points = 0;
+    alignas(32) int index[8] = {};
+    for(int i = 0; i < n_steps; i++)
+    {
+        __v8sf x2 = x_n * x_n;
+        __v8sf y2 = y_n * y_n;
+        __v8sf xy = x_n * y_n;
+
+        x_n = x2 - y2 + x_0;
+        y_n = xy + xy + y_0;
+
+        __v8sf x_pix = (x_n - VIEW_X_MIN) * x_factor;
+        __v8sf y_pix = (VIEW_Y_MAX - y_n) * y_factor;
+
+        __m256i in_view = (__m256i)(n_escape > i) & (__m256i)(x_pix >= 0) & (__m256i)(x_pix < width_v) &
+                                                   (__m256i)(y_pix >= 0) & (__m256i)(y_pix < height_v);
+
+        unsigned mask = _mm256_movemask_ps((__m256)in_view);
+        if(mask == 0) continue;
+
+        __v8si pix = (__v8si)_mm256_cvttps_epi32(y_pix) * width_i + (__v8si)_mm256_cvttps_epi32(x_pix);
+        _mm256_store_si256((__m256i *)index, (__m256i)pix);
+
+        n_points += __builtin_popcount(mask);
+        while(mask)
+        {
+            histogram[index[__builtin_ctz(mask)]]++;
+            mask &= mask - 1;
+        }
+    }
+
+    return n_points;
+}
+
+// Lanes with c in the main cardioid or in the disc of period 2, both known to be inside the set.
+inline __m256i InsideBulbs(__v8sf x_0, __v8sf y_0)
+{
+    __v8sf y2 = y_0 * y_0;
+
+    __v8sf x_c = x_0 - 0.25f;
+    __v8sf q   = x_c * x_c + y2;
+    __v8sf x_b = x_0 + 1;
+
+    return (__m256i)(q * (q + x_c) <= 0.25f * y2) | (__m256i)(x_b * x_b + y2 <= 0.0625f);
+}
+
+// Eight xorshift32 generators, one per lane. The top 23 bits make the mantissa of a float in [1, 2).
+inline __v8sf RandomFloats(__v8su *state)
+{
+    __v8su x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return (__v8sf)((x >> 9) | 0x3F800000u) - 1.0f;
+}
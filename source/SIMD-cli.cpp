@@ -0,0 +1,327 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "DeepZoom.h"
+#include "Equalize.h"
+#include "Image.h"
+#include "Mandelbrot.h"
+#include "TileCodec.h"
+
+enum Coloring
+{
+    COLORING_PLAIN,
+    COLORING_SMOOTH,
+    COLORING_AA,
+    COLORING_DISTANCE,
+    COLORING_EQUALIZED,
+};
+
+enum ImageFormat
+{
+    FORMAT_PPM,
+    FORMAT_PNG,
+    FORMAT_COUNTS,
+    FORMAT_ENCODED,
+};
+
+// What to render and where to write it. The view is given by its center and its extent along the longer side, so
+// the defaults give the same picture as the viewer at any resolution.
+struct RenderOptions
+{
+    unsigned width;
+    unsigned height;
+
+    double center_x;
+    double center_y;
+    double span;
+
+    FixedPoint center_x_fixed;  // the center with all digits given, for the deep zoom kernels
+    FixedPoint center_y_fixed;
+
+    unsigned n_iterations;
+    bool     high_precision;
+    bool     double_double;
+    unsigned n_limbs;           // fixed-point kernel with this many limbs, 0 for none
+
+    Fractal fractal;
+
+    Coloring    coloring;
+    ImageFormat format;
+    const char *output;
+};
+
+bool ParseOptions(RenderOptions *options, int argc, const char *argv[]);
+void PrintUsage(const char *program);
+
+int main(int argc, const char *argv[])
+{
+// ================================================================================================================================================================================
+    RenderOptions options = {1920, 1080, 0, 0, 2 * MAX_ZERO_OFFSET, {}, {}, 255, false, false, 0, {FRACTAL_MANDELBROT, 0, 0}, COLORING_PLAIN, FORMAT_PPM, NULL};
+    if(!ParseOptions(&options, argc, argv))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    unsigned width  = options.width;
+    unsigned height = options.height;
+
+    double delta  = options.span / ((width > height) ? width : height);
+    double x_rend = options.center_x - delta * (width  / 2);
+    double y_rend = options.center_y + delta * (height / 2);
+
+    // The offset from the center to the top left pixel is small enough to be exact in a double at any depth.
+    FixedPoint x_rend_fixed = FixedSub(options.center_x_fixed, FixedFromDouble(delta * (width  / 2)));
+    FixedPoint y_rend_fixed = FixedAdd(options.center_y_fixed, FixedFromDouble(delta * (height / 2)));
+// ================================================================================================================================================================================
+    size_t n_pixels = (size_t)width * height;
+
+    uint8_t  *pixels   = (uint8_t  *)calloc(n_pixels, 4 * sizeof(uint8_t));
+    unsigned *counts   = (unsigned *)calloc(n_pixels, sizeof(unsigned));
+    unsigned *edges    = (unsigned *)calloc(n_pixels, sizeof(unsigned));
+    float    *r2       = (float    *)calloc(n_pixels, sizeof(float));
+    float    *distance = (float    *)calloc(n_pixels, sizeof(float));
+// ================================================================================================================================================================================
+    timespec start_ts = {};
+    timespec end_ts   = {};
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
+
+    Fractal fractal = options.fractal;
+    bool to_counts = (options.format == FORMAT_COUNTS || options.format == FORMAT_ENCODED);
+
+    long     n_cpus    = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned n_threads = (unsigned)((n_cpus > 0) ? n_cpus : 1);
+
+    if(options.n_limbs != 0 || options.double_double)
+    {
+        if(options.n_limbs != 0) RenderMandelbrotFixedCounts(counts, width, height, x_rend_fixed, y_rend_fixed, delta, options.n_limbs, options.n_iterations);
+        else RenderMandelbrotDoubleDoubleCounts(counts, width, height, FixedToDoubleDouble(x_rend_fixed), FixedToDoubleDouble(y_rend_fixed), delta,
+                                                options.n_iterations);
+
+        if(!to_counts && options.coloring == COLORING_EQUALIZED) ColorMandelbrotEqualized(pixels, counts, n_pixels, options.n_iterations, n_threads);
+        else if(!to_counts) ColorMandelbrot(pixels, counts, n_pixels);
+    }
+    else if(to_counts || options.coloring == COLORING_EQUALIZED)
+    {
+        if(options.high_precision) RenderFractalCounts(counts, width, height, x_rend, y_rend, delta, options.n_iterations, fractal, true);
+        else RenderFractalCounts(counts, width, height, (float)x_rend, (float)y_rend, (float)delta, options.n_iterations, fractal, true);
+
+        if(!to_counts) ColorMandelbrotEqualized(pixels, counts, n_pixels, options.n_iterations, n_threads);
+    }
+    else if(options.coloring == COLORING_AA)
+    {
+        RenderMandelbrotAA(pixels, counts, edges, width, height, (float)x_rend, (float)y_rend, (float)delta, options.n_iterations);
+    }
+    else if(options.coloring == COLORING_SMOOTH)
+    {
+        if(options.high_precision) RenderMandelbrotSmooth(pixels, counts, r2, width, height, x_rend, y_rend, delta, options.n_iterations, true);
+        else RenderMandelbrotSmooth(pixels, counts, r2, width, height, (float)x_rend, (float)y_rend, (float)delta, options.n_iterations, true);
+    }
+    else if(options.coloring == COLORING_DISTANCE)
+    {
+        if(options.high_precision) RenderMandelbrotDistance(pixels, counts, distance, width, height, x_rend, y_rend, delta, options.n_iterations, true);
+        else RenderMandelbrotDistance(pixels, counts, distance, width, height, (float)x_rend, (float)y_rend, (float)delta, options.n_iterations, true);
+    }
+    else
+    {
+        if(options.high_precision) RenderFractal(pixels, width, height, x_rend, y_rend, delta, options.n_iterations, fractal);
+        else RenderFractal(pixels, width, height, (float)x_rend, (float)y_rend, (float)delta, options.n_iterations, fractal);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_ts);
+    double elapsed_ms = (end_ts.tv_sec - start_ts.tv_sec) * 1e3 + (end_ts.tv_nsec - start_ts.tv_nsec) * 1e-6;
+// ================================================================================================================================================================================
+    bool  to_stdout = (strcmp(options.output, "-") == 0);
+    FILE *stream    = to_stdout ? stdout : fopen(options.output, "wb");
+    if(!stream)
+    {
+        perror(options.output);
+        return EXIT_FAILURE;
+    }
+
+    switch(options.format)
+    {
+        case FORMAT_PPM:     WritePPM(stream, pixels, width, height);           break;
+        case FORMAT_PNG:     WritePNG(stream, pixels, width, height);           break;
+        case FORMAT_COUNTS:  WriteCounts(stream, counts, width, height);        break;
+        case FORMAT_ENCODED: WriteEncodedCounts(stream, counts, width, height); break;
+    }
+
+    bool written = !ferror(stream);
+    if(!to_stdout) written = (fclose(stream) == 0) && written;
+
+    char kernel[32] = "[8 x float]";
+    if     (options.n_limbs != 0)    snprintf(kernel, sizeof(kernel), "%u-limb fixed point", options.n_limbs);
+    else if(options.double_double)   snprintf(kernel, sizeof(kernel), "double-double");
+    else if(options.high_precision)  snprintf(kernel, sizeof(kernel), "[4 x double]");
+
+    fprintf(stderr, "%s %ux%u, %u iterations, %s: %.1lf ms\n", FractalName(fractal.type), width, height, options.n_iterations, kernel, elapsed_ms);
+// ================================================================================================================================================================================
+    free(distance);
+    free(r2);
+    free(edges);
+    free(counts);
+    free(pixels);
+
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+// ================================================================================================================================================================================
+}
+
+// Fills options from the command line, returns false on anything it does not understand. Without --format the format
+// is taken from the extension of the output file (.png, .counts, .zcounts, anything else is PPM). With --limbs or
+// --double-double, --x and --y are also read with all their digits for the deep zoom kernels; the other kernels take
+// anything strtod does.
+bool ParseOptions(RenderOptions *options, int argc, const char *argv[])
+{
+    bool format_set = false;
+
+    const char *x_text = NULL;
+    const char *y_text = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char *arg   = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(arg[0] != '-' || strcmp(arg, "-") == 0)
+        {
+            if(options->output) return false;
+            options->output = arg;
+            continue;
+        }
+
+        if(strcmp(arg, "--double") == 0)
+        {
+            options->high_precision = true;
+            continue;
+        }
+
+        if(strcmp(arg, "--double-double") == 0)
+        {
+            options->double_double = true;
+            continue;
+        }
+
+        if(!value) return false;
+        i++;
+
+        char *end = NULL;
+        if     (strcmp(arg, "--width")      == 0) options->width        = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--height")     == 0) options->height       = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--x")          == 0) options->center_x     = strtod(value, &end);
+        else if(strcmp(arg, "--y")          == 0) options->center_y     = strtod(value, &end);
+        else if(strcmp(arg, "--limbs")      == 0) options->n_limbs      = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--span")       == 0) options->span         = strtod(value, &end);
+        else if(strcmp(arg, "--iterations") == 0) options->n_iterations = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--cx")         == 0) options->fractal.c_x  = strtod(value, &end);
+        else if(strcmp(arg, "--cy")         == 0) options->fractal.c_y  = strtod(value, &end);
+        else if(strcmp(arg, "--fractal")    == 0)
+        {
+            if     (strcmp(value, "mandelbrot") == 0) options->fractal.type = FRACTAL_MANDELBROT;
+            else if(strcmp(value, "julia")      == 0) options->fractal.type = FRACTAL_JULIA;
+            else if(strcmp(value, "ship")       == 0) options->fractal.type = FRACTAL_BURNING_SHIP;
+            else if(strcmp(value, "multibrot3") == 0) options->fractal.type = FRACTAL_MULTIBROT3;
+            else if(strcmp(value, "multibrot4") == 0) options->fractal.type = FRACTAL_MULTIBROT4;
+            else return false;
+            continue;
+        }
+        else if(strcmp(arg, "--coloring")   == 0)
+        {
+            if     (strcmp(value, "plain")  == 0) options->coloring = COLORING_PLAIN;
+            else if(strcmp(value, "smooth") == 0) options->coloring = COLORING_SMOOTH;
+            else if(strcmp(value, "aa")     == 0) options->coloring = COLORING_AA;
+            else if(strcmp(value, "distance") == 0) options->coloring = COLORING_DISTANCE;
+            else if(strcmp(value, "equalized") == 0) options->coloring = COLORING_EQUALIZED;
+            else return false;
+            continue;
+        }
+        else if(strcmp(arg, "--format") == 0)
+        {
+            if     (strcmp(value, "ppm")     == 0) options->format = FORMAT_PPM;
+            else if(strcmp(value, "png")     == 0) options->format = FORMAT_PNG;
+            else if(strcmp(value, "counts")  == 0) options->format = FORMAT_COUNTS;
+            else if(strcmp(value, "zcounts") == 0) options->format = FORMAT_ENCODED;
+            else return false;
+            format_set = true;
+            continue;
+        }
+        else return false;
+
+        if(end == value || *end != '\0') return false;
+
+        if(strcmp(arg, "--x") == 0) x_text = value;
+        if(strcmp(arg, "--y") == 0) y_text = value;
+    }
+
+    if(!options->output || options->width == 0 || options->height == 0 || options->n_iterations == 0 || !(options->span > 0)) return false;
+
+    if(options->n_limbs != 0 && (options->n_limbs < FIXED_MIN_LIMBS || options->n_limbs > FIXED_MAX_LIMBS))
+    {
+        fprintf(stderr, "--limbs takes %u to %u\n", FIXED_MIN_LIMBS, FIXED_MAX_LIMBS);
+        return false;
+    }
+
+    if((options->n_limbs != 0 || options->double_double) &&
+       (options->fractal.type != FRACTAL_MANDELBROT || (options->coloring != COLORING_PLAIN && options->coloring != COLORING_EQUALIZED)))
+    {
+        fprintf(stderr, "the deep zoom kernels only render the Mandelbrot set with plain or equalized coloring\n");
+        return false;
+    }
+
+    if((options->n_limbs != 0 || options->double_double) && ((x_text && !ParseFixed(x_text, &options->center_x_fixed)) ||
+                                                             (y_text && !ParseFixed(y_text, &options->center_y_fixed))))
+    {
+        fprintf(stderr, "the deep zoom kernels take --x and --y as plain decimals with |x|, |y| < 8\n");
+        return false;
+    }
+
+    if(options->coloring == COLORING_AA && options->high_precision)
+    {
+        fprintf(stderr, "anti-aliasing is only implemented for [8 x float]\n");
+        return false;
+    }
+
+    if(options->coloring != COLORING_PLAIN && options->coloring != COLORING_EQUALIZED && options->fractal.type != FRACTAL_MANDELBROT && options->format != FORMAT_COUNTS &&
+       options->format != FORMAT_ENCODED)
+    {
+        fprintf(stderr, "smooth, distance coloring and anti-aliasing are only implemented for the Mandelbrot set\n");
+        return false;
+    }
+
+    if(!format_set)
+    {
+        const char *extension = strrchr(options->output, '.');
+        if     (extension && strcmp(extension, ".png")     == 0) options->format = FORMAT_PNG;
+        else if(extension && strcmp(extension, ".counts")  == 0) options->format = FORMAT_COUNTS;
+        else if(extension && strcmp(extension, ".zcounts") == 0) options->format = FORMAT_ENCODED;
+    }
+
+    return true;
+}
+
+void PrintUsage(const char *program)
+{
+    fprintf(stderr,
+            "usage: %s [options] output\n"
+            "  --width N        image width in pixels (1920)\n"
+            "  --height N       image height in pixels (1080)\n"
+            "  --x X --y Y      center of the view (0, 0)\n"
+            "  --span S         extent of the view along the longer side (4)\n"
+            "  --iterations N   iteration limit (255)\n"
+            "  --double         use the [4 x double] kernel\n"
+            "  --double-double  use the double-double kernel, about 32 digits\n"
+            "  --limbs N        use the fixed-point kernel with N = 2, 3 or 4 64-bit limbs, about 37, 56 or 75 digits;\n"
+            "                   --x and --y are read with all their digits, |x|, |y| < 8\n"
+            "  --fractal F      mandelbrot, julia, ship (Burning Ship), multibrot3 or multibrot4 (mandelbrot)\n"
+            "  --cx X --cy Y    fixed c of the Julia set (0, 0)\n"
+            "  --coloring C     plain, smooth, aa, distance: grey by the distance estimate, or equalized: palette by\n"
+            "                   histogram equalization of the counts, on one thread per CPU (plain)\n"
+            "  --format F       ppm, png or counts: raw native-endian uint32 escape counts, row after row,\n"
+            "                   or zcounts: the same compressed (TileCodec.h)\n"
+            "output may be - for stdout\n",
+            program);
+}
@@ -1,26 +1,47 @@
+#ifdef RENDER
 #include "SFML/Graphics.hpp"
 #include "SFML/Window.hpp"
 #include "SFML/System.hpp"
+#endif
 
-#include <immintrin.h>
 #include <inttypes.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "DeepZoom.h"
+#include "FrameBudget.h"
+#include "Mandelbrot.h"
+#include "PerfCounters.h"
+#include "Telemetry.h"
+
 const unsigned SCREEN_WIDTH  = 400;
 const unsigned SCREEN_HEIGHT = 400;
 
 const unsigned PIXELS_PER_OFFSET = 20;
-const double MAX_ZERO_OFFSET     = 2;
 
-inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, double &x_rend, double &y_rend, double &delta, bool &to_render);
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, double x_rend, double y_rend, double delta);
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels);
+const unsigned N_ITERATIONS = 1023;
+
+const double   FRAME_BUDGET_MS = 16;
+const unsigned VECTOR_LANES    = 4;
 
-inline int64_t TimeCounter(void);
-void TestSIMDHigh(sf::Uint8 *pixels, double x_rend, double y_rend, double delta);
+#ifdef RENDER
+inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, double &x_rend, double &y_rend, double &delta, unsigned &width, unsigned &height,
+                         bool &to_render, bool &smooth, bool &budget_mode, bool &show_stats, Fractal &fractal);
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels, unsigned width, unsigned height, unsigned scale);
+#endif
 
-int main(void)
+void TestSIMDHigh(uint8_t *pixels, double x_rend, double y_rend, double delta);
+void TestSmoothColoring(uint8_t *pixels, double x_rend, double y_rend, double delta);
+bool TestSymmetry(double x_rend, double y_rend, double delta);
+bool TestResolution(double x_rend, double y_rend, double delta);
+void TestFractals(void);
+bool TestFrameBudget(double budget_ms);
+void TestDeepZoom(void);
+int CompareDoubles(const void *first, const void *second);
+
+int main(int argc, const char *argv[])
 {
 // ================================================================================================================================================================================
     double ratio       = (double)SCREEN_HEIGHT / (double)SCREEN_WIDTH;
@@ -30,59 +51,183 @@ int main(void)
     double x_rend = -MAX_ZERO_OFFSET;
     double y_rend = MAX_ZERO_OFFSET * ratio;
 // ================================================================================================================================================================================
-    sf::Uint8 *pixels = (sf::Uint8 *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(sf::Uint8));
-    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(sf::Uint8)));
+    uint8_t *pixels = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(uint8_t));
+    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(uint8_t)));
+    bool passed = true;
 // ================================================================================================================================================================================
 #ifndef RENDER
     TestSIMDHigh(pixels, x_rend, y_rend, delta);
+    TestSmoothColoring(pixels, x_rend, y_rend, delta);
+    passed &= TestSymmetry(x_rend, y_rend, delta);
+    passed &= TestResolution(x_rend, y_rend, delta);
+    TestFractals();
+    passed &= TestFrameBudget(FRAME_BUDGET_MS);
+    passed &= TestFrameBudget(FRAME_BUDGET_MS / 8);
+    TestDeepZoom();
 #else
     bool to_render = true;
+    bool smooth    = false;
+
+    Fractal fractal = {FRACTAL_MANDELBROT, 0, 0};
+
+    // --budget MS starts in frame-time budget mode, B switches it on and off. T shows the statistics of every frame in
+    // the window title, --csv FILE also writes them to a file.
+    double budget_ms   = FRAME_BUDGET_MS;
+    bool   budget_mode = false;
+    bool   show_stats  = false;
+    FILE  *csv         = NULL;
+    for(int i = 1; i + 1 < argc; i += 2)
+    {
+        if(strcmp(argv[i], "--budget") == 0 && atof(argv[i + 1]) > 0)
+        {
+            budget_ms   = atof(argv[i + 1]);
+            budget_mode = true;
+        }
+        else if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = OpenTelemetryCSV(argv[i + 1]);
+            if(!csv) return EXIT_FAILURE;
+        }
+    }
+
+    size_t n_frames  = 0;
+    double launch_ms = FrameClockMs();
+    bool   had_stats = false;
 
-    sf::RenderWindow window(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), "");
+    char title[TELEMETRY_TITLE_SIZE] = "";
+
+    FrameBudget budget = {};
+    FrameBudgetInit(&budget, budget_ms, N_ITERATIONS, VECTOR_LANES);
+
+    double last_input_ms  = 0;
+    bool   frame_degraded = false;
+
+    unsigned width  = SCREEN_WIDTH;
+    unsigned height = SCREEN_HEIGHT;
+
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    float    *r2     = (float    *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(float));
+
+    sf::RenderWindow window(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), FractalName(fractal.type));
     do {
+        unsigned old_width  = width;
+        unsigned old_height = height;
+
         sf::Event event;
         while(window.pollEvent(event))
         {
-            ProcessEvent(window, event, x_rend, y_rend, delta, to_render);
+            ProcessEvent(window, event, x_rend, y_rend, delta, width, height, to_render, smooth, budget_mode, show_stats, fractal);
+        }
+
+        // A frame cut down to fit the budget is rendered again at full quality once the input stops.
+        double now_ms = FrameClockMs();
+        bool   refine = false;
+        if(to_render)
+        {
+            last_input_ms = now_ms;
+        }
+        else if(frame_degraded && now_ms - last_input_ms > BUDGET_IDLE_MS)
+        {
+            to_render = true;
+            refine    = true;
         }
 
-        if(!to_render) continue;
+        if(width != old_width || height != old_height)
+        {
+            size_t n_pixels = (size_t)width * height;
+
+            pixels = (uint8_t  *)realloc(pixels, n_pixels * 4 * sizeof(uint8_t));
+            counts = (unsigned *)realloc(counts, n_pixels * sizeof(unsigned));
+            r2     = (float    *)realloc(r2,     n_pixels * sizeof(float));
+        }
 
-        RenderMandelbrot(pixels, x_rend, y_rend, delta);
-        DrawMandelbrot(window, pixels);
+        if(!to_render || width == 0 || height == 0) continue;
+
+        unsigned scale        = 1;
+        unsigned n_iterations = N_ITERATIONS;
+        if(budget_mode && !refine)
+        {
+            scale        = budget.scale;
+            n_iterations = budget.n_iterations;
+        }
+
+        unsigned frame_width  = (width  + scale - 1) / scale;
+        unsigned frame_height = (height + scale - 1) / scale;
+        double   frame_delta  = delta * scale;
+        double   start_ms     = FrameClockMs();
+
+        // Smooth coloring is only implemented for the Mandelbrot set. Counts are kept when the budget plans the next
+        // frame from them or the statistics need the number of iterations; then coloring is a separate pass.
+        bool smooth_kernel = (smooth && fractal.type == FRACTAL_MANDELBROT);
+        bool keep_counts   = budget_mode || show_stats || csv;
+        if(smooth_kernel)
+        {
+            RenderMandelbrotSmooth(pixels, counts, r2, frame_width, frame_height, x_rend, y_rend, frame_delta, n_iterations, true);
+        }
+        else if(!keep_counts)
+        {
+            RenderFractal(pixels, frame_width, frame_height, x_rend, y_rend, frame_delta, n_iterations, fractal);
+        }
+        else
+        {
+            RenderFractalCounts(counts, frame_width, frame_height, x_rend, y_rend, frame_delta, n_iterations, fractal, true);
+        }
+
+        double kernel_ms = FrameClockMs() - start_ms;
+        if(keep_counts && !smooth_kernel)
+        {
+            ColorMandelbrot(pixels, counts, (size_t)frame_width * frame_height);
+        }
+
+        double present_ms = FrameClockMs();
+        double render_ms  = present_ms - start_ms;
+        DrawMandelbrot(window, pixels, frame_width, frame_height, scale);
+        present_ms = FrameClockMs() - present_ms;
+
+        if(budget_mode)
+        {
+            FrameBudgetUpdate(&budget, counts, frame_width, frame_height, n_iterations, kernel_ms, render_ms + present_ms);
+            FrameBudgetPlan(&budget, width, height);
+        }
+        frame_degraded = (scale != 1 || n_iterations != N_ITERATIONS);
+
+        if(keep_counts && (show_stats || csv))
+        {
+            FrameStats stats = {"", frame_width, frame_height, n_iterations, x_rend, y_rend, frame_delta, render_ms, present_ms,
+                                SumCounts(counts, (size_t)frame_width * frame_height)};
+            int length = snprintf(stats.kernel, sizeof(stats.kernel), "%s [4 x double]%s", FractalName(fractal.type), smooth_kernel ? " smooth" : "");
+            if(scale != 1) snprintf(stats.kernel + length, sizeof(stats.kernel) - length, " at 1/%u", scale);
+
+            if(csv) WriteTelemetryCSV(csv, n_frames, start_ms - launch_ms, &stats);
+            if(show_stats)
+            {
+                FormatTelemetry(title, sizeof(title), &stats);
+                window.setTitle(title);
+            }
+        }
+        if(had_stats && !show_stats) window.setTitle(FractalName(fractal.type));
+        had_stats = show_stats;
+        n_frames++;
 
         to_render = false;
 
     } while(window.isOpen());
+
+    if(csv) fclose(csv);
+    FrameBudgetFree(&budget);
+    free(r2);
+    free(counts);
 #endif
 // ================================================================================================================================================================================
     free(pixels);
 
-    return EXIT_SUCCESS;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
 // ================================================================================================================================================================================
 }
 
-inline int64_t TimeCounter(void)
-{
-    int64_t result = 0;
-
-    asm volatile
-    (
-        ".intel_syntax noprefix\n\t"
-        "rdtsc\n\t"
-        "shl rdx, 32\n\t"
-        "add rax, rdx\n\t"
-        "mov %0, rax\n\t"
-        ".att_syntax prefix\n\t"
-        : "=r"(result)
-        :
-        : "%rdx", "%rax"
-    );
-
-    return result;
-}
-
-inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, double &x_rend, double &y_rend, double &delta, bool &to_render)
+#ifdef RENDER
+inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, double &x_rend, double &y_rend, double &delta, unsigned &width, unsigned &height,
+                         bool &to_render, bool &smooth, bool &budget_mode, bool &show_stats, Fractal &fractal)
 {
     switch(event.type)
     {
@@ -94,6 +239,10 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, double &x_r
         case sf::Event::Resized:
         {
             to_render = true;
+
+            width  = event.size.width;
+            height = event.size.height;
+
             window.setView(sf::View(sf::FloatRect(0, 0, event.size.width, event.size.height)));
             return;
         }
@@ -124,8 +273,8 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, double &x_r
                 }
                 case sf::Keyboard::Dash:
                 {
-                    x_rend -= delta * (SCREEN_WIDTH  / 2);
-                    y_rend += delta * (SCREEN_HEIGHT / 2);
+                    x_rend -= delta * (width  / 2);
+                    y_rend += delta * (height / 2);
 
                     delta *= 2;
 
@@ -135,97 +284,65 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, double &x_r
                 {
                     delta /= 2;
 
-                    x_rend += delta * (SCREEN_WIDTH  / 2);
-                    y_rend -= delta * (SCREEN_HEIGHT / 2);
+                    x_rend += delta * (width  / 2);
+                    y_rend -= delta * (height / 2);
 
                     return;
                 }
+                case sf::Keyboard::S:
+                {
+                    smooth = !smooth;
+                    return;
+                }
+                case sf::Keyboard::B:
+                {
+                    budget_mode = !budget_mode;
+                    return;
+                }
+                case sf::Keyboard::T:
+                {
+                    show_stats = !show_stats;
+                    return;
+                }
+                case sf::Keyboard::F:
+                {
+                    fractal.type = (FractalType)((fractal.type + 1) % N_FRACTALS);
+                    window.setTitle(FractalName(fractal.type));
+                    return;
+                }
+                case sf::Keyboard::J:
+                {
+                    // Julia set of the point in the center of the view.
+                    fractal.type = FRACTAL_JULIA;
+                    fractal.c_x  = x_rend + delta * (width  / 2);
+                    fractal.c_y  = y_rend - delta * (height / 2);
+                    window.setTitle(FractalName(fractal.type));
+                    return;
+                }
             }
         }
     }
 }
 
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, double x_rend, double y_rend, double delta)
-{
-#ifndef RENDER
-    int64_t start = TimeCounter();
-#endif
-
-    static const unsigned N_ITERATIONS = 1023;
-
-    static const __v4df MAX_ZERO_OFFSET2_V = _mm256_set1_pd(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
-    static const __v4df SHIFT_V            = _mm256_set_pd(3, 2, 1, 0);
-
-    __v4df delta_v         = _mm256_set1_pd(delta);
-    __v4df delta_v_shifted = SHIFT_V * delta_v;
-
-    size_t pix_arr_pos = 0;
-
-    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos += 1)
-    {
-        for(unsigned x_pos = 0; x_pos < SCREEN_WIDTH; x_pos += 4)
-        {
-            __v4df y_0 = _mm256_set1_pd(y_rend - y_pos * delta);
-            __v4df x_0 = x_rend + delta_v_shifted + x_pos * delta_v;
-
-            __v4df x_n = {};
-            __v4df y_n = {};
-
-            __v4di n = {};
-            for(volatile unsigned i = 0; i < N_ITERATIONS; i++)
-            {
-                __v4df x2 = x_n * x_n;
-                __v4df y2 = y_n * y_n;
-                __v4df xy = x_n * y_n;
-
-                __v4df cmp = ((x2 + y2) < MAX_ZERO_OFFSET2_V);
-
-                unsigned mask = _mm256_movemask_pd(cmp);
-                if(mask == 0) break;
-
-                n -= reinterpret_cast<__v4di>(cmp);
-
-                x_n = x2 - y2 + x_0;
-                y_n = xy + xy + y_0;
-            }
-
-#ifdef RENDER
-            int64_t *n_p = (int64_t *)&n;
-            for(unsigned i = 0; i < 4; i++, pix_arr_pos += 4)
-            {
-                sf::Uint8 color = *(n_p++);
-                pixels[pix_arr_pos + 0] = color;
-                pixels[pix_arr_pos + 1] = color;
-                pixels[pix_arr_pos + 2] = color * 32;
-            }
-#endif
-        }
-    }
-
-#ifndef RENDER
-    int64_t end = TimeCounter();
-    return (end - start);
-#endif
-
-    return 0;
-}
-
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
+// Pixels of a frame rendered at 1/scale of the window resolution are stretched to scale x scale squares.
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels, unsigned width, unsigned height, unsigned scale)
 {
     static sf::Sprite sprite;
     static sf::Texture texture;
 
-    texture.create(SCREEN_WIDTH, SCREEN_HEIGHT);
+    texture.create(width, height);
     texture.update(pixels);
 
-    sprite.setTexture(texture);
+    sprite.setTexture(texture, true);
+    sprite.setScale(scale, scale);
 
     window.clear(sf::Color::Black);
     window.draw(sprite);
     window.display();
 }
+#endif
 
-void TestSIMDHigh(sf::Uint8 *pixels, double x_rend, double y_rend, double delta)
+void TestSIMDHigh(uint8_t *pixels, double x_rend, double y_rend, double delta)
 {
     const size_t N_TESTS = 100;
     int64_t results[N_TESTS] = {};
@@ -233,9 +350,19 @@ void TestSIMDHigh(sf::Uint8 *pixels, double x_rend, double y_rend, double delta)
     double result_time = 0;
     double error       = 0;
 
+    PrintTSCCalibration();
+
+    PerfCounters counters = {};
+    PerfCountersOpen(&counters);
+
     for(size_t i = 0; i < N_TESTS; i++)
     {
-        int64_t delta_time = RenderMandelbrot(pixels, x_rend, y_rend, delta);
+        PerfCountersStart(&counters);
+        int64_t start = TimeCounterStart();
+        RenderMandelbrot(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS);
+        int64_t delta_time = TimeCounterEnd() - start;
+        PerfCountersStop(&counters);
+
         results[i]   = delta_time;
         result_time += (double)delta_time;
     }
@@ -252,4 +379,417 @@ void TestSIMDHigh(sf::Uint8 *pixels, double x_rend, double y_rend, double delta)
     error       = round(error       / exp) * exp;
     result_time = round(result_time / exp) * exp;
     printf("%lg ± %lg\n", result_time, error);
-}
\ No newline at end of file
+
+    PrintPerfCounters(&counters);
+    PerfCountersClose(&counters);
+}
+
+void TestSmoothColoring(uint8_t *pixels, double x_rend, double y_rend, double delta)
+{
+    const size_t N_TESTS = 10;
+
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    float    *r2     = (float    *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(float));
+
+    double render_time = 0;
+    double plain_time  = 0;
+    double smooth_time = 0;
+
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t render_start = TimeCounterStart();
+        RenderMandelbrotSmooth(pixels, counts, r2, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+        int64_t start = TimeCounterEnd();
+        ColorMandelbrot(pixels, counts, SCREEN_WIDTH * SCREEN_HEIGHT);
+        int64_t middle = TimeCounterEnd();
+        ColorMandelbrotSmooth(pixels, counts, r2, SCREEN_WIDTH * SCREEN_HEIGHT, N_ITERATIONS);
+        int64_t end = TimeCounterEnd();
+
+        render_time += (double)(start  - render_start);
+        plain_time  += (double)(middle - start);
+        smooth_time += (double)(end - middle);
+    }
+
+    printf("smooth coloring: render %lg ticks, plain color pass %lg ticks, smooth color pass %lg ticks (x%.2lf)\n",
+           render_time / N_TESTS, plain_time / N_TESTS, smooth_time / N_TESTS, smooth_time / plain_time);
+
+    free(r2);
+    free(counts);
+}
+
+// Times a full render against a mirrored one. The mirrored render must be bit-exact with the full one, otherwise the
+// test fails; how far the snap moves rows against the unsnapped view is only reported.
+bool TestSymmetry(double x_rend, double y_rend, double delta)
+{
+    const size_t N_TESTS  = 10;
+    const size_t N_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    unsigned *full     = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    unsigned *mirrored = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+
+    double y_offset   = 0;
+    int    mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+
+    unsigned n_mirrored = 0;
+    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos++)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) n_mirrored++;
+    }
+
+    double full_time     = 0;
+    double mirrored_time = 0;
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t start = TimeCounterStart();
+        RenderMandelbrotCounts(full,     SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, false);
+        int64_t middle = TimeCounterEnd();
+        RenderMandelbrotCounts(mirrored, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+        int64_t end = TimeCounterEnd();
+
+        full_time     += (double)(middle - start);
+        mirrored_time += (double)(end - middle);
+    }
+
+    bool exact = (memcmp(full, mirrored, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(unsigned)) == 0);
+
+    printf("symmetry: %u of %u rows mirrored, %s full render, x%.2lf faster%s\n",
+           n_mirrored, SCREEN_HEIGHT, exact ? "bit-exact with" : "DIFFERS from", full_time / mirrored_time, exact ? "" : ", FAILED");
+
+    // Both renders above place rows at the snapped y_offset, so they cannot show what the snap itself does. Against rows
+    // at the unsnapped y_rend / delta it moves every row by the same fraction of a pixel: none on the standard view, and
+    // SNAP_NUDGE on one nudged off the half-integer by less than the tolerance of FindMirrorSum.
+    const double SNAP_NUDGE = 1.0 / (1 << 21);
+
+    double *x     = (double *)calloc(N_PIXELS, sizeof(double));
+    double *y     = (double *)calloc(N_PIXELS, sizeof(double));
+    double *x_row = (double *)calloc(SCREEN_WIDTH,  sizeof(double));
+    double *y_col = (double *)calloc(SCREEN_HEIGHT, sizeof(double));
+
+    for(unsigned nudged = 0; nudged < 2; nudged++)
+    {
+        double view_y = y_rend + (double)nudged * SNAP_NUDGE * delta;
+
+        double shift = 0;
+        FindMirrorSum(view_y, delta, &shift);
+        shift -= view_y / delta;
+
+        GridCoordinates(x_row, y_col, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, view_y, delta);
+        for(size_t pix = 0; pix < N_PIXELS; pix++)
+        {
+            x[pix] = x_row[pix % SCREEN_WIDTH];
+            y[pix] = (view_y / delta - (double)(pix / SCREEN_WIDTH)) * delta;
+        }
+
+        RenderMandelbrotCounts(mirrored, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, view_y, delta, N_ITERATIONS, true);
+        RenderMandelbrotPoints(full, NULL, x, y, N_PIXELS, N_ITERATIONS);
+
+        size_t n_differ = 0;
+        for(size_t pix = 0; pix < N_PIXELS; pix++) n_differ += (full[pix] != mirrored[pix]);
+
+        printf("symmetry: %s view, rows snapped by %.2e pixel, %zu of %zu counts differ from unsnapped rows\n",
+               nudged ? "nudged" : "standard", fabs(shift), n_differ, N_PIXELS);
+    }
+
+    free(y_col);
+    free(x_row);
+    free(y);
+    free(x);
+    free(mirrored);
+    free(full);
+
+    return exact;
+}
+
+// Renders the same view at the default width and at widths that leave 1, 2 and 3 pixels in the last vector of each row.
+// Columns all widths share must match the aligned render exactly, otherwise the test fails; ticks per pixel should
+// stay close to it.
+bool TestResolution(double x_rend, double y_rend, double delta)
+{
+    const size_t   N_TESTS  = 20;
+    const unsigned N_WIDTHS = 4;
+    const unsigned WIDTHS[N_WIDTHS] = {SCREEN_WIDTH, SCREEN_WIDTH - 1, SCREEN_WIDTH - 2, SCREEN_WIDTH + 1};
+
+    unsigned *counts[N_WIDTHS] = {};
+    double    times[N_WIDTHS]  = {};
+    for(unsigned i = 0; i < N_WIDTHS; i++)
+    {
+        counts[i] = (unsigned *)calloc(WIDTHS[i] * SCREEN_HEIGHT, sizeof(unsigned));
+    }
+
+    // Widths take turns, so frequency changes during the test spread over all of them evenly.
+    for(size_t test = 0; test < N_TESTS; test++)
+    {
+        for(unsigned i = 0; i < N_WIDTHS; i++)
+        {
+            int64_t start = TimeCounterStart();
+            RenderMandelbrotCounts(counts[i], WIDTHS[i], SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+            int64_t end = TimeCounterEnd();
+
+            times[i] += (double)(end - start) / WIDTHS[i];
+        }
+    }
+
+    bool passed = true;
+    for(unsigned i = 0; i < N_WIDTHS; i++)
+    {
+        unsigned width  = WIDTHS[i];
+        unsigned shared = (width < SCREEN_WIDTH) ? width : SCREEN_WIDTH;
+
+        bool exact = true;
+        for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT && exact; y_pos++)
+        {
+            exact = (memcmp(counts[i] + (size_t)y_pos * width, counts[0] + (size_t)y_pos * SCREEN_WIDTH, shared * sizeof(unsigned)) == 0);
+        }
+
+        printf("resolution %ux%u: %.1lf ticks per pixel (x%.3lf of aligned), %s\n", width, SCREEN_HEIGHT,
+               times[i] / (N_TESTS * SCREEN_HEIGHT), times[i] / times[0], exact ? "matches aligned render" : "DIFFERS from aligned render, FAILED");
+        passed &= exact;
+    }
+
+    for(unsigned i = 0; i < N_WIDTHS; i++)
+    {
+        free(counts[i]);
+    }
+
+    return passed;
+}
+
+// Iterations per TSC tick of every formula, relative to the Mandelbrot kernel, on a small view inside the set, where
+// every lane runs all N_ITERATIONS. Ratios on other views would compare different images: the rate there also counts the
+// lanes that wait for the rest of their vector, and how many do depends on the picture. The share of pixels at the cap
+// is printed, so a view that is not all inside shows. Rows are never mirrored.
+void TestFractals(void)
+{
+    const size_t N_TESTS       = 5;
+    const double INTERIOR_SPAN = 0.1;
+
+    const Fractal FRACTALS[N_FRACTALS] = {{FRACTAL_MANDELBROT,   0,     0},
+                                          {FRACTAL_JULIA,       -0.1,   0.1},
+                                          {FRACTAL_BURNING_SHIP, 0,     0},
+                                          {FRACTAL_MULTIBROT3,   0,     0},
+                                          {FRACTAL_MULTIBROT4,   0,     0}};
+
+    // c = -0.1 is inside all of the parameter-space sets, the fixed point near z = 0 attracts the orbits of the Julia set.
+    double interior_delta  = INTERIOR_SPAN / SCREEN_WIDTH;
+    double interior_y_rend = interior_delta * (SCREEN_HEIGHT / 2);
+
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+
+    double rates[N_FRACTALS] = {};
+    for(unsigned type = 0; type < N_FRACTALS; type++)
+    {
+        double interior_x_rend = ((type == FRACTAL_JULIA) ? 0 : -0.1) - INTERIOR_SPAN / 2;
+
+        double time = 0;
+        for(size_t i = 0; i < N_TESTS; i++)
+        {
+            int64_t start = TimeCounterStart();
+            RenderFractalCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, interior_x_rend, interior_y_rend, interior_delta, N_ITERATIONS, FRACTALS[type], false);
+            time += (double)(TimeCounterEnd() - start);
+        }
+
+        double n_iterations = 0;
+        size_t n_inside     = 0;
+        for(size_t pix = 0; pix < SCREEN_WIDTH * SCREEN_HEIGHT; pix++)
+        {
+            n_iterations += counts[pix];
+            n_inside     += (counts[pix] == N_ITERATIONS);
+        }
+
+        rates[type] = n_iterations * N_TESTS / time;
+
+        printf("%-14s iterations per tick inside the set: %.3lf (x%.2lf), %.1lf%% of pixels at the cap\n", FractalName((FractalType)type),
+               rates[type], rates[type] / rates[0], 100.0 * (double)n_inside / (SCREEN_WIDTH * SCREEN_HEIGHT));
+    }
+
+    free(counts);
+}
+
+// Pans a deep view to the right by PIXELS_PER_OFFSET pixels per frame, as holding the arrow key does, with the budget
+// choosing resolution and iteration cap, and compares the frame times with the full-quality ones. The pan starts from a
+// full-quality frame, as after the viewer refined the view. Frame time here is the kernel and the coloring pass. A budget
+// below the cost of 1/8 resolution makes the budget cut the iteration cap. A frame over budget is rendered up to
+// N_REPEATS times more: if a repeat fits, the first run was a stall of the machine that no plan can foresee, otherwise
+// the plan missed, and the test fails.
+bool TestFrameBudget(double budget_ms)
+{
+    const size_t N_FRAMES  = 120;
+    const size_t N_REPEATS = 3;
+    const double CENTER_X  = -0.743643887037151;
+    const double CENTER_Y  =  0.131825904205330;
+    const double SPAN      =  2e-9;
+
+    double delta  = SPAN / SCREEN_WIDTH;
+    double x_rend = CENTER_X - delta * (SCREEN_WIDTH  / 2);
+    double y_rend = CENTER_Y + delta * (SCREEN_HEIGHT / 2);
+
+    uint8_t  *pixels = (uint8_t  *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(uint8_t));
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+
+    double frame_ms[N_FRAMES] = {};
+    double full_ms[N_FRAMES]  = {};
+
+    FrameBudget budget = {};
+    FrameBudgetInit(&budget, budget_ms, N_ITERATIONS, VECTOR_LANES);
+
+    double scale_sum      = 0;
+    double iterations_sum = 0;
+    size_t n_missed       = 0;
+    size_t n_stalled      = 0;
+    for(size_t frame = 0; frame <= N_FRAMES; frame++)
+    {
+        unsigned scale        = (frame == 0) ? 1            : budget.scale;
+        unsigned n_iterations = (frame == 0) ? N_ITERATIONS : budget.n_iterations;
+
+        unsigned width  = (SCREEN_WIDTH  + scale - 1) / scale;
+        unsigned height = (SCREEN_HEIGHT + scale - 1) / scale;
+
+        double start_ms = FrameClockMs();
+        RenderMandelbrotCounts(counts, width, height, x_rend, y_rend, delta * scale, n_iterations, true);
+        double render_ms = FrameClockMs() - start_ms;
+        ColorMandelbrot(pixels, counts, (size_t)width * height);
+        double end_ms = FrameClockMs();
+
+        if(frame > 0 && end_ms - start_ms > budget_ms)
+        {
+            double repeat_ms = end_ms - start_ms;
+            for(size_t repeat = 0; repeat < N_REPEATS && repeat_ms > budget_ms; repeat++)
+            {
+                double repeat_start_ms = FrameClockMs();
+                RenderMandelbrotCounts(counts, width, height, x_rend, y_rend, delta * scale, n_iterations, true);
+                ColorMandelbrot(pixels, counts, (size_t)width * height);
+                repeat_ms = FrameClockMs() - repeat_start_ms;
+            }
+
+            if(repeat_ms > budget_ms) n_missed++;
+            else n_stalled++;
+        }
+
+        FrameBudgetUpdate(&budget, counts, width, height, n_iterations, render_ms, end_ms - start_ms);
+        FrameBudgetPlan(&budget, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+        if(frame > 0)
+        {
+            frame_ms[frame - 1] = end_ms - start_ms;
+            scale_sum      += scale;
+            iterations_sum += n_iterations;
+
+            start_ms = FrameClockMs();
+            RenderMandelbrotCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+            ColorMandelbrot(pixels, counts, SCREEN_WIDTH * SCREEN_HEIGHT);
+            full_ms[frame - 1] = FrameClockMs() - start_ms;
+        }
+
+        x_rend += PIXELS_PER_OFFSET * delta;
+    }
+
+    FrameBudgetFree(&budget);
+
+    qsort(frame_ms, N_FRAMES, sizeof(double), CompareDoubles);
+    qsort(full_ms,  N_FRAMES, sizeof(double), CompareDoubles);
+
+    printf("frame budget %.1lf ms, %zu panning frames: full quality p50 %.1lf ms, max %.1lf ms; budgeted p50 %.1lf ms, p99 %.1lf ms, "
+           "max %.1lf ms, %zu over budget from stalls, %zu %s; mean scale 1/%.1lf, mean cap %.0lf iterations\n",
+           budget_ms, N_FRAMES, full_ms[N_FRAMES / 2], full_ms[N_FRAMES - 1], frame_ms[N_FRAMES / 2], frame_ms[N_FRAMES * 99 / 100],
+           frame_ms[N_FRAMES - 1], n_stalled, n_missed, (n_missed == 0) ? "planned over budget" : "planned over budget, FAILED",
+           scale_sum / N_FRAMES, iterations_sum / N_FRAMES);
+
+    free(counts);
+    free(pixels);
+
+    return n_missed == 0;
+}
+
+// Renders small views around the Misiurewicz point M3,1 with smaller and smaller pixel spacing, where the boundary stays
+// detailed at any depth, with [4 x double], double-double and 2, 3 and 4 limb fixed point. 4 limbs are the reference:
+// a kernel is exact at a depth when all its counts match it. Cost is TSC ticks per pixel iteration, and the cheapest
+// exact kernel of each depth is where the viewer should switch. The point itself is half a pixel away from the grid: its
+// orbit ends on a repelling cycle and never escapes, so its count only says how long rounding takes to throw it off.
+void TestDeepZoom(void)
+{
+    const unsigned    SIZE         = 64;
+    const unsigned    N_DEEP_ITERS = 4000;
+    const size_t      N_TESTS      = 3;
+    const char *const CENTER_X     = "-0.101096363845622161025785445738622565463805442826253483876931177660780840740470584274821220";
+    const char *const CENTER_Y     =  "0.956286510809141500771096057729977435809833336510529170034314321500524659065716732526978411";
+
+    const unsigned N_DEPTHS          = 7;
+    const double   DELTAS[N_DEPTHS]  = {1e-12, 1e-17, 1e-25, 1e-33, 1e-45, 1e-60, 1e-72};
+    const unsigned N_KERNELS         = 5;
+    const char    *NAMES[N_KERNELS]  = {"double", "double-double", "fixed 2 limbs", "fixed 3 limbs", "fixed 4 limbs"};
+
+    FixedPoint center_x = {};
+    FixedPoint center_y = {};
+    ParseFixed(CENTER_X, &center_x);
+    ParseFixed(CENTER_Y, &center_y);
+
+    unsigned *counts[N_KERNELS] = {};
+    for(unsigned kernel = 0; kernel < N_KERNELS; kernel++)
+    {
+        counts[kernel] = (unsigned *)calloc(SIZE * SIZE, sizeof(unsigned));
+    }
+
+    for(unsigned depth = 0; depth < N_DEPTHS; depth++)
+    {
+        double     delta  = DELTAS[depth];
+        FixedPoint offset = FixedFromDouble(delta * (SIZE / 2 - 0.5));
+        FixedPoint x_rend = FixedSub(center_x, offset);
+        FixedPoint y_rend = FixedAdd(center_y, offset);
+
+        DoubleDouble x_rend_dd = FixedToDoubleDouble(x_rend);
+        DoubleDouble y_rend_dd = FixedToDoubleDouble(y_rend);
+
+        double ticks[N_KERNELS] = {};
+        for(size_t test = 0; test < N_TESTS; test++)
+        {
+            for(unsigned kernel = 0; kernel < N_KERNELS; kernel++)
+            {
+                int64_t start = TimeCounterStart();
+                switch(kernel)
+                {
+                    case 0:  RenderMandelbrotCounts(counts[0], SIZE, SIZE, x_rend_dd.hi, y_rend_dd.hi, delta, N_DEEP_ITERS, false);  break;
+                    case 1:  RenderMandelbrotDoubleDoubleCounts(counts[1], SIZE, SIZE, x_rend_dd, y_rend_dd, delta, N_DEEP_ITERS);   break;
+                    default: RenderMandelbrotFixedCounts(counts[kernel], SIZE, SIZE, x_rend, y_rend, delta, kernel, N_DEEP_ITERS);   break;
+                }
+                ticks[kernel] += (double)(TimeCounterEnd() - start);
+            }
+        }
+
+        printf("deep zoom, pixel spacing %.0le:", delta);
+
+        int    cheapest       = -1;
+        double cheapest_ticks = 0;
+        for(unsigned kernel = 0; kernel < N_KERNELS; kernel++)
+        {
+            size_t n_matching = 0;
+            for(size_t pix = 0; pix < SIZE * SIZE; pix++)
+            {
+                if(counts[kernel][pix] == counts[N_KERNELS - 1][pix]) n_matching++;
+            }
+
+            double per_iteration = ticks[kernel] / (N_TESTS * SumCounts(counts[kernel], SIZE * SIZE));
+            if(n_matching == SIZE * SIZE && (cheapest < 0 || per_iteration < cheapest_ticks))
+            {
+                cheapest       = (int)kernel;
+                cheapest_ticks = per_iteration;
+            }
+
+            printf(" %s %.1lf ticks per iteration, %.1lf%% exact;", NAMES[kernel], per_iteration, 100.0 * n_matching / (SIZE * SIZE));
+        }
+
+        printf(" cheapest exact: %s\n", NAMES[cheapest]);
+    }
+
+    for(unsigned kernel = 0; kernel < N_KERNELS; kernel++)
+    {
+        free(counts[kernel]);
+    }
+}
+
+int CompareDoubles(const void *first, const void *second)
+{
+    double a = *(const double *)first;
+    double b = *(const double *)second;
+
+    return (a > b) - (a < b);
+}
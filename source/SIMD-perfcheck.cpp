@@ -0,0 +1,722 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Batch.h"
+#include "DeepZoom.h"
+#include "IntervalTiles.h"
+#include "Equalize.h"
+#include "Mandelbrot.h"
+#include "PerfCounters.h"
+#include "TileCodec.h"
+
+// Regression gate for the library kernels. Every kernel renders a small view N_SAMPLES times, interleaved with the
+// other kernels so frequency changes spread over all of them, and its TSC ticks are compared with the samples stored
+// for this machine: a kernel fails if its median is more than MAX_SLOWDOWN slower and a one-sided Mann-Whitney U test
+// says the difference is significant at SIGNIFICANCE. Its output (counts, RGBA pixels or encoded bytes) is compared
+// with a golden render stored in the repository, where at most tolerance of the values may differ: changes that move
+// a few boundary pixels, like FMA contraction, pass, anything else fails.
+//
+// Clock changes and busy neighbours in VMs move all kernels by several percent from one run to the next. A scalar loop
+// outside the library is timed in every round too, and the baseline is scaled by how much slower it got, so only
+// slowdowns of the kernels relative to the rest of the machine count.
+
+const size_t   N_SAMPLES    = 15;
+const double   MAX_SLOWDOWN = 0.05;
+const double   SIGNIFICANCE = 0.01;
+const uint64_t N_REFERENCE  = 1 << 21;
+const unsigned N_CODEC_RUNS = 16;  // the codec is a hundred times faster than rendering, too fast to time once
+
+const char GOLDEN_DIR[]   = "perfcheck/golden";
+const char BASELINE_DIR[] = "perfcheck/baselines";
+const size_t PATH_SIZE    = 256;
+
+const unsigned BATCH_TILE_WIDTH  = 60;  // not a multiple of 8, so vectors run across row ends and views
+const unsigned BATCH_TILE_HEIGHT = 54;
+
+const double FLOAT_TOLERANCE  = 0.005;
+const double DOUBLE_TOLERANCE = 0.001;
+
+struct CheckView
+{
+    const char *center_x;  // text, so the deep zoom kernels get all the digits
+    const char *center_y;
+    double      span;
+
+    unsigned width;
+    unsigned height;
+    unsigned n_iterations;
+};
+
+// Output of a kernel as 32-bit values, *n_values of them, which may be fewer than width * height (encoded bytes).
+typedef void (*CheckKernel)(uint32_t *output, size_t *n_values, const CheckView *view);
+
+struct CheckEntry
+{
+    const char *name;
+    CheckKernel run;
+    const CheckView *view;
+    double      tolerance;  // part of the values that may differ from the golden render
+};
+
+struct CheckResult
+{
+    int64_t ticks[N_SAMPLES];
+
+    double baseline[N_SAMPLES];
+    bool   has_baseline;
+};
+
+void ViewPosition(const CheckView *view, double *x_rend, double *y_rend, double *delta);
+
+void CountsFloat       (uint32_t *output, size_t *n_values, const CheckView *view);
+void CountsFloatMirror (uint32_t *output, size_t *n_values, const CheckView *view);
+void CountsDouble      (uint32_t *output, size_t *n_values, const CheckView *view);
+void CountsDoubleMirror(uint32_t *output, size_t *n_values, const CheckView *view);
+void PixelsFloat       (uint32_t *output, size_t *n_values, const CheckView *view);
+void PixelsDouble      (uint32_t *output, size_t *n_values, const CheckView *view);
+void SmoothFloat       (uint32_t *output, size_t *n_values, const CheckView *view);
+void SmoothDouble      (uint32_t *output, size_t *n_values, const CheckView *view);
+void AntiAliasing      (uint32_t *output, size_t *n_values, const CheckView *view);
+void BatchFloat        (uint32_t *output, size_t *n_values, const CheckView *view);
+template<typename REAL, bool R2>
+void Points            (uint32_t *output, size_t *n_values, const CheckView *view);
+template<typename REAL>
+void IntervalCounts    (uint32_t *output, size_t *n_values, const CheckView *view);
+template<typename REAL>
+void Distance          (uint32_t *output, size_t *n_values, const CheckView *view);
+template<FractalType TYPE, typename REAL>
+void FractalCounts     (uint32_t *output, size_t *n_values, const CheckView *view);
+void DeepDoubleDouble  (uint32_t *output, size_t *n_values, const CheckView *view);
+template<unsigned N_LIMBS>
+void DeepFixed         (uint32_t *output, size_t *n_values, const CheckView *view);
+void Equalized         (uint32_t *output, size_t *n_values, const CheckView *view);
+void CodecEncode       (uint32_t *output, size_t *n_values, const CheckView *view);
+void CodecDecode       (uint32_t *output, size_t *n_values, const CheckView *view);
+
+int64_t ReferenceLoop(void);
+
+bool ReadBaseline(const char *path, const CheckEntry *entries, size_t n_entries, CheckResult *results, CheckResult *reference);
+bool WriteBaseline(const char *path, const CheckEntry *entries, size_t n_entries, const CheckResult *results, const CheckResult *reference);
+bool CheckGolden(const CheckEntry *entry, const uint32_t *output, size_t n_values, bool update);
+double MannWhitneyP(const double *current, const double *baseline);
+double Median(const double *samples);
+int CompareDoubles(const void *first, const void *second);
+
+const CheckView START_VIEW     = {"-0.5",   "0",     3,    480, 270, 255};
+const CheckView SEAHORSE_VIEW  = {"-0.745", "0.113", 0.05, 480, 270, 255};
+const CheckView FRACTAL_VIEW   = {"0",      "0",     4,    480, 270, 255};
+const CheckView DEEP_VIEW      = {"-0.101096363845622161025785445738622565463805442826253483876931177660780840740470584274821220",
+                                  "0.956286510809141500771096057729977435809833336510529170034314321500524659065716732526978411",
+                                  6.4e-29, 64, 64, 1000};
+
+const CheckEntry ENTRIES[] =
+{
+    {"counts-float",                CountsFloat,                                        &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"counts-float-mirror",         CountsFloatMirror,                                  &START_VIEW,    FLOAT_TOLERANCE},
+    {"counts-double",               CountsDouble,                                       &SEAHORSE_VIEW, DOUBLE_TOLERANCE},
+    {"counts-double-mirror",        CountsDoubleMirror,                                 &START_VIEW,    DOUBLE_TOLERANCE},
+    {"rgba-float",                  PixelsFloat,                                        &START_VIEW,    FLOAT_TOLERANCE},
+    {"rgba-double",                 PixelsDouble,                                       &START_VIEW,    DOUBLE_TOLERANCE},
+    {"smooth-float",                SmoothFloat,                                        &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"smooth-double",               SmoothDouble,                                       &SEAHORSE_VIEW, DOUBLE_TOLERANCE},
+    {"antialiasing-float",          AntiAliasing,                                       &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"batch-float",                 BatchFloat,                                         &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"points-float",                Points<float,  false>,                              &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"points-float-r2",             Points<float,  true>,                               &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"points-double",               Points<double, false>,                              &SEAHORSE_VIEW, DOUBLE_TOLERANCE},
+    {"interval-float",              IntervalCounts<float>,                              &START_VIEW,    FLOAT_TOLERANCE},
+    {"interval-double",             IntervalCounts<double>,                             &START_VIEW,    DOUBLE_TOLERANCE},
+    {"distance-float",              Distance<float>,                                    &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"distance-double",             Distance<double>,                                   &SEAHORSE_VIEW, DOUBLE_TOLERANCE},
+    {"julia-float",                 FractalCounts<FRACTAL_JULIA,        float>,         &FRACTAL_VIEW,  FLOAT_TOLERANCE},
+    {"julia-double",                FractalCounts<FRACTAL_JULIA,        double>,        &FRACTAL_VIEW,  DOUBLE_TOLERANCE},
+    {"burning-ship-float",          FractalCounts<FRACTAL_BURNING_SHIP, float>,         &FRACTAL_VIEW,  FLOAT_TOLERANCE},
+    {"burning-ship-double",         FractalCounts<FRACTAL_BURNING_SHIP, double>,        &FRACTAL_VIEW,  DOUBLE_TOLERANCE},
+    {"multibrot3-float",            FractalCounts<FRACTAL_MULTIBROT3,   float>,         &FRACTAL_VIEW,  FLOAT_TOLERANCE},
+    {"multibrot3-double",           FractalCounts<FRACTAL_MULTIBROT3,   double>,        &FRACTAL_VIEW,  DOUBLE_TOLERANCE},
+    {"multibrot4-float",            FractalCounts<FRACTAL_MULTIBROT4,   float>,         &FRACTAL_VIEW,  FLOAT_TOLERANCE},
+    {"multibrot4-double",           FractalCounts<FRACTAL_MULTIBROT4,   double>,        &FRACTAL_VIEW,  DOUBLE_TOLERANCE},
+    {"deep-double-double",          DeepDoubleDouble,                                   &DEEP_VIEW,     DOUBLE_TOLERANCE},
+    {"deep-fixed2",                 DeepFixed<2>,                                       &DEEP_VIEW,     DOUBLE_TOLERANCE},
+    {"deep-fixed3",                 DeepFixed<3>,                                       &DEEP_VIEW,     DOUBLE_TOLERANCE},
+    {"deep-fixed4",                 DeepFixed<4>,                                       &DEEP_VIEW,     DOUBLE_TOLERANCE},
+    {"equalized",                   Equalized,                                          &SEAHORSE_VIEW, FLOAT_TOLERANCE},
+    {"codec-encode",                CodecEncode,                                        &SEAHORSE_VIEW, 0},
+    {"codec-decode",                CodecDecode,                                        &SEAHORSE_VIEW, 0},
+};
+const size_t N_ENTRIES = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+
+int main(int argc, const char *argv[])
+{
+// ================================================================================================================================================================================
+    bool update_baseline = false;
+    bool update_golden   = false;
+    double max_slowdown  = MAX_SLOWDOWN;
+
+    char baseline_path[PATH_SIZE] = {};
+    char host[64] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    snprintf(baseline_path, sizeof(baseline_path), "%s/%s.txt", BASELINE_DIR, host);
+
+    for(int i = 1; i < argc; i++)
+    {
+        if     (strcmp(argv[i], "--update-baseline") == 0) update_baseline = true;
+        else if(strcmp(argv[i], "--update-golden")   == 0) update_golden   = true;
+        else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) snprintf(baseline_path, sizeof(baseline_path), "%s", argv[++i]);
+        else if(strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) max_slowdown = atof(argv[++i]) / 100;
+        else
+        {
+            fprintf(stderr, "usage: %s [--baseline FILE] [--threshold PERCENT] [--update-baseline] [--update-golden]\n"
+                            "  baselines are per machine, %s/HOST.txt by default, golden renders are in %s\n",
+                    argv[0], BASELINE_DIR, GOLDEN_DIR);
+            return EXIT_FAILURE;
+        }
+    }
+// ================================================================================================================================================================================
+    size_t max_values = 0;
+    for(size_t entry = 0; entry < N_ENTRIES; entry++)
+    {
+        size_t n_pixels = (size_t)ENTRIES[entry].view->width * ENTRIES[entry].view->height;
+        if(EncodedCountsBound(n_pixels) > max_values) max_values = EncodedCountsBound(n_pixels);
+    }
+
+    uint32_t    *output  = (uint32_t    *)calloc(max_values, sizeof(uint32_t));
+    CheckResult *results = (CheckResult *)calloc(N_ENTRIES, sizeof(CheckResult));
+    CheckResult  reference = {};
+
+    bool has_baseline = !update_baseline && ReadBaseline(baseline_path, ENTRIES, N_ENTRIES, results, &reference);
+// ================================================================================================================================================================================
+    // Golden renders first, then the timing rounds, all kernels once per round.
+    bool passed = true;
+    for(size_t entry = 0; entry < N_ENTRIES; entry++)
+    {
+        size_t n_values = 0;
+        ENTRIES[entry].run(output, &n_values, ENTRIES[entry].view);
+
+        passed = CheckGolden(ENTRIES + entry, output, n_values, update_golden) && passed;
+    }
+
+    for(size_t sample = 0; sample < N_SAMPLES; sample++)
+    {
+        reference.ticks[sample] = ReferenceLoop();
+        for(size_t entry = 0; entry < N_ENTRIES; entry++)
+        {
+            size_t n_values = 0;
+
+            int64_t start = TimeCounterStart();
+            ENTRIES[entry].run(output, &n_values, ENTRIES[entry].view);
+            results[entry].ticks[sample] = TimeCounterEnd() - start;
+        }
+    }
+// ================================================================================================================================================================================
+    // The machine factor is 1 without a baseline for the reference loop, older baselines are compared as they are.
+    double reference_ticks[N_SAMPLES] = {};
+    for(size_t sample = 0; sample < N_SAMPLES; sample++) reference_ticks[sample] = (double)reference.ticks[sample];
+
+    double machine = reference.has_baseline ? Median(reference_ticks) / Median(reference.baseline) : 1;
+    if(has_baseline) printf("reference loop x%.3lf against the baseline, the baseline is scaled by it\n", machine);
+
+    for(size_t entry = 0; entry < N_ENTRIES; entry++)
+    {
+        CheckResult *result = results + entry;
+
+        double current[N_SAMPLES]  = {};
+        double baseline[N_SAMPLES] = {};
+        for(size_t sample = 0; sample < N_SAMPLES; sample++)
+        {
+            current[sample]  = (double)result->ticks[sample];
+            baseline[sample] = result->baseline[sample] * machine;
+        }
+
+        double median = Median(current);
+        if(!result->has_baseline)
+        {
+            printf("%-22s %12.0lf ticks%s\n", ENTRIES[entry].name, median, has_baseline ? ", NOT IN BASELINE" : "");
+            continue;
+        }
+
+        // The same test the other way round only reports a speedup, a reason to update the baseline.
+        double ratio  = median / Median(baseline);
+        double p      = MannWhitneyP(current, baseline);
+        bool   slower = (ratio > 1 + max_slowdown && p < SIGNIFICANCE);
+        bool   faster = (ratio < 1 - max_slowdown && MannWhitneyP(baseline, current) < SIGNIFICANCE);
+
+        printf("%-22s %12.0lf ticks, baseline %12.0lf, x%.3lf, p = %.4lf%s\n", ENTRIES[entry].name, median, Median(baseline),
+               ratio, p, slower ? "  SLOWER" : faster ? "  faster" : "");
+        passed = passed && !slower;
+    }
+
+    if(update_baseline || !has_baseline)
+    {
+        if(WriteBaseline(baseline_path, ENTRIES, N_ENTRIES, results, &reference)) printf("baseline written to %s\n", baseline_path);
+        else passed = false;
+    }
+
+    printf("perfcheck %s\n", passed ? "passed" : "FAILED");
+// ================================================================================================================================================================================
+    free(results);
+    free(output);
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+// ================================================================================================================================================================================
+}
+
+void ViewPosition(const CheckView *view, double *x_rend, double *y_rend, double *delta)
+{
+    *delta  = view->span / ((view->width > view->height) ? view->width : view->height);
+    *x_rend = strtod(view->center_x, NULL) - *delta * (view->width  / 2);
+    *y_rend = strtod(view->center_y, NULL) + *delta * (view->height / 2);
+}
+
+// ================================================================================================================================================================================
+// Kernels
+// ================================================================================================================================================================================
+
+void CountsFloat(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotCounts(output, view->width, view->height, (float)x_rend, (float)y_rend, (float)delta, view->n_iterations, false);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void CountsFloatMirror(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotCounts(output, view->width, view->height, (float)x_rend, (float)y_rend, (float)delta, view->n_iterations, true);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void CountsDouble(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotCounts(output, view->width, view->height, x_rend, y_rend, delta, view->n_iterations, false);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void CountsDoubleMirror(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotCounts(output, view->width, view->height, x_rend, y_rend, delta, view->n_iterations, true);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void PixelsFloat(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrot((uint8_t *)output, view->width, view->height, (float)x_rend, (float)y_rend, (float)delta, view->n_iterations);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void PixelsDouble(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrot((uint8_t *)output, view->width, view->height, x_rend, y_rend, delta, view->n_iterations);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void SmoothFloat(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    static unsigned *counts = (unsigned *)calloc((size_t)view->width * view->height, sizeof(unsigned));
+    static float    *r2     = (float    *)calloc((size_t)view->width * view->height, sizeof(float));
+
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotSmooth((uint8_t *)output, counts, r2, view->width, view->height, (float)x_rend, (float)y_rend, (float)delta, view->n_iterations, true);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void SmoothDouble(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    static unsigned *counts = (unsigned *)calloc((size_t)view->width * view->height, sizeof(unsigned));
+    static float    *r2     = (float    *)calloc((size_t)view->width * view->height, sizeof(float));
+
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotSmooth((uint8_t *)output, counts, r2, view->width, view->height, x_rend, y_rend, delta, view->n_iterations, true);
+    *n_values = (size_t)view->width * view->height;
+}
+
+void AntiAliasing(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    static unsigned *counts = (unsigned *)calloc((size_t)view->width * view->height, sizeof(unsigned));
+    static unsigned *edges  = (unsigned *)calloc((size_t)view->width * view->height, sizeof(unsigned));
+
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotAA((uint8_t *)output, counts, edges, view->width, view->height, (float)x_rend, (float)y_rend, (float)delta, view->n_iterations);
+    *n_values = (size_t)view->width * view->height;
+}
+
+// The view cut into tiles that are rendered as separate views of one batch; counts come out tile after tile.
+void BatchFloat(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    const unsigned n_columns = view->width  / BATCH_TILE_WIDTH;
+    const unsigned n_rows    = view->height / BATCH_TILE_HEIGHT;
+    const size_t   n_views   = (size_t)n_columns * n_rows;
+
+    static Viewport *views = (Viewport *)calloc(n_views, sizeof(Viewport));
+
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    for(size_t view_i = 0; view_i < n_views; view_i++)
+    {
+        unsigned column = (unsigned)(view_i % n_columns), row = (unsigned)(view_i / n_columns);
+
+        views[view_i].x_rend = (float)(x_rend + column * BATCH_TILE_WIDTH  * delta);
+        views[view_i].y_rend = (float)(y_rend - row    * BATCH_TILE_HEIGHT * delta);
+        views[view_i].delta  = (float)delta;
+        views[view_i].width  = BATCH_TILE_WIDTH;
+        views[view_i].height = BATCH_TILE_HEIGHT;
+        views[view_i].counts = output + view_i * BATCH_TILE_WIDTH * BATCH_TILE_HEIGHT;
+        views[view_i].pixels = NULL;
+    }
+
+    RenderMandelbrotBatch(views, n_views, view->n_iterations, 1);
+    *n_values = n_views * BATCH_TILE_WIDTH * BATCH_TILE_HEIGHT;
+}
+
+// The view as a list of points from GridCoordinates, so the counts are those of counts-float and counts-double. R2 runs
+// the loop that also keeps |z|^2 at the escape; only the counts are compared.
+template<typename REAL, bool R2>
+void Points(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    const size_t n_pixels = (size_t)view->width * view->height;
+
+    static REAL  *x_row = (REAL  *)calloc(view->width,  sizeof(REAL));
+    static REAL  *y_col = (REAL  *)calloc(view->height, sizeof(REAL));
+    static REAL  *x     = (REAL  *)calloc(n_pixels,     sizeof(REAL));
+    static REAL  *y     = (REAL  *)calloc(n_pixels,     sizeof(REAL));
+    static float *r2    = (float *)calloc(n_pixels,     sizeof(float));
+
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    GridCoordinates(x_row, y_col, view->width, view->height, (REAL)x_rend, (REAL)y_rend, (REAL)delta);
+    for(size_t pix = 0; pix < n_pixels; pix++)
+    {
+        x[pix] = x_row[pix % view->width];
+        y[pix] = y_col[pix / view->width];
+    }
+
+    RenderMandelbrotPoints(output, R2 ? r2 : NULL, x, y, n_pixels, view->n_iterations);
+    *n_values = n_pixels;
+}
+
+// The starting view, where the proofs fill more than half of the pixels.
+template<typename REAL>
+void IntervalCounts(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotIntervalCounts(output, view->width, view->height, (REAL)x_rend, (REAL)y_rend, (REAL)delta, view->n_iterations);
+    *n_values = (size_t)view->width * view->height;
+}
+
+// Distances in 1/16 of a pixel: rounding differences only move the values next to a step.
+template<typename REAL>
+void Distance(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    static unsigned *counts   = (unsigned *)calloc((size_t)view->width * view->height, sizeof(unsigned));
+    static float    *distance = (float    *)calloc((size_t)view->width * view->height, sizeof(float));
+
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotDistance(NULL, counts, distance, view->width, view->height, (REAL)x_rend, (REAL)y_rend, (REAL)delta, view->n_iterations, true);
+
+    *n_values = (size_t)view->width * view->height;
+    for(size_t pix = 0; pix < *n_values; pix++) output[pix] = (uint32_t)(distance[pix] * 16);
+}
+
+// Julia sets use c = -0.8 + 0.156i, a connected set with a detailed boundary.
+template<FractalType TYPE, typename REAL>
+void FractalCounts(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    Fractal fractal = {TYPE, (TYPE == FRACTAL_JULIA) ? -0.8 : 0, (TYPE == FRACTAL_JULIA) ? 0.156 : 0};
+
+    double x_rend = 0, y_rend = 0, delta = 0;
+    ViewPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderFractalCounts(output, view->width, view->height, (REAL)x_rend, (REAL)y_rend, (REAL)delta, view->n_iterations, fractal, true);
+    *n_values = (size_t)view->width * view->height;
+}
+
+// Half a pixel off the center: the center of DEEP_VIEW is on the boundary and its count only depends on rounding.
+static void DeepPosition(const CheckView *view, FixedPoint *x_rend, FixedPoint *y_rend, double *delta)
+{
+    FixedPoint center_x = {};
+    FixedPoint center_y = {};
+    ParseFixed(view->center_x, &center_x);
+    ParseFixed(view->center_y, &center_y);
+
+    *delta = view->span / ((view->width > view->height) ? view->width : view->height);
+    *x_rend = FixedSub(center_x, FixedFromDouble(*delta * (view->width  / 2 - 0.5)));
+    *y_rend = FixedAdd(center_y, FixedFromDouble(*delta * (view->height / 2 - 0.5)));
+}
+
+void DeepDoubleDouble(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    FixedPoint x_rend = {}, y_rend = {};
+    double     delta  = 0;
+    DeepPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotDoubleDoubleCounts(output, view->width, view->height, FixedToDoubleDouble(x_rend), FixedToDoubleDouble(y_rend), delta,
+                                       view->n_iterations);
+    *n_values = (size_t)view->width * view->height;
+}
+
+template<unsigned N_LIMBS>
+void DeepFixed(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    FixedPoint x_rend = {}, y_rend = {};
+    double     delta  = 0;
+    DeepPosition(view, &x_rend, &y_rend, &delta);
+
+    RenderMandelbrotFixedCounts(output, view->width, view->height, x_rend, y_rend, delta, N_LIMBS, view->n_iterations);
+    *n_values = (size_t)view->width * view->height;
+}
+
+// The coloring pass alone, on one thread, of counts rendered once.
+void Equalized(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    static size_t    n_counts = (size_t)view->width * view->height;
+    static unsigned *counts   = (unsigned *)calloc(n_counts, sizeof(unsigned));
+    static bool      rendered = false;
+
+    if(!rendered) CountsDouble(counts, n_values, view);
+    rendered = true;
+
+    ColorMandelbrotEqualized((uint8_t *)output, counts, n_counts, view->n_iterations, 1);
+    *n_values = n_counts;
+}
+
+// The encoded bytes have to stay the same to the last bit: files written before have to decode.
+void CodecEncode(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    static size_t    n_counts = (size_t)view->width * view->height;
+    static unsigned *counts   = (unsigned *)calloc(n_counts, sizeof(unsigned));
+    static bool      rendered = false;
+
+    if(!rendered) CountsDouble(counts, n_values, view);
+    rendered = true;
+
+    size_t size = 0;
+    for(unsigned run = 0; run < N_CODEC_RUNS; run++) size = EncodeCounts((uint8_t *)output, counts, n_counts);
+    memset((uint8_t *)output + size, 0, sizeof(uint32_t) - 1);
+
+    *n_values = (size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+void CodecDecode(uint32_t *output, size_t *n_values, const CheckView *view)
+{
+    static size_t   n_counts = (size_t)view->width * view->height;
+    static uint8_t *encoded  = (uint8_t *)calloc(EncodedCountsBound(n_counts), 1);
+    static size_t   size     = 0;
+
+    if(size == 0)
+    {
+        CountsDouble(output, n_values, view);
+        size = EncodeCounts(encoded, output, n_counts);
+    }
+
+    for(unsigned run = 0; run < N_CODEC_RUNS; run++) DecodeCounts(output, n_counts, encoded, size);
+    *n_values = n_counts;
+}
+
+// A chain of dependent multiplications: a few milliseconds of the core clock, no memory and no vector units.
+int64_t ReferenceLoop(void)
+{
+    int64_t start = TimeCounterStart();
+
+    volatile uint64_t seed  = 1;
+    uint64_t          state = seed;
+    for(uint64_t i = 0; i < N_REFERENCE; i++) state = state * 6364136223846793005u + 1442695040888963407u;
+    seed = state;
+
+    return TimeCounterEnd() - start;
+}
+
+// ================================================================================================================================================================================
+// Golden renders and baselines
+// ================================================================================================================================================================================
+
+// Golden renders are encoded counts files of n_values x 1 values.
+bool CheckGolden(const CheckEntry *entry, const uint32_t *output, size_t n_values, bool update)
+{
+    char path[PATH_SIZE] = {};
+    snprintf(path, sizeof(path), "%s/%s.zcounts", GOLDEN_DIR, entry->name);
+
+    if(update)
+    {
+        mkdir("perfcheck", 0755);
+        mkdir(GOLDEN_DIR,  0755);
+
+        FILE *stream  = fopen(path, "wb");
+        bool  written = stream && WriteEncodedCounts(stream, output, (unsigned)n_values, 1);
+        if(stream) written = (fclose(stream) == 0) && written;
+
+        if(!written) perror(path);
+        return written;
+    }
+
+    FILE *stream = fopen(path, "rb");
+    if(!stream)
+    {
+        printf("%-22s no golden render %s, make perfcheck-golden writes it\n", entry->name, path);
+        return false;
+    }
+
+    unsigned  width  = 0;
+    unsigned  height = 0;
+    unsigned *golden = ReadEncodedCounts(stream, &width, &height);
+    fclose(stream);
+
+    if(!golden || (size_t)width * height != n_values)
+    {
+        printf("%-22s golden render %s is damaged or of another size\n", entry->name, path);
+        free(golden);
+        return false;
+    }
+
+    size_t n_different = 0;
+    for(size_t i = 0; i < n_values; i++)
+    {
+        if(golden[i] != output[i]) n_different++;
+    }
+    free(golden);
+
+    size_t n_allowed = (size_t)(entry->tolerance * n_values);
+    if(n_different > n_allowed)
+    {
+        printf("%-22s output DIFFERS from the golden render: %zu of %zu values, %zu allowed\n", entry->name, n_different, n_values, n_allowed);
+        return false;
+    }
+    if(n_different > 0) printf("%-22s %zu of %zu values differ from the golden render, %zu allowed\n", entry->name, n_different, n_values, n_allowed);
+
+    return true;
+}
+
+// One line per kernel: its name and the ticks of its N_SAMPLES samples, the reference loop is called reference. Kernels
+// missing in the file have no baseline.
+bool ReadBaseline(const char *path, const CheckEntry *entries, size_t n_entries, CheckResult *results, CheckResult *reference)
+{
+    FILE *stream = fopen(path, "r");
+    if(!stream)
+    {
+        printf("no baseline for this machine in %s, this run becomes the baseline\n", path);
+        return false;
+    }
+
+    char name[64] = {};
+    while(fscanf(stream, "%63s", name) == 1)
+    {
+        double samples[N_SAMPLES] = {};
+        bool   complete = true;
+        for(size_t sample = 0; sample < N_SAMPLES && complete; sample++) complete = (fscanf(stream, "%lf", samples + sample) == 1);
+        if(!complete) break;
+
+        if(strcmp(name, "reference") == 0)
+        {
+            memcpy(reference->baseline, samples, sizeof(samples));
+            reference->has_baseline = true;
+        }
+
+        for(size_t entry = 0; entry < n_entries; entry++)
+        {
+            if(strcmp(entries[entry].name, name) != 0) continue;
+
+            memcpy(results[entry].baseline, samples, sizeof(samples));
+            results[entry].has_baseline = true;
+        }
+    }
+
+    fclose(stream);
+    return true;
+}
+
+bool WriteBaseline(const char *path, const CheckEntry *entries, size_t n_entries, const CheckResult *results, const CheckResult *reference)
+{
+    mkdir("perfcheck", 0755);
+    mkdir(BASELINE_DIR, 0755);
+
+    FILE *stream = fopen(path, "w");
+    if(!stream)
+    {
+        perror(path);
+        return false;
+    }
+
+    fprintf(stream, "reference");
+    for(size_t sample = 0; sample < N_SAMPLES; sample++) fprintf(stream, " %" PRId64, reference->ticks[sample]);
+    fprintf(stream, "\n");
+
+    for(size_t entry = 0; entry < n_entries; entry++)
+    {
+        fprintf(stream, "%s", entries[entry].name);
+        for(size_t sample = 0; sample < N_SAMPLES; sample++) fprintf(stream, " %" PRId64, results[entry].ticks[sample]);
+        fprintf(stream, "\n");
+    }
+
+    return fclose(stream) == 0;
+}
+
+// Probability that current is at least as much slower than baseline as it is by chance: U counts the pairs in which
+// the current sample is slower, ties count half, and is close to normal for N_SAMPLES samples on each side.
+double MannWhitneyP(const double *current, const double *baseline)
+{
+    double u = 0;
+    for(size_t i = 0; i < N_SAMPLES; i++)
+    {
+        for(size_t j = 0; j < N_SAMPLES; j++)
+        {
+            if     (current[i] >  baseline[j]) u += 1;
+            else if(current[i] == baseline[j]) u += 0.5;
+        }
+    }
+
+    double n    = (double)N_SAMPLES;
+    double mean = n * n / 2;
+    double sd   = sqrt(n * n * (2 * n + 1) / 12);
+
+    return 0.5 * erfc((u - mean) / sd / sqrt(2.0));
+}
+
+double Median(const double *samples)
+{
+    double sorted[N_SAMPLES] = {};
+    memcpy(sorted, samples, sizeof(sorted));
+    qsort(sorted, N_SAMPLES, sizeof(double), CompareDoubles);
+
+    return sorted[N_SAMPLES / 2];
+}
+
+int CompareDoubles(const void *first, const void *second)
+{
+    double a = *(const double *)first;
+    double b = *(const double *)second;
+
+    return (a > b) - (a < b);
+}
@@ -0,0 +1,682 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Image.h"
+#include "Mandelbrot.h"
+#include "TileCodec.h"
+#include "TileProtocol.h"
+
+const unsigned MAX_WORKERS      = 64;
+const unsigned WORKER_DEPTH     = 2;    // tiles sent to a worker at once: one being rendered, one waiting in its socket
+const unsigned WORKER_START_MS  = 2000;
+const unsigned POLL_INTERVAL_MS = 10;
+const double   SLOW_TILE_FACTOR = 4;    // an idle worker takes over a tile in flight this many times longer than the mean
+const size_t   PATH_SIZE        = 256;
+
+enum TileState
+{
+    TILE_QUEUED,
+    TILE_RUNNING,
+    TILE_DONE,
+};
+
+enum OutputFormat
+{
+    OUTPUT_PPM,
+    OUTPUT_PNG,
+    OUTPUT_COUNTS,
+    OUTPUT_ENCODED,
+};
+
+struct RenderJob
+{
+    unsigned width;
+    unsigned height;
+
+    double center_x;
+    double center_y;
+    double span;
+
+    unsigned n_iterations;
+    bool     high_precision;
+    unsigned tile_size;
+
+    unsigned    n_local_workers;
+    const char *server;
+    const char *remote[MAX_WORKERS];
+    unsigned    n_remote;
+    unsigned    kill_after; // kill the first worker after this many tiles, to try out the rebalancing
+
+    OutputFormat format;
+    const char  *output;
+};
+
+struct Tile
+{
+    unsigned x_pos;
+    unsigned y_pos;
+    unsigned width;
+    unsigned height;
+
+    TileState state;
+    unsigned  n_copies; // workers it is in flight on
+};
+
+struct Worker
+{
+    int   fd;
+    pid_t pid; // 0 for workers that were already running
+    bool  alive;
+
+    unsigned in_flight[WORKER_DEPTH];
+    double   sent_us[WORKER_DEPTH];
+    unsigned n_in_flight;
+
+    TileResponse response;
+    size_t       n_response;
+    uint8_t     *payload;
+    uint64_t     n_payload;
+    unsigned    *decoded;
+
+    size_t n_done;
+};
+
+struct TileQueue
+{
+    unsigned *ids;
+    size_t    capacity;
+    size_t    head;
+    size_t    size;
+};
+
+struct RenderStats
+{
+    size_t n_done;
+    size_t n_speculative;
+    size_t n_requeued;
+    size_t n_wasted;
+    double tile_us; // sum over completed tiles, for the mean
+    double n_bytes;     // encoded counts received
+    double n_raw_bytes; // the same counts decoded
+};
+
+bool ParseOptions(RenderJob *job, int argc, const char *argv[]);
+void PrintUsage(const char *program);
+
+bool StartWorker(Worker *worker, const char *server, unsigned index, char *socket_path);
+bool ConnectWorker(Worker *worker, const char *address);
+void StopWorker(Worker *worker);
+
+bool DispatchTile(Worker *worker, unsigned id, const Tile *tiles, const RenderJob *job, double x_rend, double y_rend, double delta);
+bool ReadWorker(Worker *worker, Tile *tiles, unsigned n_tiles, unsigned *counts, const RenderJob *job, RenderStats *stats);
+void LoseWorker(Worker *worker, Tile *tiles, TileQueue *queue, RenderStats *stats);
+bool FindSlowTile(const Worker *workers, unsigned n_workers, const Worker *idle, const Tile *tiles, double mean_tile_us, unsigned *id);
+
+inline void PushTile(TileQueue *queue, unsigned id);
+inline bool PopTile(TileQueue *queue, unsigned *id);
+
+int main(int argc, const char *argv[])
+{
+// ================================================================================================================================================================================
+    char default_server[PATH_SIZE] = {};
+    const char *slash = strrchr(argv[0], '/');
+    snprintf(default_server, sizeof(default_server), "%.*smandelbrot-server.out", slash ? (int)(slash - argv[0] + 1) : 0, argv[0]);
+
+    RenderJob job = {1920, 1080, 0, 0, 2 * MAX_ZERO_OFFSET, 255, false, 128, 0, default_server, {}, 0, 0, OUTPUT_PPM, NULL};
+    if(!ParseOptions(&job, argc, argv))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double delta  = job.span / ((job.width > job.height) ? job.width : job.height);
+    double x_rend = job.center_x - delta * (job.width  / 2);
+    double y_rend = job.center_y + delta * (job.height / 2);
+// ================================================================================================================================================================================
+    signal(SIGPIPE, SIG_IGN);
+
+    unsigned n_workers = job.n_local_workers + job.n_remote;
+    Worker  *workers   = (Worker *)calloc(n_workers, sizeof(Worker));
+
+    char (*socket_paths)[PATH_SIZE] = (char (*)[PATH_SIZE])calloc(job.n_local_workers, PATH_SIZE);
+
+    // Workers send their tiles as encoded counts.
+    size_t max_tile_pixels = (size_t)job.tile_size * job.tile_size;
+    for(unsigned i = 0; i < n_workers; i++)
+    {
+        Worker *worker = workers + i;
+        worker->fd      = -1;
+        worker->payload = (uint8_t  *)calloc(EncodedCountsBound(max_tile_pixels), 1);
+        worker->decoded = (unsigned *)calloc(max_tile_pixels, sizeof(unsigned));
+
+        bool started = (i < job.n_local_workers) ? StartWorker(worker, job.server, i, socket_paths[i])
+                                                 : ConnectWorker(worker, job.remote[i - job.n_local_workers]);
+        if(!started)
+        {
+            for(unsigned j = 0; j <= i; j++) StopWorker(workers + j);
+            return EXIT_FAILURE;
+        }
+    }
+// ================================================================================================================================================================================
+    unsigned n_columns = (job.width  + job.tile_size - 1) / job.tile_size;
+    unsigned n_rows    = (job.height + job.tile_size - 1) / job.tile_size;
+    unsigned n_tiles   = n_columns * n_rows;
+
+    Tile     *tiles  = (Tile     *)calloc(n_tiles, sizeof(Tile));
+    unsigned *counts = (unsigned *)calloc((size_t)job.width * job.height, sizeof(unsigned));
+
+    TileQueue queue = {(unsigned *)calloc(n_tiles, sizeof(unsigned)), n_tiles, 0, 0};
+    for(unsigned i = 0; i < n_tiles; i++)
+    {
+        Tile *tile = tiles + i;
+        tile->x_pos  = (i % n_columns) * job.tile_size;
+        tile->y_pos  = (i / n_columns) * job.tile_size;
+        tile->width  = (job.width  - tile->x_pos < job.tile_size) ? job.width  - tile->x_pos : job.tile_size;
+        tile->height = (job.height - tile->y_pos < job.tile_size) ? job.height - tile->y_pos : job.tile_size;
+        tile->state  = TILE_QUEUED;
+
+        PushTile(&queue, i);
+    }
+
+    pollfd   *fds      = (pollfd   *)calloc(n_workers, sizeof(pollfd));
+    unsigned *fd_owner = (unsigned *)calloc(n_workers, sizeof(unsigned));
+
+    RenderStats stats  = {};
+    bool        killed = false;
+// ================================================================================================================================================================================
+    double start_us = NowUs();
+    while(stats.n_done < n_tiles)
+    {
+        // Queued tiles go to workers with a free slot. When the queue is empty, a worker with nothing to do takes over the
+        // tile that is late the most on another worker: the first answer wins, so a slow or hung worker only delays the
+        // tiles it is holding until someone else renders them.
+        double mean_tile_us = stats.n_done ? stats.tile_us / stats.n_done : 0;
+        for(unsigned i = 0; i < n_workers; i++)
+        {
+            Worker *worker = workers + i;
+            while(worker->alive && worker->n_in_flight < WORKER_DEPTH)
+            {
+                unsigned id = 0;
+                bool found = false;
+                while(!found && PopTile(&queue, &id)) found = (tiles[id].state == TILE_QUEUED);
+
+                if(!found && worker->n_in_flight == 0 && FindSlowTile(workers, n_workers, worker, tiles, mean_tile_us, &id))
+                {
+                    found = true;
+                    stats.n_speculative++;
+                }
+                if(!found) break;
+
+                if(!DispatchTile(worker, id, tiles, &job, x_rend, y_rend, delta))
+                {
+                    if(tiles[id].state == TILE_QUEUED) PushTile(&queue, id);
+                    LoseWorker(worker, tiles, &queue, &stats);
+                    break;
+                }
+
+                tiles[id].state = TILE_RUNNING;
+                tiles[id].n_copies++;
+            }
+        }
+
+        nfds_t n_fds = 0;
+        for(unsigned i = 0; i < n_workers; i++)
+        {
+            if(!workers[i].alive) continue;
+
+            fd_owner[n_fds] = i;
+            fds[n_fds++]    = {workers[i].fd, POLLIN, 0};
+        }
+
+        if(n_fds == 0)
+        {
+            fprintf(stderr, "all workers are lost, %zu of %u tiles done\n", stats.n_done, n_tiles);
+            break;
+        }
+
+        int n_ready = poll(fds, n_fds, POLL_INTERVAL_MS);
+        if(n_ready < 0 && errno != EINTR)
+        {
+            perror("poll");
+            break;
+        }
+
+        for(nfds_t i = 0; n_ready > 0 && i < n_fds; i++)
+        {
+            Worker *worker = workers + fd_owner[i];
+            if(fds[i].revents && !ReadWorker(worker, tiles, n_tiles, counts, &job, &stats)) LoseWorker(worker, tiles, &queue, &stats);
+        }
+
+        if(job.kill_after && !killed && stats.n_done >= job.kill_after && workers[0].pid)
+        {
+            fprintf(stderr, "killing worker 0 after %zu tiles\n", stats.n_done);
+            kill(workers[0].pid, SIGKILL);
+            killed = true;
+        }
+    }
+    double elapsed_us = NowUs() - start_us;
+// ================================================================================================================================================================================
+    bool complete = (stats.n_done == n_tiles);
+
+    fprintf(stderr, "%ux%u in %u tiles of %ux%u, %u iterations, %s, %u workers: %.1lf ms (%.1lf Mpixel/s)\n",
+            job.width, job.height, n_tiles, job.tile_size, job.tile_size, job.n_iterations,
+            job.high_precision ? "[4 x double]" : "[8 x float]", n_workers, elapsed_us * 1e-3,
+            (double)job.width * job.height / elapsed_us);
+    for(unsigned i = 0; i < n_workers; i++)
+    {
+        fprintf(stderr, "  worker %u: %zu tiles%s\n", i, workers[i].n_done, workers[i].alive ? "" : " (lost)");
+    }
+    fprintf(stderr, "  re-issued: %zu slow, %zu from lost workers, %zu answers came too late\n",
+            stats.n_speculative, stats.n_requeued, stats.n_wasted);
+    fprintf(stderr, "  received %.2lf MB of encoded counts, x%.1lf smaller than raw\n", stats.n_bytes * 1e-6,
+            (stats.n_bytes > 0) ? stats.n_raw_bytes / stats.n_bytes : 0);
+
+    for(unsigned i = 0; i < n_workers; i++) StopWorker(workers + i);
+
+    // A killed worker leaves its socket behind.
+    for(unsigned i = 0; i < job.n_local_workers; i++) unlink(socket_paths[i]);
+
+    bool written = false;
+    if(complete)
+    {
+        size_t n_pixels = (size_t)job.width * job.height;
+
+        bool  to_stdout = (strcmp(job.output, "-") == 0);
+        FILE *stream    = to_stdout ? stdout : fopen(job.output, "wb");
+        if(!stream) perror(job.output);
+
+        if(stream && job.format == OUTPUT_COUNTS)
+        {
+            WriteCounts(stream, counts, job.width, job.height);
+        }
+        else if(stream && job.format == OUTPUT_ENCODED)
+        {
+            WriteEncodedCounts(stream, counts, job.width, job.height);
+        }
+        else if(stream)
+        {
+            uint8_t *pixels = (uint8_t *)calloc(n_pixels, 4 * sizeof(uint8_t));
+            ColorMandelbrot(pixels, counts, n_pixels);
+
+            if(job.format == OUTPUT_PNG) WritePNG(stream, pixels, job.width, job.height);
+            else WritePPM(stream, pixels, job.width, job.height);
+
+            free(pixels);
+        }
+
+        if(stream)
+        {
+            written = !ferror(stream);
+            if(!to_stdout) written = (fclose(stream) == 0) && written;
+        }
+    }
+// ================================================================================================================================================================================
+    for(unsigned i = 0; i < n_workers; i++)
+    {
+        free(workers[i].decoded);
+        free(workers[i].payload);
+    }
+
+    free(fd_owner);
+    free(fds);
+    free(queue.ids);
+    free(counts);
+    free(tiles);
+    free(socket_paths);
+    free(workers);
+
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+// ================================================================================================================================================================================
+}
+
+bool ParseOptions(RenderJob *job, int argc, const char *argv[])
+{
+    bool format_set = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char *arg   = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(arg[0] != '-' || strcmp(arg, "-") == 0)
+        {
+            if(job->output) return false;
+            job->output = arg;
+            continue;
+        }
+
+        if(strcmp(arg, "--double") == 0)
+        {
+            job->high_precision = true;
+            continue;
+        }
+
+        if(!value) return false;
+        i++;
+
+        if(strcmp(arg, "--server") == 0)
+        {
+            job->server = value;
+            continue;
+        }
+
+        if(strcmp(arg, "--connect") == 0)
+        {
+            if(job->n_remote + job->n_local_workers >= MAX_WORKERS) return false;
+            job->remote[job->n_remote++] = value;
+            continue;
+        }
+
+        if(strcmp(arg, "--format") == 0)
+        {
+            if     (strcmp(value, "ppm")     == 0) job->format = OUTPUT_PPM;
+            else if(strcmp(value, "png")     == 0) job->format = OUTPUT_PNG;
+            else if(strcmp(value, "counts")  == 0) job->format = OUTPUT_COUNTS;
+            else if(strcmp(value, "zcounts") == 0) job->format = OUTPUT_ENCODED;
+            else return false;
+            format_set = true;
+            continue;
+        }
+
+        char *end = NULL;
+        if     (strcmp(arg, "--width")      == 0) job->width           = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--height")     == 0) job->height          = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--x")          == 0) job->center_x        = strtod(value, &end);
+        else if(strcmp(arg, "--y")          == 0) job->center_y        = strtod(value, &end);
+        else if(strcmp(arg, "--span")       == 0) job->span            = strtod(value, &end);
+        else if(strcmp(arg, "--iterations") == 0) job->n_iterations    = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--tile")       == 0) job->tile_size       = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--workers")    == 0) job->n_local_workers = (unsigned)strtoul(value, &end, 10);
+        else if(strcmp(arg, "--kill-after") == 0) job->kill_after      = (unsigned)strtoul(value, &end, 10);
+        else return false;
+
+        if(end == value || *end != '\0') return false;
+    }
+
+    if(job->n_local_workers + job->n_remote == 0) job->n_local_workers = 1;
+
+    if(!job->output || job->width == 0 || job->height == 0 || job->n_iterations == 0 || !(job->span > 0) ||
+       job->tile_size == 0 || job->tile_size > 4096 || job->n_local_workers + job->n_remote > MAX_WORKERS) return false;
+
+    if(!format_set)
+    {
+        const char *extension = strrchr(job->output, '.');
+        if     (extension && strcmp(extension, ".png")     == 0) job->format = OUTPUT_PNG;
+        else if(extension && strcmp(extension, ".counts")  == 0) job->format = OUTPUT_COUNTS;
+        else if(extension && strcmp(extension, ".zcounts") == 0) job->format = OUTPUT_ENCODED;
+    }
+
+    return true;
+}
+
+void PrintUsage(const char *program)
+{
+    fprintf(stderr,
+            "usage: %s [options] output\n"
+            "  --width N --height N      image size (1920x1080)\n"
+            "  --x X --y Y --span S      center and extent along the longer side (0, 0, 4)\n"
+            "  --iterations N            iteration limit (255)\n"
+            "  --double                  use the [4 x double] kernel\n"
+            "  --tile N                  tile size in pixels (128)\n"
+            "  --workers N               local worker processes to start (1 unless --connect is given)\n"
+            "  --connect ADDRESS         use a running mandelbrot-server: socket path or localhost port, may repeat\n"
+            "  --server PATH             worker executable (mandelbrot-server.out next to this one)\n"
+            "  --kill-after N            kill the first local worker after N tiles\n"
+            "  --format F                ppm, png, counts or zcounts (encoded counts), by default from the extension\n",
+            program);
+}
+
+// Runs a tile server as a child process on its own socket and connects to it. Workers render every tile as it comes:
+// the coordinator already keeps them busy, batching would only add latency.
+bool StartWorker(Worker *worker, const char *server, unsigned index, char *socket_path)
+{
+    snprintf(socket_path, PATH_SIZE, "/tmp/mandelbrot-worker-%d-%u.sock", (int)getpid(), index);
+
+    pid_t pid = fork();
+    if(pid < 0)
+    {
+        perror("fork");
+        return false;
+    }
+
+    if(pid == 0)
+    {
+        FILE *null = freopen("/dev/null", "w", stderr);
+        (void)null;
+
+        execl(server, server, "--socket", socket_path, "--batch", "1", "--window", "0", (char *)NULL);
+        _exit(127);
+    }
+
+    worker->pid = pid;
+
+    // The socket appears once the worker is up.
+    SocketAddress address = {socket_path, 0};
+    for(unsigned waited_ms = 0; waited_ms < WORKER_START_MS; waited_ms += POLL_INTERVAL_MS)
+    {
+        if(access(socket_path, F_OK) == 0)
+        {
+            worker->fd = OpenSocket(address, false);
+            if(worker->fd >= 0) break;
+        }
+
+        if(waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            worker->pid = 0;
+            break;
+        }
+        usleep(POLL_INTERVAL_MS * 1000);
+    }
+
+    if(worker->fd < 0)
+    {
+        fprintf(stderr, "worker %u did not start (%s)\n", index, server);
+        return false;
+    }
+
+    worker->alive = true;
+    return true;
+}
+
+// A running server given by a socket path or by a localhost port.
+bool ConnectWorker(Worker *worker, const char *address)
+{
+    char *end = NULL;
+    unsigned port = (unsigned)strtoul(address, &end, 10);
+
+    SocketAddress socket_address = {address, 0};
+    if(end != address && *end == '\0') socket_address.port = port;
+
+    worker->fd    = OpenSocket(socket_address, false);
+    worker->alive = (worker->fd >= 0);
+
+    return worker->alive;
+}
+
+void StopWorker(Worker *worker)
+{
+    if(worker->fd >= 0) close(worker->fd);
+    worker->fd    = -1;
+    worker->alive = false;
+
+    if(worker->pid)
+    {
+        kill(worker->pid, SIGTERM);
+        waitpid(worker->pid, NULL, 0);
+        worker->pid = 0;
+    }
+}
+
+bool DispatchTile(Worker *worker, unsigned id, const Tile *tiles, const RenderJob *job, double x_rend, double y_rend, double delta)
+{
+    const Tile *tile = tiles + id;
+
+    TileRequest request = {};
+    request.id             = id;
+    request.width          = tile->width;
+    request.height         = tile->height;
+    request.n_iterations   = job->n_iterations;
+    request.format         = TILE_COUNTS_ENCODED;
+    request.high_precision = job->high_precision;
+    request.x_offset       = tile->x_pos;
+    request.y_offset       = tile->y_pos;
+    request.x_rend         = x_rend;
+    request.y_rend         = y_rend;
+    request.delta          = delta;
+
+    if(send(worker->fd, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request)) return false;
+
+    worker->in_flight[worker->n_in_flight] = id;
+    worker->sent_us  [worker->n_in_flight] = NowUs();
+    worker->n_in_flight++;
+
+    return true;
+}
+
+// Reads what has arrived from the worker and copies every completed tile into the image. Returns false if the worker
+// has gone or sent something it should not have.
+bool ReadWorker(Worker *worker, Tile *tiles, unsigned n_tiles, unsigned *counts, const RenderJob *job, RenderStats *stats)
+{
+    ssize_t n_read = 0;
+    if(worker->n_response < sizeof(TileResponse))
+    {
+        n_read = recv(worker->fd, (uint8_t *)&worker->response + worker->n_response, sizeof(TileResponse) - worker->n_response, 0);
+        if(n_read <= 0) return n_read < 0 && errno == EINTR;
+
+        worker->n_response += n_read;
+        if(worker->n_response < sizeof(TileResponse)) return true;
+
+        const TileResponse *response = &worker->response;
+        if(response->status != TILE_OK || response->id >= n_tiles) return false;
+
+        const Tile *tile = tiles + response->id;
+        if(response->size > EncodedCountsBound((size_t)tile->width * tile->height)) return false;
+
+        worker->n_payload = 0;
+    }
+
+    const TileResponse *response = &worker->response;
+    if(worker->n_payload < response->size)
+    {
+        n_read = recv(worker->fd, worker->payload + worker->n_payload, response->size - worker->n_payload, 0);
+        if(n_read <= 0) return n_read < 0 && errno == EINTR;
+
+        worker->n_payload += n_read;
+        if(worker->n_payload < response->size) return true;
+    }
+
+    unsigned slot = 0;
+    while(slot < worker->n_in_flight && worker->in_flight[slot] != response->id) slot++;
+    if(slot == worker->n_in_flight) return false;
+
+    double tile_us = NowUs() - worker->sent_us[slot];
+    worker->n_in_flight--;
+    worker->in_flight[slot] = worker->in_flight[worker->n_in_flight];
+    worker->sent_us  [slot] = worker->sent_us  [worker->n_in_flight];
+    worker->n_response = 0;
+
+    Tile *tile = tiles + response->id;
+    tile->n_copies--;
+    if(tile->state == TILE_DONE)
+    {
+        stats->n_wasted++;
+        return true;
+    }
+
+    const unsigned *tile_counts = worker->decoded;
+    if(!DecodeCounts(worker->decoded, (size_t)tile->width * tile->height, worker->payload, response->size)) return false;
+    stats->n_bytes     += response->size;
+    stats->n_raw_bytes += (double)tile->width * tile->height * sizeof(unsigned);
+
+    for(unsigned y_pos = 0; y_pos < tile->height; y_pos++)
+    {
+        memcpy(counts + (size_t)(tile->y_pos + y_pos) * job->width + tile->x_pos,
+               tile_counts + (size_t)y_pos * tile->width, tile->width * sizeof(unsigned));
+    }
+
+    tile->state = TILE_DONE;
+    worker->n_done++;
+    stats->n_done++;
+    stats->tile_us += tile_us;
+
+    return true;
+}
+
+// Tiles the worker was holding go back to the queue unless another worker also has them.
+void LoseWorker(Worker *worker, Tile *tiles, TileQueue *queue, RenderStats *stats)
+{
+    fprintf(stderr, "lost a worker with %u tiles in flight\n", worker->n_in_flight);
+
+    close(worker->fd);
+    worker->fd    = -1;
+    worker->alive = false;
+
+    for(unsigned i = 0; i < worker->n_in_flight; i++)
+    {
+        Tile *tile = tiles + worker->in_flight[i];
+        tile->n_copies--;
+
+        if(tile->state != TILE_DONE && tile->n_copies == 0)
+        {
+            tile->state = TILE_QUEUED;
+            PushTile(queue, worker->in_flight[i]);
+            stats->n_requeued++;
+        }
+    }
+    worker->n_in_flight = 0;
+}
+
+bool FindSlowTile(const Worker *workers, unsigned n_workers, const Worker *idle, const Tile *tiles, double mean_tile_us, unsigned *id)
+{
+    if(mean_tile_us <= 0) return false;
+
+    double now_us  = NowUs();
+    double max_age = SLOW_TILE_FACTOR * mean_tile_us;
+    bool   found   = false;
+
+    for(unsigned i = 0; i < n_workers; i++)
+    {
+        const Worker *worker = workers + i;
+        if(worker == idle || !worker->alive) continue;
+
+        for(unsigned slot = 0; slot < worker->n_in_flight; slot++)
+        {
+            const Tile *tile = tiles + worker->in_flight[slot];
+            double      age  = now_us - worker->sent_us[slot];
+
+            if(tile->state != TILE_DONE && tile->n_copies == 1 && age > max_age)
+            {
+                max_age = age;
+                *id     = worker->in_flight[slot];
+                found   = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+inline void PushTile(TileQueue *queue, unsigned id)
+{
+    queue->ids[(queue->head + queue->size) % queue->capacity] = id;
+    queue->size++;
+}
+
+inline bool PopTile(TileQueue *queue, unsigned *id)
+{
+    if(queue->size == 0) return false;
+
+    *id = queue->ids[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->size--;
+
+    return true;
+}
@@ -0,0 +1,809 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Image.h"
+#include "Mandelbrot.h"
+#include "TileCodec.h"
+#include "TileProtocol.h"
+
+#if !defined(LOADGEN)
+
+const unsigned MAX_CLIENTS         = 256;
+const unsigned CLIENT_BUFFER       = 64;       // requests
+const size_t   MAX_CLIENT_BACKLOG  = 64 << 20; // bytes of unsent responses before a client's requests are held back
+const uint64_t MAX_TILE_PIXELS     = 4096 * 4096;
+const unsigned MAX_TILE_ITERATIONS = 1 << 20;
+const uint64_t MAX_VIEW_SIDE       = 1 << 20;  // columns and rows of the view a tile is cut from
+
+struct ServerOptions
+{
+    SocketAddress address;
+    unsigned      batch_size;
+    unsigned      batch_window_us;
+};
+
+struct Client
+{
+    int      fd;
+    unsigned serial; // changes when the slot is closed, so tiles of a closed client are not sent to the next one
+
+    uint8_t in[CLIENT_BUFFER * sizeof(TileRequest)];
+    size_t  n_in;
+
+    uint8_t *out;
+    size_t   out_size;
+    size_t   out_sent;
+    size_t   out_capacity;
+};
+
+struct PendingTile
+{
+    unsigned    client;
+    unsigned    serial;
+    TileRequest request;
+};
+
+struct ServerStats
+{
+    size_t n_tiles;
+    size_t n_batches;
+    size_t n_renders;
+    size_t n_rejected;
+    double n_pixels;
+    double render_us;
+};
+
+volatile sig_atomic_t stop_requested = 0;
+
+bool ParseOptions(ServerOptions *options, int argc, const char *argv[]);
+void Stop(int signal_number);
+
+void AcceptClients(int listen_fd, Client *clients);
+bool ReadClient(Client *client);
+bool FlushClient(Client *client);
+void CloseClient(Client *client);
+void SendTile(Client *client, uint32_t id, TileStatus status, const void *payload, uint64_t size);
+
+size_t TakeRequests(Client *clients, PendingTile *pending, size_t n_free, ServerStats *stats);
+void ProcessBatch(PendingTile *pending, size_t n_pending, Client *clients, ServerStats *stats);
+template<typename REAL>
+void RenderTile(unsigned *counts, const TileRequest *request);
+bool ValidRequest(const TileRequest *request);
+int CompareTiles(const void *first, const void *second);
+bool SameView(const TileRequest *first, const TileRequest *second);
+
+int main(int argc, const char *argv[])
+{
+// ================================================================================================================================================================================
+    ServerOptions options = {{DEFAULT_SOCKET, 0}, 32, 200};
+    if(!ParseOptions(&options, argc, argv))
+    {
+        fprintf(stderr,
+                "usage: %s [--socket PATH | --port N] [--batch N] [--window US]\n"
+                "  --socket PATH   Unix socket to listen on (%s)\n"
+                "  --port N        listen on 127.0.0.1:N instead\n"
+                "  --batch N       most tiles rendered in one batch (32)\n"
+                "  --window US     how long the first tile of a batch waits for more (200)\n",
+                argv[0], DEFAULT_SOCKET);
+        return EXIT_FAILURE;
+    }
+
+    int listen_fd = OpenSocket(options.address, true);
+    if(listen_fd < 0) return EXIT_FAILURE;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT,  Stop);
+    signal(SIGTERM, Stop);
+
+    if(options.address.port) fprintf(stderr, "listening on 127.0.0.1:%u\n", options.address.port);
+    else fprintf(stderr, "listening on %s\n", options.address.path);
+// ================================================================================================================================================================================
+    Client      *clients  = (Client      *)calloc(MAX_CLIENTS,        sizeof(Client));
+    PendingTile *pending  = (PendingTile *)calloc(options.batch_size, sizeof(PendingTile));
+    pollfd      *fds      = (pollfd      *)calloc(MAX_CLIENTS + 1,    sizeof(pollfd));
+    unsigned    *fd_owner = (unsigned    *)calloc(MAX_CLIENTS + 1,    sizeof(unsigned));
+
+    for(unsigned i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+
+    ServerStats stats = {};
+
+    size_t n_pending   = 0;
+    double batch_start = 0;
+// ================================================================================================================================================================================
+    while(!stop_requested)
+    {
+        if(n_pending < options.batch_size)
+        {
+            size_t n_taken = TakeRequests(clients, pending + n_pending, options.batch_size - n_pending, &stats);
+            if(n_pending == 0 && n_taken) batch_start = NowUs();
+            n_pending += n_taken;
+        }
+
+        // A batch is closed when it is full or its first tile has waited long enough: under load batches fill up at once,
+        // a lone request pays at most the window.
+        double batch_left_us = batch_start + options.batch_window_us - NowUs();
+        if(n_pending && (n_pending == options.batch_size || batch_left_us <= 0))
+        {
+            ProcessBatch(pending, n_pending, clients, &stats);
+            n_pending = 0;
+
+            for(unsigned i = 0; i < MAX_CLIENTS; i++)
+            {
+                if(clients[i].fd >= 0 && !FlushClient(clients + i)) CloseClient(clients + i);
+            }
+            continue;
+        }
+
+        nfds_t n_fds = 0;
+        fds[n_fds++] = {listen_fd, POLLIN, 0};
+        for(unsigned i = 0; i < MAX_CLIENTS; i++)
+        {
+            Client *client = clients + i;
+            if(client->fd < 0) continue;
+
+            short events = 0;
+            if(client->n_in < sizeof(client->in)) events |= POLLIN;
+            if(client->out_sent < client->out_size) events |= POLLOUT;
+
+            fd_owner[n_fds] = i;
+            fds[n_fds++]    = {client->fd, events, 0};
+        }
+
+        timespec  timeout   = {};
+        timespec *timeout_p = NULL;
+        if(n_pending)
+        {
+            long wait_ns = (long)(batch_left_us * 1e3);
+            timeout   = {wait_ns / 1000000000, wait_ns % 1000000000};
+            timeout_p = &timeout;
+        }
+
+        int n_ready = ppoll(fds, n_fds, timeout_p, NULL);
+        if(n_ready < 0 && errno != EINTR)
+        {
+            perror("ppoll");
+            break;
+        }
+        if(n_ready <= 0) continue;
+
+        if(fds[0].revents & POLLIN) AcceptClients(listen_fd, clients);
+
+        for(nfds_t i = 1; i < n_fds; i++)
+        {
+            Client *client = clients + fd_owner[i];
+
+            bool open = true;
+            if(fds[i].revents & (POLLIN | POLLHUP | POLLERR)) open = ReadClient(client);
+            if(open && (fds[i].revents & POLLOUT)) open = FlushClient(client);
+            if(!open) CloseClient(client);
+        }
+    }
+// ================================================================================================================================================================================
+    fprintf(stderr, "%zu tiles in %zu batches (%.1lf per batch), %zu renders, %zu rejected\n",
+            stats.n_tiles, stats.n_batches, stats.n_batches ? (double)stats.n_tiles / stats.n_batches : 0.0, stats.n_renders, stats.n_rejected);
+    fprintf(stderr, "rendering: %.1lf Mpixel in %.1lf ms (%.1lf Mpixel/s)\n",
+            stats.n_pixels * 1e-6, stats.render_us * 1e-3, stats.render_us > 0 ? stats.n_pixels / stats.render_us : 0.0);
+
+    for(unsigned i = 0; i < MAX_CLIENTS; i++)
+    {
+        if(clients[i].fd >= 0) CloseClient(clients + i);
+        free(clients[i].out);
+    }
+
+    close(listen_fd);
+    if(!options.address.port) unlink(options.address.path);
+
+    free(fd_owner);
+    free(fds);
+    free(pending);
+    free(clients);
+
+    return EXIT_SUCCESS;
+// ================================================================================================================================================================================
+}
+
+bool ParseOptions(ServerOptions *options, int argc, const char *argv[])
+{
+    for(int i = 1; i < argc; i += 2)
+    {
+        const char *arg   = argv[i];
+        const char *value = argv[i + 1];
+        if(!value) return false;
+
+        if(strcmp(arg, "--socket") == 0)
+        {
+            options->address.path = value;
+            continue;
+        }
+
+        char *end = NULL;
+        unsigned number = (unsigned)strtoul(value, &end, 10);
+        if(end == value || *end != '\0') return false;
+
+        if     (strcmp(arg, "--port")   == 0) options->address.port     = number;
+        else if(strcmp(arg, "--batch")  == 0) options->batch_size       = number;
+        else if(strcmp(arg, "--window") == 0) options->batch_window_us  = number;
+        else return false;
+    }
+
+    return options->batch_size > 0 && options->address.port < 65536;
+}
+
+void Stop(int signal_number)
+{
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+void AcceptClients(int listen_fd, Client *clients)
+{
+    while(true)
+    {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK);
+        if(fd < 0) return;
+
+        Client *client = NULL;
+        for(unsigned i = 0; i < MAX_CLIENTS && !client; i++)
+        {
+            if(clients[i].fd < 0) client = clients + i;
+        }
+
+        if(!client)
+        {
+            fprintf(stderr, "too many clients, dropping a connection\n");
+            close(fd);
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        client->fd       = fd;
+        client->n_in     = 0;
+        client->out_size = 0;
+        client->out_sent = 0;
+    }
+}
+
+// Returns false when the client has gone.
+bool ReadClient(Client *client)
+{
+    if(client->n_in == sizeof(client->in)) return true;
+
+    ssize_t n_read = read(client->fd, client->in + client->n_in, sizeof(client->in) - client->n_in);
+    if(n_read > 0)
+    {
+        client->n_in += n_read;
+        return true;
+    }
+
+    return n_read < 0 && (errno == EAGAIN || errno == EINTR);
+}
+
+bool FlushClient(Client *client)
+{
+    while(client->out_sent < client->out_size)
+    {
+        ssize_t n_sent = send(client->fd, client->out + client->out_sent, client->out_size - client->out_sent, MSG_NOSIGNAL);
+        if(n_sent < 0) return errno == EAGAIN || errno == EINTR;
+
+        client->out_sent += n_sent;
+    }
+
+    client->out_size = 0;
+    client->out_sent = 0;
+
+    return true;
+}
+
+void CloseClient(Client *client)
+{
+    close(client->fd);
+
+    client->fd = -1;
+    client->serial++;
+    client->n_in     = 0;
+    client->out_size = 0;
+    client->out_sent = 0;
+}
+
+// Queues the response, it goes out with the next FlushClient.
+void SendTile(Client *client, uint32_t id, TileStatus status, const void *payload, uint64_t size)
+{
+    TileResponse response = {id, status, size};
+
+    size_t needed = client->out_size + sizeof(response) + size;
+    if(needed > client->out_capacity)
+    {
+        size_t capacity = client->out_capacity ? client->out_capacity : 1 << 16;
+        while(capacity < needed) capacity *= 2;
+
+        client->out          = (uint8_t *)realloc(client->out, capacity);
+        client->out_capacity = capacity;
+    }
+
+    memcpy(client->out + client->out_size, &response, sizeof(response));
+    client->out_size += sizeof(response);
+
+    if(size) memcpy(client->out + client->out_size, payload, size);
+    client->out_size += size;
+}
+
+// Moves complete requests from the client buffers into the batch, one per client in turn so that a client with a deep
+// pipeline does not fill every batch by itself. Invalid requests are answered right away.
+size_t TakeRequests(Client *clients, PendingTile *pending, size_t n_free, ServerStats *stats)
+{
+    size_t n_taken = 0;
+
+    bool took = true;
+    while(took && n_taken < n_free)
+    {
+        took = false;
+        for(unsigned i = 0; i < MAX_CLIENTS && n_taken < n_free; i++)
+        {
+            Client *client = clients + i;
+            if(client->fd < 0 || client->n_in < sizeof(TileRequest)) continue;
+            if(client->out_size - client->out_sent > MAX_CLIENT_BACKLOG) continue;
+
+            TileRequest request = {};
+            memcpy(&request, client->in, sizeof(request));
+
+            client->n_in -= sizeof(request);
+            memmove(client->in, client->in + sizeof(request), client->n_in);
+            took = true;
+
+            if(!ValidRequest(&request))
+            {
+                SendTile(client, request.id, TILE_BAD_REQUEST, NULL, 0);
+                stats->n_rejected++;
+                continue;
+            }
+
+            pending[n_taken++] = {i, client->serial, request};
+        }
+    }
+
+    return n_taken;
+}
+
+// Renders a batch. Tiles are sorted so that requests for the same view are rendered once, and the ones using the same
+// kernel and iteration limit are rendered back to back.
+void ProcessBatch(PendingTile *pending, size_t n_pending, Client *clients, ServerStats *stats)
+{
+    static unsigned *counts        = NULL;
+    static uint8_t  *pixels        = NULL;
+    static size_t    buffer_pixels = 0;
+
+    qsort(pending, n_pending, sizeof(PendingTile), CompareTiles);
+
+    size_t first = 0;
+    while(first < n_pending)
+    {
+        size_t last = first + 1;
+        while(last < n_pending && SameView(&pending[first].request, &pending[last].request)) last++;
+
+        const TileRequest *view = &pending[first].request;
+        size_t n_pixels = (size_t)view->width * view->height;
+
+        if(n_pixels > buffer_pixels)
+        {
+            counts = (unsigned *)realloc(counts, n_pixels * sizeof(unsigned));
+            pixels = (uint8_t  *)realloc(pixels, n_pixels * 4 * sizeof(uint8_t));
+            buffer_pixels = n_pixels;
+        }
+
+        double start_us = NowUs();
+        if(view->high_precision) RenderTile<double>(counts, view);
+        else RenderTile<float>(counts, view);
+        stats->render_us += NowUs() - start_us;
+        stats->n_pixels  += n_pixels;
+        stats->n_renders++;
+
+        bool     colored      = false;
+        char    *png          = NULL;
+        size_t   png_size     = 0;
+        uint8_t *encoded      = NULL;
+        size_t   encoded_size = 0;
+
+        for(size_t i = first; i < last; i++)
+        {
+            Client *client = clients + pending[i].client;
+            if(client->fd < 0 || client->serial != pending[i].serial) continue;
+
+            uint32_t id = pending[i].request.id;
+            if(pending[i].request.format == TILE_COUNTS)
+            {
+                SendTile(client, id, TILE_OK, counts, n_pixels * sizeof(unsigned));
+                stats->n_tiles++;
+                continue;
+            }
+
+            if(pending[i].request.format == TILE_COUNTS_ENCODED)
+            {
+                if(!encoded)
+                {
+                    encoded      = (uint8_t *)calloc(EncodedCountsBound(n_pixels), 1);
+                    encoded_size = EncodeCounts(encoded, counts, n_pixels);
+                }
+                SendTile(client, id, TILE_OK, encoded, encoded_size);
+                stats->n_tiles++;
+                continue;
+            }
+
+            if(!colored) ColorMandelbrot(pixels, counts, n_pixels);
+            colored = true;
+
+            if(pending[i].request.format == TILE_RGBA)
+            {
+                SendTile(client, id, TILE_OK, pixels, n_pixels * 4);
+            }
+            else
+            {
+                if(!png)
+                {
+                    FILE *stream = open_memstream(&png, &png_size);
+                    WritePNG(stream, pixels, view->width, view->height);
+                    fclose(stream);
+                }
+                SendTile(client, id, TILE_OK, png, png_size);
+            }
+            stats->n_tiles++;
+        }
+
+        free(encoded);
+        free(png);
+        first = last;
+    }
+
+    stats->n_batches++;
+}
+
+// A tile at the top left corner of its view is rendered by the grid kernel, mirrored rows and all. Any other tile takes
+// its points from GridCoordinates of the view up to its bottom right corner, so that it gets the same counts as the
+// whole view would have there.
+template<typename REAL>
+void RenderTile(unsigned *counts, const TileRequest *request)
+{
+    static REAL  *x_grid        = NULL;
+    static REAL  *y_grid        = NULL;
+    static REAL  *x             = NULL;
+    static REAL  *y             = NULL;
+    static size_t grid_capacity = 0;
+    static size_t capacity      = 0;
+
+    if(request->x_offset == 0 && request->y_offset == 0)
+    {
+        RenderMandelbrotCounts(counts, request->width, request->height, (REAL)request->x_rend, (REAL)request->y_rend, (REAL)request->delta,
+                               request->n_iterations, true);
+        return;
+    }
+
+    unsigned view_width  = request->x_offset + request->width;
+    unsigned view_height = request->y_offset + request->height;
+    size_t   n_pixels    = (size_t)request->width * request->height;
+
+    if(grid_capacity < (size_t)view_width + view_height)
+    {
+        grid_capacity = (size_t)view_width + view_height;
+        x_grid = (REAL *)realloc(x_grid, grid_capacity * sizeof(REAL));
+        y_grid = (REAL *)realloc(y_grid, grid_capacity * sizeof(REAL));
+    }
+    if(capacity < n_pixels)
+    {
+        capacity = n_pixels;
+        x = (REAL *)realloc(x, capacity * sizeof(REAL));
+        y = (REAL *)realloc(y, capacity * sizeof(REAL));
+    }
+
+    GridCoordinates(x_grid, y_grid, view_width, view_height, (REAL)request->x_rend, (REAL)request->y_rend, (REAL)request->delta);
+    for(size_t pix = 0; pix < n_pixels; pix++)
+    {
+        x[pix] = x_grid[request->x_offset + pix % request->width];
+        y[pix] = y_grid[request->y_offset + pix / request->width];
+    }
+
+    RenderMandelbrotPoints(counts, NULL, x, y, n_pixels, request->n_iterations);
+}
+
+bool ValidRequest(const TileRequest *request)
+{
+    return request->width > 0 && request->height > 0 && (uint64_t)request->width * request->height <= MAX_TILE_PIXELS &&
+           (uint64_t)request->x_offset + request->width <= MAX_VIEW_SIDE && (uint64_t)request->y_offset + request->height <= MAX_VIEW_SIDE &&
+           request->n_iterations > 0 && request->n_iterations <= MAX_TILE_ITERATIONS && request->format <= TILE_COUNTS_ENCODED &&
+           isfinite(request->x_rend) && isfinite(request->y_rend) && isfinite(request->delta) && request->delta > 0;
+}
+
+int CompareTiles(const void *first, const void *second)
+{
+    const TileRequest *a = &((const PendingTile *)first )->request;
+    const TileRequest *b = &((const PendingTile *)second)->request;
+
+    if(a->high_precision != b->high_precision) return (a->high_precision < b->high_precision) ? -1 : 1;
+    if(a->n_iterations   != b->n_iterations)   return (a->n_iterations   < b->n_iterations)   ? -1 : 1;
+    if(a->width          != b->width)          return (a->width          < b->width)          ? -1 : 1;
+    if(a->height         != b->height)         return (a->height         < b->height)         ? -1 : 1;
+    if(a->delta          != b->delta)          return (a->delta          < b->delta)          ? -1 : 1;
+    if(a->y_rend         != b->y_rend)         return (a->y_rend         < b->y_rend)         ? -1 : 1;
+    if(a->x_rend         != b->x_rend)         return (a->x_rend         < b->x_rend)         ? -1 : 1;
+    if(a->y_offset       != b->y_offset)       return (a->y_offset       < b->y_offset)       ? -1 : 1;
+    if(a->x_offset       != b->x_offset)       return (a->x_offset       < b->x_offset)       ? -1 : 1;
+
+    return 0;
+}
+
+bool SameView(const TileRequest *first, const TileRequest *second)
+{
+    return first->high_precision == second->high_precision && first->n_iterations == second->n_iterations &&
+           first->width == second->width && first->height == second->height &&
+           first->delta == second->delta && first->y_rend == second->y_rend && first->x_rend == second->x_rend &&
+           first->x_offset == second->x_offset && first->y_offset == second->y_offset;
+}
+
+#else
+
+struct LoadOptions
+{
+    SocketAddress address;
+
+    unsigned n_connections;
+    unsigned depth;
+    unsigned n_requests;
+
+    unsigned   tile_size;
+    unsigned   n_iterations;
+    unsigned   max_zoom;
+    TileFormat format;
+    bool       high_precision;
+};
+
+struct Connection
+{
+    int      fd;
+    unsigned n_in_flight;
+
+    uint8_t  header[sizeof(TileResponse)];
+    size_t   n_header;
+    uint64_t payload_left;
+};
+
+bool ParseOptions(LoadOptions *options, int argc, const char *argv[]);
+void MakeRequest(TileRequest *request, uint32_t id, const LoadOptions *options, unsigned *seed);
+int CompareDoubles(const void *first, const void *second);
+
+int main(int argc, const char *argv[])
+{
+// ================================================================================================================================================================================
+    LoadOptions options = {{DEFAULT_SOCKET, 0}, 4, 4, 2000, 256, 255, 4, TILE_COUNTS, false};
+    if(!ParseOptions(&options, argc, argv))
+    {
+        fprintf(stderr,
+                "usage: %s [options]\n"
+                "  --socket PATH | --port N   server address (%s)\n"
+                "  --connections N            concurrent connections (4)\n"
+                "  --depth N                  requests in flight per connection (4)\n"
+                "  --requests N               tiles to request in total (2000)\n"
+                "  --tile N                   tile size in pixels (256)\n"
+                "  --iterations N             iteration limit (255)\n"
+                "  --zoom N                   deepest zoom level, level z has 2^z x 2^z tiles (4)\n"
+                "  --format F                 counts, encoded (compressed counts), rgba or png (counts)\n"
+                "  --double                   ask for the [4 x double] kernel\n",
+                argv[0], DEFAULT_SOCKET);
+        return EXIT_FAILURE;
+    }
+
+    Connection *connections = (Connection *)calloc(options.n_connections, sizeof(Connection));
+    pollfd     *fds         = (pollfd     *)calloc(options.n_connections, sizeof(pollfd));
+
+    for(unsigned i = 0; i < options.n_connections; i++)
+    {
+        connections[i].fd = OpenSocket(options.address, false);
+        if(connections[i].fd < 0) return EXIT_FAILURE;
+    }
+// ================================================================================================================================================================================
+    double *sent_us    = (double *)calloc(options.n_requests, sizeof(double));
+    double *latency_us = (double *)calloc(options.n_requests, sizeof(double));
+
+    const size_t SCRATCH_SIZE = 1 << 16;
+    uint8_t *scratch = (uint8_t *)calloc(SCRATCH_SIZE, 1);
+
+    unsigned seed     = 1;
+    unsigned n_sent   = 0;
+    unsigned n_done   = 0;
+    unsigned n_errors = 0;
+    double   n_bytes  = 0;
+
+    double start_us = NowUs();
+    while(n_done < options.n_requests)
+    {
+        for(unsigned i = 0; i < options.n_connections; i++)
+        {
+            Connection *connection = connections + i;
+            while(connection->n_in_flight < options.depth && n_sent < options.n_requests)
+            {
+                TileRequest request = {};
+                MakeRequest(&request, n_sent, &options, &seed);
+
+                sent_us[n_sent++] = NowUs();
+                if(send(connection->fd, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request))
+                {
+                    perror("send");
+                    return EXIT_FAILURE;
+                }
+                connection->n_in_flight++;
+            }
+            fds[i] = {connection->fd, POLLIN, 0};
+        }
+
+        if(poll(fds, options.n_connections, -1) < 0)
+        {
+            perror("poll");
+            return EXIT_FAILURE;
+        }
+
+        for(unsigned i = 0; i < options.n_connections; i++)
+        {
+            if(!fds[i].revents) continue;
+
+            Connection *connection = connections + i;
+            ssize_t n_read = recv(connection->fd, scratch, SCRATCH_SIZE, 0);
+            if(n_read <= 0)
+            {
+                fprintf(stderr, "server closed the connection\n");
+                return EXIT_FAILURE;
+            }
+            n_bytes += n_read;
+
+            // The stream is header, payload, header, payload... Payloads are only counted.
+            uint8_t *data = scratch;
+            while(n_read > 0)
+            {
+                if(connection->n_header < sizeof(TileResponse))
+                {
+                    size_t n_copy = sizeof(TileResponse) - connection->n_header;
+                    if(n_copy > (size_t)n_read) n_copy = n_read;
+
+                    memcpy(connection->header + connection->n_header, data, n_copy);
+                    connection->n_header += n_copy;
+                    data   += n_copy;
+                    n_read -= n_copy;
+
+                    if(connection->n_header < sizeof(TileResponse)) break;
+
+                    TileResponse response = {};
+                    memcpy(&response, connection->header, sizeof(response));
+                    connection->payload_left = response.size;
+                    if(response.status != TILE_OK) n_errors++;
+                }
+
+                uint64_t n_skip = (connection->payload_left < (uint64_t)n_read) ? connection->payload_left : n_read;
+                connection->payload_left -= n_skip;
+                data   += n_skip;
+                n_read -= n_skip;
+
+                if(connection->payload_left == 0)
+                {
+                    TileResponse response = {};
+                    memcpy(&response, connection->header, sizeof(response));
+
+                    latency_us[n_done++] = NowUs() - sent_us[response.id];
+                    connection->n_in_flight--;
+                    connection->n_header = 0;
+                }
+            }
+        }
+    }
+    double elapsed_us = NowUs() - start_us;
+// ================================================================================================================================================================================
+    qsort(latency_us, n_done, sizeof(double), CompareDoubles);
+
+    printf("%u tiles %ux%u, %u iterations, %u connections x %u in flight\n",
+           n_done, options.tile_size, options.tile_size, options.n_iterations, options.n_connections, options.depth);
+    printf("%.0lf tiles/s, %.1lf MB/s\n", n_done / (elapsed_us * 1e-6), n_bytes / elapsed_us);
+    printf("latency: p50 %.2lf ms, p99 %.2lf ms, max %.2lf ms\n",
+           latency_us[n_done / 2] * 1e-3, latency_us[(size_t)n_done * 99 / 100] * 1e-3, latency_us[n_done - 1] * 1e-3);
+    if(n_errors) printf("%u requests rejected\n", n_errors);
+
+    for(unsigned i = 0; i < options.n_connections; i++) close(connections[i].fd);
+
+    free(scratch);
+    free(latency_us);
+    free(sent_us);
+    free(fds);
+    free(connections);
+
+    return n_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+// ================================================================================================================================================================================
+}
+
+bool ParseOptions(LoadOptions *options, int argc, const char *argv[])
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char *arg   = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(strcmp(arg, "--double") == 0)
+        {
+            options->high_precision = true;
+            continue;
+        }
+
+        if(!value) return false;
+        i++;
+
+        if(strcmp(arg, "--socket") == 0)
+        {
+            options->address.path = value;
+            continue;
+        }
+
+        if(strcmp(arg, "--format") == 0)
+        {
+            if     (strcmp(value, "counts")  == 0) options->format = TILE_COUNTS;
+            else if(strcmp(value, "encoded") == 0) options->format = TILE_COUNTS_ENCODED;
+            else if(strcmp(value, "rgba")    == 0) options->format = TILE_RGBA;
+            else if(strcmp(value, "png")     == 0) options->format = TILE_PNG;
+            else return false;
+            continue;
+        }
+
+        char *end = NULL;
+        unsigned number = (unsigned)strtoul(value, &end, 10);
+        if(end == value || *end != '\0') return false;
+
+        if     (strcmp(arg, "--port")        == 0) options->address.port  = number;
+        else if(strcmp(arg, "--connections") == 0) options->n_connections = number;
+        else if(strcmp(arg, "--depth")       == 0) options->depth         = number;
+        else if(strcmp(arg, "--requests")    == 0) options->n_requests    = number;
+        else if(strcmp(arg, "--tile")        == 0) options->tile_size     = number;
+        else if(strcmp(arg, "--iterations")  == 0) options->n_iterations  = number;
+        else if(strcmp(arg, "--zoom")        == 0) options->max_zoom      = number;
+        else return false;
+    }
+
+    return options->n_connections > 0 && options->depth > 0 && options->n_requests > 0 && options->tile_size > 0 &&
+           options->n_iterations > 0 && options->max_zoom < 24 && options->address.port < 65536;
+}
+
+// A random tile of a map pyramid over the square [-2.5, 1.5] x [-2, 2]. Zoom levels are equally likely, so the coarse
+// tiles are asked for again and again, as dashboards showing the same map would do.
+void MakeRequest(TileRequest *request, uint32_t id, const LoadOptions *options, unsigned *seed)
+{
+    unsigned zoom    = rand_r(seed) % (options->max_zoom + 1);
+    unsigned n_tiles = 1u << zoom;
+    unsigned x_tile  = rand_r(seed) % n_tiles;
+    unsigned y_tile  = rand_r(seed) % n_tiles;
+
+    double delta = 2 * MAX_ZERO_OFFSET / ((double)options->tile_size * n_tiles);
+
+    request->id             = id;
+    request->width          = options->tile_size;
+    request->height         = options->tile_size;
+    request->n_iterations   = options->n_iterations;
+    request->format         = options->format;
+    request->high_precision = options->high_precision;
+    request->x_rend         = -2.5 + delta * options->tile_size * x_tile;
+    request->y_rend         =  2.0 - delta * options->tile_size * y_tile;
+    request->delta          = delta;
+}
+
+int CompareDoubles(const void *first, const void *second)
+{
+    double a = *(const double *)first;
+    double b = *(const double *)second;
+
+    return (a > b) - (a < b);
+}
+
+#endif
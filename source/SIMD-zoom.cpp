@@ -0,0 +1,340 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Mandelbrot.h"
+#include "PerfCounters.h"
+
+const unsigned VIDEO_WIDTH  = 640;
+const unsigned VIDEO_HEIGHT = 360;
+const unsigned VIDEO_FPS    = 60;
+
+const unsigned N_FRAMES       = 1200;
+const double   ZOOM_PER_FRAME = 1.01;
+
+const double ZOOM_X = -0.743643887037151;
+const double ZOOM_Y =  0.131825904205330;
+
+const unsigned N_ITERATIONS = 1023;
+
+const unsigned N_COMPARED_FRAMES = 5;
+
+// Exponential map of the zoom path: row i holds the circle of radius exp(s_min + i * ds) around (ZOOM_X, ZOOM_Y),
+// column j the angle 2 * pi * j / n_theta. Every frame of the video is a resampling of this single strip.
+struct ExpMap
+{
+    uint16_t *counts;
+
+    unsigned n_theta;
+    unsigned n_rows;
+
+    double s_min;
+    double ds;
+};
+
+// Frame independent part of the resampling: the angle column of each pixel and its log radius in strip rows.
+struct ExpMapLookup
+{
+    uint32_t *column;
+    float    *row_base;
+};
+
+struct YUVPalette
+{
+    uint8_t y[N_ITERATIONS + 1];
+    uint8_t u[N_ITERATIONS + 1];
+    uint8_t v[N_ITERATIONS + 1];
+};
+
+inline int64_t RenderExpMap(ExpMap *map, double delta_first, double delta_last);
+inline void BuildExpMapLookup(ExpMapLookup *lookup, const ExpMap *map);
+inline void ResampleFrame(unsigned *frame, const ExpMap *map, const ExpMapLookup *lookup, double delta);
+
+inline void RenderFrame(unsigned *frame, double delta);
+
+inline void BuildPalette(YUVPalette *palette);
+inline void WriteY4MHeader(FILE *stream);
+inline void WriteY4MFrame(FILE *stream, const unsigned *frame, const YUVPalette *palette, uint8_t *planes);
+
+void TestZoom(double delta_first, double delta_last);
+
+int main(int argc, const char *argv[])
+{
+// ================================================================================================================================================================================
+    double coefficient = (VIDEO_WIDTH > VIDEO_HEIGHT) ? VIDEO_WIDTH : VIDEO_HEIGHT;
+
+    double delta_first = 2 * MAX_ZERO_OFFSET / coefficient;
+    double delta_last  = delta_first / pow(ZOOM_PER_FRAME, N_FRAMES - 1);
+// ================================================================================================================================================================================
+#ifndef RENDER
+    (void)argc;
+    (void)argv;
+
+    TestZoom(delta_first, delta_last);
+#else
+    FILE *stream = stdout;
+    if(argc > 1 && strcmp(argv[1], "-") != 0)
+    {
+        stream = fopen(argv[1], "wb");
+        if(!stream)
+        {
+            perror(argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ExpMap map = {};
+    RenderExpMap(&map, delta_first, delta_last);
+
+    ExpMapLookup lookup = {};
+    BuildExpMapLookup(&lookup, &map);
+
+    YUVPalette palette = {};
+    BuildPalette(&palette);
+
+    unsigned *frame  = (unsigned *)calloc(VIDEO_WIDTH * VIDEO_HEIGHT, sizeof(unsigned));
+    uint8_t  *planes = (uint8_t  *)calloc(VIDEO_WIDTH * VIDEO_HEIGHT * 3 / 2, sizeof(uint8_t));
+
+    WriteY4MHeader(stream);
+
+    double delta = delta_first;
+    for(unsigned frame_n = 0; frame_n < N_FRAMES; frame_n++, delta /= ZOOM_PER_FRAME)
+    {
+        ResampleFrame(frame, &map, &lookup, delta);
+        WriteY4MFrame(stream, frame, &palette, planes);
+    }
+
+    if(stream != stdout) fclose(stream);
+
+    free(planes);
+    free(frame);
+    free(lookup.row_base);
+    free(lookup.column);
+    free(map.counts);
+#endif
+// ================================================================================================================================================================================
+    return EXIT_SUCCESS;
+// ================================================================================================================================================================================
+}
+
+inline int64_t RenderExpMap(ExpMap *map, double delta_first, double delta_last)
+{
+    int64_t start = TimeCounterStart();
+
+    // One strip column per pixel of arc on the outer edge of a frame, one row per same step of log radius,
+    // from the frame corner of the first frame down to half a pixel of the last one.
+    double half_diagonal = 0.5 * sqrt((double)VIDEO_WIDTH * VIDEO_WIDTH + (double)VIDEO_HEIGHT * VIDEO_HEIGHT);
+
+    map->n_theta = ((unsigned)ceil(2 * M_PI * half_diagonal) + 3) & ~3u;
+    map->ds      = 2 * M_PI / map->n_theta;
+    map->s_min   = log(0.5 * delta_last);
+
+    double s_max = log(half_diagonal * delta_first);
+    map->n_rows  = (unsigned)ceil((s_max - map->s_min) / map->ds) + 1;
+
+    map->counts = (uint16_t *)calloc((size_t)map->n_rows * map->n_theta, sizeof(uint16_t));
+
+    double   *cos_theta  = (double   *)calloc(map->n_theta, sizeof(double));
+    double   *sin_theta  = (double   *)calloc(map->n_theta, sizeof(double));
+    double   *x          = (double   *)calloc(map->n_theta, sizeof(double));
+    double   *y          = (double   *)calloc(map->n_theta, sizeof(double));
+    unsigned *row_counts = (unsigned *)calloc(map->n_theta, sizeof(unsigned));
+    for(unsigned col = 0; col < map->n_theta; col++)
+    {
+        cos_theta[col] = cos(col * map->ds);
+        sin_theta[col] = sin(col * map->ds);
+    }
+
+    // A row of the strip is a circle, not a grid row, so its points go through the [4 x double] point kernel.
+    uint16_t *counts = map->counts;
+    for(unsigned row = 0; row < map->n_rows; row++)
+    {
+        double r = exp(map->s_min + row * map->ds);
+        for(unsigned col = 0; col < map->n_theta; col++)
+        {
+            x[col] = ZOOM_X + r * cos_theta[col];
+            y[col] = ZOOM_Y + r * sin_theta[col];
+        }
+
+        RenderMandelbrotPoints(row_counts, NULL, x, y, map->n_theta, N_ITERATIONS);
+        for(unsigned col = 0; col < map->n_theta; col++)
+        {
+            *(counts++) = (uint16_t)row_counts[col];
+        }
+    }
+
+    free(row_counts);
+    free(y);
+    free(x);
+    free(sin_theta);
+    free(cos_theta);
+
+    int64_t end = TimeCounterEnd();
+    return (end - start);
+}
+
+inline void BuildExpMapLookup(ExpMapLookup *lookup, const ExpMap *map)
+{
+    lookup->column   = (uint32_t *)calloc(VIDEO_WIDTH * VIDEO_HEIGHT, sizeof(uint32_t));
+    lookup->row_base = (float    *)calloc(VIDEO_WIDTH * VIDEO_HEIGHT, sizeof(float));
+
+    size_t pix_pos = 0;
+    for(unsigned y_pos = 0; y_pos < VIDEO_HEIGHT; y_pos++)
+    {
+        double y_off = 0.5 * VIDEO_HEIGHT - y_pos - 0.5;
+        for(unsigned x_pos = 0; x_pos < VIDEO_WIDTH; x_pos++, pix_pos++)
+        {
+            double x_off = x_pos + 0.5 - 0.5 * VIDEO_WIDTH;
+
+            double theta = atan2(y_off, x_off);
+            if(theta < 0) theta += 2 * M_PI;
+
+            lookup->column[pix_pos]   = (uint32_t)lrint(theta / map->ds) % map->n_theta;
+            lookup->row_base[pix_pos] = (float)(0.5 * log(x_off * x_off + y_off * y_off) / map->ds);
+        }
+    }
+}
+
+inline void ResampleFrame(unsigned *frame, const ExpMap *map, const ExpMapLookup *lookup, double delta)
+{
+    // Radius of a pixel is its offset from the frame centre in pixels times delta, so the zoom only shifts the rows.
+    float row_shift = (float)((log(delta) - map->s_min) / map->ds);
+    int   last_row  = (int)map->n_rows - 1;
+
+    for(size_t pix_pos = 0; pix_pos < VIDEO_WIDTH * VIDEO_HEIGHT; pix_pos++)
+    {
+        int row = (int)lrintf(lookup->row_base[pix_pos] + row_shift);
+        if(row < 0)        row = 0;
+        if(row > last_row) row = last_row;
+
+        frame[pix_pos] = map->counts[(size_t)row * map->n_theta + lookup->column[pix_pos]];
+    }
+}
+
+inline void RenderFrame(unsigned *frame, double delta)
+{
+    double x_rend = ZOOM_X - delta * (0.5 * VIDEO_WIDTH  - 0.5);
+    double y_rend = ZOOM_Y + delta * (0.5 * VIDEO_HEIGHT - 0.5);
+
+    RenderMandelbrotCounts(frame, VIDEO_WIDTH, VIDEO_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+}
+
+inline void BuildPalette(YUVPalette *palette)
+{
+    // Same color as the window renderers (n, n, n * 32 truncated to bytes), converted to full range BT.601.
+    for(unsigned n = 0; n <= N_ITERATIONS; n++)
+    {
+        double r = (uint8_t)n;
+        double g = (uint8_t)n;
+        double b = (uint8_t)(n * 32);
+
+        palette->y[n] = (uint8_t)lrint( 0.299    * r + 0.587    * g + 0.114    * b);
+        palette->u[n] = (uint8_t)lrint(-0.168736 * r - 0.331264 * g + 0.5      * b + 128);
+        palette->v[n] = (uint8_t)lrint( 0.5      * r - 0.418688 * g - 0.081312 * b + 128);
+    }
+}
+
+inline void WriteY4MHeader(FILE *stream)
+{
+    fprintf(stream, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", VIDEO_WIDTH, VIDEO_HEIGHT, VIDEO_FPS);
+}
+
+inline void WriteY4MFrame(FILE *stream, const unsigned *frame, const YUVPalette *palette, uint8_t *planes)
+{
+    uint8_t *y_plane = planes;
+    uint8_t *u_plane = y_plane + VIDEO_WIDTH * VIDEO_HEIGHT;
+    uint8_t *v_plane = u_plane + VIDEO_WIDTH * VIDEO_HEIGHT / 4;
+
+    for(size_t pix_pos = 0; pix_pos < VIDEO_WIDTH * VIDEO_HEIGHT; pix_pos++)
+    {
+        y_plane[pix_pos] = palette->y[frame[pix_pos]];
+    }
+
+    for(unsigned y_pos = 0; y_pos < VIDEO_HEIGHT; y_pos += 2)
+    {
+        for(unsigned x_pos = 0; x_pos < VIDEO_WIDTH; x_pos += 2)
+        {
+            const unsigned *quad = frame + y_pos * VIDEO_WIDTH + x_pos;
+
+            unsigned u = palette->u[quad[0]] + palette->u[quad[1]] + palette->u[quad[VIDEO_WIDTH]] + palette->u[quad[VIDEO_WIDTH + 1]];
+            unsigned v = palette->v[quad[0]] + palette->v[quad[1]] + palette->v[quad[VIDEO_WIDTH]] + palette->v[quad[VIDEO_WIDTH + 1]];
+
+            *(u_plane++) = (uint8_t)((u + 2) / 4);
+            *(v_plane++) = (uint8_t)((v + 2) / 4);
+        }
+    }
+
+    fputs("FRAME\n", stream);
+    fwrite(planes, sizeof(uint8_t), VIDEO_WIDTH * VIDEO_HEIGHT * 3 / 2, stream);
+}
+
+// Times the video made from the strip against rendering every frame, then compares a few frames spread over the zoom
+// with their direct render: the share of pixels whose count differs and the mean difference of their luma in the video.
+void TestZoom(double delta_first, double delta_last)
+{
+    const size_t N_PIXELS = VIDEO_WIDTH * VIDEO_HEIGHT;
+
+    unsigned *frame  = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *direct = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+
+    int64_t start = TimeCounterStart();
+
+    ExpMap map = {};
+    int64_t strip_time = RenderExpMap(&map, delta_first, delta_last);
+
+    ExpMapLookup lookup = {};
+    BuildExpMapLookup(&lookup, &map);
+
+    double delta = delta_first;
+    for(unsigned frame_n = 0; frame_n < N_FRAMES; frame_n++, delta /= ZOOM_PER_FRAME)
+    {
+        ResampleFrame(frame, &map, &lookup, delta);
+    }
+
+    int64_t exp_map_time = TimeCounterEnd() - start;
+
+    start = TimeCounterStart();
+
+    delta = delta_first;
+    for(unsigned frame_n = 0; frame_n < N_FRAMES; frame_n++, delta /= ZOOM_PER_FRAME)
+    {
+        RenderFrame(frame, delta);
+    }
+
+    int64_t direct_time = TimeCounterEnd() - start;
+
+    printf("exp map: %u x %u strip, %" PRId64 " ticks (strip %" PRId64 ")\n", map.n_theta, map.n_rows, exp_map_time, strip_time);
+    printf("direct:  %u frames,      %" PRId64 " ticks\n", N_FRAMES, direct_time);
+    printf("boost:   %lg\n", (double)direct_time / (double)exp_map_time);
+
+    YUVPalette palette = {};
+    BuildPalette(&palette);
+
+    for(unsigned i = 0; i < N_COMPARED_FRAMES; i++)
+    {
+        unsigned frame_n = i * (N_FRAMES - 1) / (N_COMPARED_FRAMES - 1);
+        delta = delta_first / pow(ZOOM_PER_FRAME, frame_n);
+
+        ResampleFrame(frame, &map, &lookup, delta);
+        RenderFrame(direct, delta);
+
+        size_t n_different = 0;
+        double luma_error  = 0;
+        for(size_t pix = 0; pix < N_PIXELS; pix++)
+        {
+            n_different += (frame[pix] != direct[pix]);
+            luma_error  += fabs((double)palette.y[frame[pix]] - (double)palette.y[direct[pix]]);
+        }
+
+        printf("frame %4u: %.1lf%% of counts differ from a direct render, mean luma difference %.2lf of 255\n",
+               frame_n, 100.0 * (double)n_different / N_PIXELS, luma_error / N_PIXELS);
+    }
+
+    free(lookup.row_base);
+    free(lookup.column);
+    free(map.counts);
+    free(direct);
+    free(frame);
+}
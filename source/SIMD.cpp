@@ -1,26 +1,69 @@
+#ifdef RENDER
 #include "SFML/Graphics.hpp"
 #include "SFML/Window.hpp"
 #include "SFML/System.hpp"
+#endif
 
-#include <immintrin.h>
 #include <inttypes.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "Batch.h"
+#include "Energy.h"
+#include "Equalize.h"
+#include "IntervalTiles.h"
+#include "Mandelbrot.h"
+#include "PerfCounters.h"
+#include "Prefetch.h"
+#include "Telemetry.h"
+#include "TileCodec.h"
 
 const unsigned SCREEN_WIDTH  = 1920;
 const unsigned SCREEN_HEIGHT = 1080;
 
 const unsigned PIXELS_PER_OFFSET = 20;
-const float MAX_ZERO_OFFSET      = 2;
 
-inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render);
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels);
+const unsigned N_ITERATIONS = 255;
+
+const unsigned PROFILE_TILE_WIDTH  = 64;
+const unsigned PROFILE_TILE_HEIGHT = 36;
+const unsigned PROFILE_N_TILES_X   = SCREEN_WIDTH  / PROFILE_TILE_WIDTH;
+const unsigned PROFILE_N_TILES_Y   = SCREEN_HEIGHT / PROFILE_TILE_HEIGHT;
+
+#ifdef RENDER
+inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, unsigned &width, unsigned &height,
+                         bool &to_render, bool &antialiasing, bool &smooth, bool &show_stats, Fractal &fractal, ViewMove &move);
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels, unsigned width, unsigned height);
+#endif
+
+void TestSIMD(uint8_t *pixels, float x_rend, float y_rend, float delta);
+void TestAntiAliasing(uint8_t *pixels, float x_rend, float y_rend, float delta);
+void TestSmoothColoring(uint8_t *pixels, float x_rend, float y_rend, float delta);
+bool TestDistanceEstimator(float x_rend, float y_rend, float delta);
+void TestEqualization(uint8_t *pixels, float x_rend, float y_rend, float delta);
+bool TestBatch(void);
+bool TestPoints(float x_rend, float y_rend, float delta);
+bool TestIntervalTiles(float x_rend, float y_rend, float delta);
+bool TestPrefetch(const char *trace_path, float x_rend, float y_rend, float delta);
+bool ReplayTrace(const char *name, const double *think_ms, const ViewMove *moves, size_t n_events, float x_rend, float y_rend, float delta);
+size_t ReadTrace(const char *path, double *think_ms, ViewMove *moves, size_t max_events);
+void SyntheticTrace(double *think_ms, ViewMove *moves, size_t n_events, bool held_key);
+bool TestTileRender(const char *program);
+void TestEnergy(float x_rend, float y_rend, float delta);
+void PrintEnergy(const EnergyCounters *energy, const char *kernel, unsigned n_threads, size_t n_frames, double elapsed_ms);
+bool TestSymmetry(float x_rend, float y_rend, float delta);
+bool TestResolution(float x_rend, float y_rend, float delta);
+void TestFractals(void);
+bool TestTileCodec(float x_rend, float y_rend, float delta);
 
-inline int64_t TimeCounter(void);
-void TestSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
+void ProfileSIMD(float x_rend, float y_rend, float delta);
+inline void HeatColor(uint8_t *rgb, double t);
+inline void WritePPM(const char *path, const uint8_t *rgb, unsigned width, unsigned height);
 
-int main(void)
+int main(int argc, const char *argv[])
 {
 // ================================================================================================================================================================================
     float ratio       = (float)SCREEN_HEIGHT / (float)SCREEN_WIDTH;
@@ -30,59 +73,201 @@ int main(void)
     float x_rend = -MAX_ZERO_OFFSET;
     float y_rend = MAX_ZERO_OFFSET * ratio;
 // ================================================================================================================================================================================
-    sf::Uint8 *pixels = (sf::Uint8 *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(sf::Uint8));
-    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(sf::Uint8)));
+    uint8_t *pixels = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(uint8_t));
+    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(uint8_t)));
+
+    bool passed = true;
 // ================================================================================================================================================================================
-#ifndef RENDER
+#if defined(PROFILE)
+    ProfileSIMD(x_rend, y_rend, delta);
+#elif !defined(RENDER)
+    // --trace FILE replays a recording of the viewer in TestPrefetch. --energy runs TestEnergy, which takes 2 s per
+    // kernel and thread count.
+    const char *trace_path = NULL;
+    bool        energy     = false;
+    for(int arg = 1; arg < argc; arg++)
+    {
+        if(strcmp(argv[arg], "--trace") == 0 && arg + 1 < argc) trace_path = argv[++arg];
+        else if(strcmp(argv[arg], "--energy") == 0) energy = true;
+    }
+
     TestSIMD(pixels, x_rend, y_rend, delta);
+    TestAntiAliasing(pixels, x_rend, y_rend, delta);
+    TestSmoothColoring(pixels, x_rend, y_rend, delta);
+    passed &= TestDistanceEstimator(x_rend, y_rend, delta);
+    TestEqualization(pixels, x_rend, y_rend, delta);
+    passed &= TestBatch();
+    passed &= TestPoints(x_rend, y_rend, delta);
+    passed &= TestIntervalTiles(x_rend, y_rend, delta);
+    passed &= TestPrefetch(trace_path, x_rend, y_rend, delta);
+    passed &= TestTileRender(argv[0]);
+    if(energy) TestEnergy(x_rend, y_rend, delta);
+    passed &= TestSymmetry(x_rend, y_rend, delta);
+    passed &= TestResolution(x_rend, y_rend, delta);
+    TestFractals();
+    passed &= TestTileCodec(x_rend, y_rend, delta);
 #else
-    bool to_render = true;
+    bool to_render    = true;
+    bool antialiasing = false;
+    bool smooth       = false;
+
+    Fractal fractal = {FRACTAL_MANDELBROT, 0, 0};
+
+    // T shows the statistics of every frame in the window title, --csv FILE also writes them to a file. --trace FILE
+    // records every move with the milliseconds since the last frame was shown, for TestPrefetch to replay.
+    bool  show_stats = false;
+    FILE *csv        = NULL;
+    FILE *trace      = NULL;
+    for(int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        if(strcmp(argv[arg], "--csv") == 0)
+        {
+            csv = OpenTelemetryCSV(argv[arg + 1]);
+            if(!csv) return EXIT_FAILURE;
+        }
+        else if(strcmp(argv[arg], "--trace") == 0)
+        {
+            trace = fopen(argv[arg + 1], "w");
+            if(!trace)
+            {
+                perror(argv[arg + 1]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    size_t n_frames  = 0;
+    double launch_ms = FrameClockMs();
+    bool   had_stats = false;
+
+    char title[TELEMETRY_TITLE_SIZE] = "";
 
-    sf::RenderWindow window(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), "");
+    // While the viewer waits for a key, the views the keys lead to are rendered in the background.
+    Prefetcher prefetcher = {};
+    PrefetchInit(&prefetcher, N_ITERATIONS, PIXELS_PER_OFFSET);
+    double shown_ms = FrameClockMs();
+
+    unsigned width  = SCREEN_WIDTH;
+    unsigned height = SCREEN_HEIGHT;
+
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    unsigned *edges  = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    float    *r2     = (float    *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(float));
+
+    sf::RenderWindow window(sf::VideoMode(SCREEN_WIDTH, SCREEN_HEIGHT), FractalName(fractal.type));
     do {
+        unsigned old_width  = width;
+        unsigned old_height = height;
+
+        // With nothing to render the viewer sleeps until the next event instead of spinning, and leaves the core to the
+        // prefetcher.
         sf::Event event;
-        while(window.pollEvent(event))
+        bool has_event = to_render ? window.pollEvent(event) : window.waitEvent(event);
+        while(has_event)
+        {
+            ViewMove move = PREFETCH_N_MOVES;
+            ProcessEvent(window, event, x_rend, y_rend, delta, width, height, to_render, antialiasing, smooth, show_stats, fractal, move);
+            if(trace && move != PREFETCH_N_MOVES) fprintf(trace, "%.1f %s\n", FrameClockMs() - shown_ms, MoveName(move));
+
+            has_event = window.pollEvent(event);
+        }
+
+        if(width != old_width || height != old_height)
         {
-            ProcessEvent(window, event, x_rend, y_rend, delta, to_render);
+            size_t n_pixels = (size_t)width * height;
+
+            pixels = (uint8_t  *)realloc(pixels, n_pixels * 4 * sizeof(uint8_t));
+            counts = (unsigned *)realloc(counts, n_pixels * sizeof(unsigned));
+            edges  = (unsigned *)realloc(edges,  n_pixels * sizeof(unsigned));
+            r2     = (float    *)realloc(r2,     n_pixels * sizeof(float));
+        }
+
+        if(!to_render || width == 0 || height == 0) continue;
+        PrefetchStop(&prefetcher);
+
+        // Anti-aliasing and smooth coloring are only implemented for the Mandelbrot set. The statistics need the number
+        // of iterations, so with them the plain kernel keeps its counts and coloring is a separate pass.
+        bool keep_counts = show_stats || csv;
+        double start_ms  = FrameClockMs();
+
+        const char  *mode      = "";
+        PrefetchView view      = {x_rend, y_rend, delta, width, height};
+        bool         speculate = fractal.type == FRACTAL_MANDELBROT && !antialiasing && !smooth;
+        if(speculate)
+        {
+            if(PrefetchTake(&prefetcher, &view, counts)) mode = " prefetched";
+            else RenderMandelbrotCounts(counts, width, height, x_rend, y_rend, delta, N_ITERATIONS, true);
+
+            ColorMandelbrot(pixels, counts, (size_t)width * height);
+        }
+        else if(fractal.type != FRACTAL_MANDELBROT)
+        {
+            if(keep_counts)
+            {
+                RenderFractalCounts(counts, width, height, x_rend, y_rend, delta, N_ITERATIONS, fractal, true);
+                ColorMandelbrot(pixels, counts, (size_t)width * height);
+            }
+            else RenderFractal(pixels, width, height, x_rend, y_rend, delta, N_ITERATIONS, fractal);
+        }
+        else if(antialiasing)
+        {
+            RenderMandelbrotAA(pixels, counts, edges, width, height, x_rend, y_rend, delta, N_ITERATIONS);
+            mode = " anti-aliased";
+        }
+        else
+        {
+            RenderMandelbrotSmooth(pixels, counts, r2, width, height, x_rend, y_rend, delta, N_ITERATIONS, true);
+            mode = " smooth";
         }
 
-        if(!to_render) continue;
+        double present_ms = FrameClockMs();
+        double render_ms  = present_ms - start_ms;
+        DrawMandelbrot(window, pixels, width, height);
+        shown_ms   = FrameClockMs();
+        present_ms = shown_ms - present_ms;
+
+        if(speculate) PrefetchStart(&prefetcher, &view);
 
-        RenderMandelbrot(pixels, x_rend, y_rend, delta);
-        DrawMandelbrot(window, pixels);
+        // Counts of an anti-aliased frame are those of the first pass, without the extra samples of the edges.
+        if(keep_counts)
+        {
+            FrameStats stats = {"", width, height, N_ITERATIONS, x_rend, y_rend, delta, render_ms, present_ms,
+                                SumCounts(counts, (size_t)width * height)};
+            snprintf(stats.kernel, sizeof(stats.kernel), "%s [8 x float]%s", FractalName(fractal.type), mode);
+
+            if(csv) WriteTelemetryCSV(csv, n_frames, start_ms - launch_ms, &stats);
+            if(show_stats)
+            {
+                FormatTelemetry(title, sizeof(title), &stats);
+                window.setTitle(title);
+            }
+        }
+        if(had_stats && !show_stats) window.setTitle(FractalName(fractal.type));
+        had_stats = show_stats;
+        n_frames++;
 
         to_render = false;
 
     } while(window.isOpen());
+
+    PrefetchFree(&prefetcher);
+
+    if(trace) fclose(trace);
+    if(csv) fclose(csv);
+    free(r2);
+    free(edges);
+    free(counts);
 #endif
 // ================================================================================================================================================================================
     free(pixels);
 
-    return EXIT_SUCCESS;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
 // ================================================================================================================================================================================
 }
 
-inline int64_t TimeCounter(void)
-{
-    int64_t result = 0;
-
-    asm volatile
-    (
-        ".intel_syntax noprefix\n\t"
-        "rdtsc\n\t"
-        "shl rdx, 32\n\t"
-        "add rax, rdx\n\t"
-        "mov %0, rax\n\t"
-        ".att_syntax prefix\n\t"
-        : "=r"(result)
-        :
-        : "%rdx", "%rax"
-    );
-
-    return result;
-}
-
-inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render)
+#ifdef RENDER
+inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, unsigned &width, unsigned &height,
+                         bool &to_render, bool &antialiasing, bool &smooth, bool &show_stats, Fractal &fractal, ViewMove &move)
 {
     switch(event.type)
     {
@@ -94,6 +279,10 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_re
         case sf::Event::Resized:
         {
             to_render = true;
+
+            width  = event.size.width;
+            height = event.size.height;
+
             window.setView(sf::View(sf::FloatRect(0, 0, event.size.width, event.size.height)));
             return;
         }
@@ -104,152 +293,1345 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_re
             {
                 case sf::Keyboard::Left:
                 {
-                    x_rend -= PIXELS_PER_OFFSET * delta;
-                    return;
+                    move = MOVE_LEFT;
+                    break;
                 }
                 case sf::Keyboard::Right:
                 {
-                    x_rend += PIXELS_PER_OFFSET * delta;
-                    return;
+                    move = MOVE_RIGHT;
+                    break;
                 }
                 case sf::Keyboard::Up:
                 {
-                    y_rend += PIXELS_PER_OFFSET * delta;
-                    return;
+                    move = MOVE_UP;
+                    break;
                 }
                 case sf::Keyboard::Down:
                 {
-                    y_rend -= PIXELS_PER_OFFSET * delta;
-                    return;
+                    move = MOVE_DOWN;
+                    break;
                 }
                 case sf::Keyboard::Dash:
                 {
-                    x_rend -= delta * (SCREEN_WIDTH  / 2);
-                    y_rend += delta * (SCREEN_HEIGHT / 2);
-
-                    delta *= 2;
-
-                    return;
+                    move = MOVE_ZOOM_OUT;
+                    break;
                 }
                 case sf::Keyboard::Equal:
                 {
-                    delta /= 2;
-
-                    x_rend += delta * (SCREEN_WIDTH  / 2);
-                    y_rend -= delta * (SCREEN_HEIGHT / 2);
-
+                    move = MOVE_ZOOM_IN;
+                    break;
+                }
+                case sf::Keyboard::A:
+                {
+                    antialiasing = !antialiasing;
+                    return;
+                }
+                case sf::Keyboard::S:
+                {
+                    smooth = !smooth;
+                    return;
+                }
+                case sf::Keyboard::T:
+                {
+                    show_stats = !show_stats;
+                    return;
+                }
+                case sf::Keyboard::F:
+                {
+                    fractal.type = (FractalType)((fractal.type + 1) % N_FRACTALS);
+                    window.setTitle(FractalName(fractal.type));
+                    return;
+                }
+                case sf::Keyboard::J:
+                {
+                    // Julia set of the point in the center of the view.
+                    fractal.type = FRACTAL_JULIA;
+                    fractal.c_x  = x_rend + delta * (width  / 2);
+                    fractal.c_y  = y_rend - delta * (height / 2);
+                    window.setTitle(FractalName(fractal.type));
                     return;
                 }
             }
+
+            // The arrows and zoom keys end up here, the prefetcher predicts their views with the same MoveView.
+            MoveView(&x_rend, &y_rend, &delta, width, height, move, PIXELS_PER_OFFSET);
+            return;
         }
     }
 }
 
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels, unsigned width, unsigned height)
 {
-#ifndef RENDER
-    int64_t start = TimeCounter();
+    static sf::Sprite sprite;
+    static sf::Texture texture;
+
+    texture.create(width, height);
+    texture.update(pixels);
+
+    sprite.setTexture(texture);
+
+    window.clear(sf::Color::Black);
+    window.draw(sprite);
+    window.display();
+}
 #endif
 
-    static const unsigned N_ITERATIONS = 255;
+void TestSIMD(uint8_t *pixels, float x_rend, float y_rend, float delta)
+{
+    const size_t N_TESTS = 100;
+    int64_t results[N_TESTS] = {};
+
+    double result_time = 0;
+    double error       = 0;
+
+    PrintTSCCalibration();
+
+    PerfCounters counters = {};
+    PerfCountersOpen(&counters);
+
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        PerfCountersStart(&counters);
+        int64_t start = TimeCounterStart();
+        RenderMandelbrot(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS);
+        int64_t delta_time = TimeCounterEnd() - start;
+        PerfCountersStop(&counters);
+
+        results[i]   = delta_time;
+        result_time += (double)delta_time;
+    }
+    result_time /= (double)N_TESTS;
+
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t abs_err = results[i] - result_time;
+        error += (double)abs_err * (double)abs_err;
+    }
+    error = sqrt(error / (double)N_TESTS);
+    double exp = pow(10, (int)log10(error));
+
+    error       = round(error       / exp) * exp;
+    result_time = round(result_time / exp) * exp;
+    printf("%lg ± %lg\n", result_time, error);
+
+    PrintPerfCounters(&counters);
+    PerfCountersClose(&counters);
+}
+
+void TestAntiAliasing(uint8_t *pixels, float x_rend, float y_rend, float delta)
+{
+    const size_t N_TESTS = 10;
+
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    unsigned *edges  = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+
+    double plain_time = 0;
+    double aa_time    = 0;
+
+    size_t n_edges = 0;
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t start = TimeCounterStart();
+        RenderMandelbrot(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS);
+        int64_t middle = TimeCounterEnd();
+        n_edges = RenderMandelbrotAA(pixels, counts, edges, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS);
+        int64_t end = TimeCounterEnd();
+
+        plain_time += (double)(middle - start);
+        aa_time    += (double)(end - middle);
+    }
+
+    double edge_share = (double)n_edges / (SCREEN_WIDTH * SCREEN_HEIGHT);
+    printf("anti-aliasing: %.1lf%% of pixels supersampled x%u, %.2lf samples per pixel, cost x%.2lf of 1-sample render\n",
+           100 * edge_share, AA_SAMPLES, 1 + edge_share * AA_SAMPLES, aa_time / plain_time);
+
+    free(edges);
+    free(counts);
+}
+
+void TestSmoothColoring(uint8_t *pixels, float x_rend, float y_rend, float delta)
+{
+    const size_t N_TESTS = 10;
+
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    float    *r2     = (float    *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(float));
+
+    double render_time = 0;
+    double plain_time  = 0;
+    double smooth_time = 0;
+
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t render_start = TimeCounterStart();
+        RenderMandelbrotSmooth(pixels, counts, r2, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+        int64_t start = TimeCounterEnd();
+        ColorMandelbrot(pixels, counts, SCREEN_WIDTH * SCREEN_HEIGHT);
+        int64_t middle = TimeCounterEnd();
+        ColorMandelbrotSmooth(pixels, counts, r2, SCREEN_WIDTH * SCREEN_HEIGHT, N_ITERATIONS);
+        int64_t end = TimeCounterEnd();
+
+        render_time += (double)(start  - render_start);
+        plain_time  += (double)(middle - start);
+        smooth_time += (double)(end - middle);
+    }
+
+    printf("smooth coloring: render %lg ticks, plain color pass %lg ticks, smooth color pass %lg ticks (x%.2lf)\n",
+           render_time / N_TESTS, plain_time / N_TESTS, smooth_time / N_TESTS, smooth_time / plain_time);
 
-    static const __v8sf MAX_ZERO_OFFSET2_V = _mm256_set1_ps(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
-    static const __v8sf SHIFT_V            = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+    // A jump of mu on a band edge of n shows as a step between the two pixels on either side of it larger than the steps
+    // just before and after it, which follow the gradient of mu there. Only edges between counts one apart are taken,
+    // with both neighbouring steps inside a band.
+    auto mu = [&](size_t pix) { return counts[pix] + 1 - log2(0.5 * log2(r2[pix])); };
+
+    double excess  = 0;
+    double step    = 0;
+    size_t n_edges = 0;
+    for(size_t pix = 1; pix + 2 < SCREEN_WIDTH * SCREEN_HEIGHT; pix++)
+    {
+        if(pix % SCREEN_WIDTH == 0 || (pix + 2) % SCREEN_WIDTH < 2 || counts[pix + 1] >= N_ITERATIONS || counts[pix] >= N_ITERATIONS) continue;
+        if(counts[pix] + 1 != counts[pix + 1] || counts[pix - 1] != counts[pix] || counts[pix + 2] != counts[pix + 1]) continue;
+
+        double around = 0.5 * (fabs(mu(pix) - mu(pix - 1)) + fabs(mu(pix + 2) - mu(pix + 1)));
+        excess += fabs(mu(pix + 1) - mu(pix)) - around;
+        step   += around;
+        n_edges++;
+    }
+    printf("smooth coloring: mu jumps by %.4lf on band edges beyond its local step of %.4lf (%zu edges)\n",
+           excess / n_edges, step / n_edges, n_edges);
+
+    free(r2);
+    free(counts);
+}
+
+// Cost of carrying dz/dc in the loop: ticks per escape count iteration of the plain and the distance kernel, both
+// [8 x float] and [4 x double], on the starting view and on seahorse valley, where most pixels are near the boundary.
+// The distance kernel also runs a few iterations past the escape of each lane, these are part of its time. Counts
+// have to be the same, otherwise the test fails, and pixels within one pixel of the boundary by the estimate are
+// compared with FindEdges.
+bool TestDistanceEstimator(float x_rend, float y_rend, float delta)
+{
+    const size_t   N_TESTS  = 10;
+    const unsigned N_VIEWS  = 2;
+    const size_t   N_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
 
-    __v8sf delta_v         = _mm256_set1_ps(delta);
-    __v8sf delta_v_shifted = SHIFT_V * delta_v;
-    __v8sf packed_adj_v    = 8 * delta_v;
+    const char *const NAMES[N_VIEWS]  = {"starting view", "seahorse valley"};
+    const double VIEWS[N_VIEWS][3]    = {{x_rend, y_rend, delta}, {-0.745 - 0.025, 0.113 + 0.025 * SCREEN_HEIGHT / SCREEN_WIDTH, 0.05 / SCREEN_WIDTH}};
 
-    size_t pix_arr_pos = 0;
+    unsigned *counts       = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *plain_counts = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *edges        = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    float    *distance     = (float    *)calloc(N_PIXELS, sizeof(float));
 
-    __v8sf y_0 = _mm256_set1_ps(y_rend);
-    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos += 1, y_0 -= delta_v)
+    bool passed = true;
+    for(unsigned view = 0; view < N_VIEWS; view++)
     {
-        __v8sf x_0 = delta_v_shifted + x_rend;
-        for(unsigned x_pos = 0; x_pos < SCREEN_WIDTH; x_pos += 8, x_0 += packed_adj_v)
+        for(unsigned precision = 0; precision < 2; precision++)
         {
-            __v8sf x_n = {};
-            __v8sf y_n = {};
+            bool high = (precision == 1);
 
-            __v8si n = {};
-            for(volatile unsigned i = 0; i < N_ITERATIONS; i++)
+            double plain_time    = 0;
+            double distance_time = 0;
+            for(size_t i = 0; i < N_TESTS; i++)
             {
-                __v8sf x2 = x_n * x_n;
-                __v8sf y2 = y_n * y_n;
-                __v8sf xy = x_n * y_n;
+                int64_t start = TimeCounterStart();
+                if(high) RenderMandelbrotCounts(plain_counts, SCREEN_WIDTH, SCREEN_HEIGHT, VIEWS[view][0], VIEWS[view][1], VIEWS[view][2], N_ITERATIONS, true);
+                else RenderMandelbrotCounts(plain_counts, SCREEN_WIDTH, SCREEN_HEIGHT, (float)VIEWS[view][0], (float)VIEWS[view][1], (float)VIEWS[view][2],
+                                            N_ITERATIONS, true);
+                int64_t middle = TimeCounterEnd();
+                if(high) RenderMandelbrotDistance(NULL, counts, distance, SCREEN_WIDTH, SCREEN_HEIGHT, VIEWS[view][0], VIEWS[view][1], VIEWS[view][2],
+                                                  N_ITERATIONS, true);
+                else RenderMandelbrotDistance(NULL, counts, distance, SCREEN_WIDTH, SCREEN_HEIGHT, (float)VIEWS[view][0], (float)VIEWS[view][1],
+                                              (float)VIEWS[view][2], N_ITERATIONS, true);
+                int64_t end = TimeCounterEnd();
 
-                __v8sf cmp = ((x2 + y2) < MAX_ZERO_OFFSET2_V);
+                plain_time    += (double)(middle - start);
+                distance_time += (double)(end - middle);
+            }
+
+            double n_iterations = (double)SumCounts(counts, N_PIXELS);
+            bool   identical    = (memcmp(counts, plain_counts, N_PIXELS * sizeof(unsigned)) == 0);
+
+            size_t n_edges    = FindEdges(counts, edges, SCREEN_WIDTH, SCREEN_HEIGHT);
+            size_t n_boundary = 0;
+            for(size_t pix = 0; pix < N_PIXELS; pix++)
+            {
+                if(counts[pix] < N_ITERATIONS && distance[pix] < 1) n_boundary++;
+            }
+
+            printf("distance estimator, %s, %s: %.3lf ticks per iteration, plain %.3lf (x%.2lf), counts %s; %zu pixels within a pixel of the "
+                   "boundary, %zu edge pixels by counts\n", NAMES[view], high ? "[4 x double]" : "[8 x float]", distance_time / N_TESTS / n_iterations,
+                   plain_time / N_TESTS / n_iterations, distance_time / plain_time, identical ? "identical" : "DIFFER, FAILED", n_boundary, n_edges);
+            passed &= identical;
+        }
+    }
+
+    free(distance);
+    free(edges);
+    free(plain_counts);
+    free(counts);
+
+    return passed;
+}
+
+// Cost of the histogram-equalized coloring against the render of the same counts, on one thread and on one per CPU,
+// and the spread (standard deviation) of the brightness of escaped pixels against the plain coloring: low when most of
+// the picture has nearly the same color. The spiral is a deep view with 2000 iterations, where almost all counts are in
+// a narrow band.
+void TestEqualization(uint8_t *pixels, float x_rend, float y_rend, float delta)
+{
+    const size_t   N_TESTS  = 10;
+    const unsigned N_VIEWS  = 3;
+    const size_t   N_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    const char *const NAMES[N_VIEWS]     = {"starting view", "seahorse valley", "spiral"};
+    const double      VIEWS[N_VIEWS][3]  = {{x_rend, y_rend, delta},
+                                            {-0.745 - 0.025, 0.113 + 0.025 * SCREEN_HEIGHT / SCREEN_WIDTH, 0.05 / SCREEN_WIDTH},
+                                            {-0.7436439 - 5e-5, 0.1318259 + 5e-5 * SCREEN_HEIGHT / SCREEN_WIDTH, 1e-4 / SCREEN_WIDTH}};
+    const unsigned    ITERATIONS[N_VIEWS] = {N_ITERATIONS, N_ITERATIONS, 2000};
+
+    long     n_cpus    = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned n_threads = (unsigned)((n_cpus > 0) ? n_cpus : 1);
+
+    unsigned *counts = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
 
-                unsigned mask = _mm256_movemask_ps(cmp);
-                if(mask == 0) break;
+    for(unsigned view = 0; view < N_VIEWS; view++)
+    {
+        double render_time    = 0;
+        double plain_time     = 0;
+        double equalized_time = 0;
+        double threaded_time  = 0;
+        for(size_t i = 0; i < N_TESTS; i++)
+        {
+            int64_t start = TimeCounterStart();
+            RenderMandelbrotCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, VIEWS[view][0], VIEWS[view][1], VIEWS[view][2], ITERATIONS[view], true);
+            int64_t rendered = TimeCounterEnd();
+            ColorMandelbrot(pixels, counts, N_PIXELS);
+            int64_t plain = TimeCounterEnd();
+            ColorMandelbrotEqualized(pixels, counts, N_PIXELS, ITERATIONS[view], 1);
+            int64_t equalized = TimeCounterEnd();
+            ColorMandelbrotEqualized(pixels, counts, N_PIXELS, ITERATIONS[view], n_threads);
+            int64_t end = TimeCounterEnd();
+
+            render_time    += (double)(rendered  - start);
+            plain_time     += (double)(plain     - rendered);
+            equalized_time += (double)(equalized - plain);
+            threaded_time  += (double)(end       - equalized);
+        }
 
-                n -= reinterpret_cast<__v8si>(cmp);
+        double spread[2] = {};
+        for(unsigned coloring = 0; coloring < 2; coloring++)
+        {
+            if(coloring == 0) ColorMandelbrot(pixels, counts, N_PIXELS);
+            else ColorMandelbrotEqualized(pixels, counts, N_PIXELS, ITERATIONS[view], n_threads);
+
+            double n_escaped = 0, sum = 0, sum2 = 0;
+            for(size_t pix = 0; pix < N_PIXELS; pix++)
+            {
+                if(counts[pix] >= ITERATIONS[view]) continue;
 
-                x_n = x2 - y2 + x_0;
-                y_n = xy + xy + y_0;
+                double brightness = (pixels[4 * pix] + pixels[4 * pix + 1] + pixels[4 * pix + 2]) / 3.0;
+                n_escaped += 1;
+                sum       += brightness;
+                sum2      += brightness * brightness;
             }
+            spread[coloring] = sqrt(sum2 / n_escaped - (sum / n_escaped) * (sum / n_escaped));
+        }
 
-#ifdef RENDER
-            unsigned *n_p = (unsigned *)&n;
-            for(unsigned i = 0; i < 8; i++, pix_arr_pos += 4)
+        printf("equalized coloring, %s: render %.0lf ticks, plain coloring %.0lf, equalized %.0lf (%.1lf%% of the render), "
+               "%u threads %.0lf (%.1lf%%); brightness spread %.1lf, plain %.1lf\n", NAMES[view], render_time / N_TESTS, plain_time / N_TESTS,
+               equalized_time / N_TESTS, 100 * equalized_time / render_time, n_threads, threaded_time / N_TESTS, 100 * threaded_time / render_time,
+               spread[1], spread[0]);
+    }
+
+    free(counts);
+}
+
+// Thumbnails of BATCH_TEST_VIEWS random views around the boundary of the set, 100 x 60 so that rows do not end on a
+// vector: one batch call on 1 and on all threads, the same views one RenderMandelbrotCounts call each, and one frame of
+// the same number of pixels. Ticks are divided by the iterations done, which differ between the thumbnails and the frame.
+// Batch counts have to equal those of one call per view, otherwise the test fails.
+bool TestBatch(void)
+{
+    const size_t   N_TESTS          = 5;
+    const unsigned BATCH_TEST_VIEWS = 1024;
+    const unsigned THUMBNAIL_WIDTH  = 100;
+    const unsigned THUMBNAIL_HEIGHT = 60;
+    const size_t   THUMBNAIL_PIXELS = THUMBNAIL_WIDTH * THUMBNAIL_HEIGHT;
+    const unsigned N_CENTERS        = 4;
+    const float    CENTERS[N_CENTERS][2] = {{-0.745f, 0.113f}, {-0.16f, 1.04f}, {0.28f, 0.01f}, {-1.25f, 0.02f}};
+
+    long     n_cpus    = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned n_threads = (unsigned)((n_cpus > 0) ? n_cpus : 1);
+
+    Viewport *views      = (Viewport *)calloc(BATCH_TEST_VIEWS, sizeof(Viewport));
+    unsigned *counts     = (unsigned *)calloc(BATCH_TEST_VIEWS * THUMBNAIL_PIXELS, sizeof(unsigned));
+    unsigned *single     = (unsigned *)calloc(BATCH_TEST_VIEWS * THUMBNAIL_PIXELS, sizeof(unsigned));
+    uint8_t  *thumbnails = (uint8_t  *)calloc(BATCH_TEST_VIEWS * THUMBNAIL_PIXELS, 4 * sizeof(uint8_t));
+
+    srand(1);
+    for(unsigned view = 0; view < BATCH_TEST_VIEWS; view++)
+    {
+        const float *center = CENTERS[view % N_CENTERS];
+        float        width  = 0.5f * powf(0.5f, (float)(rand() % 12));
+
+        views[view].delta  = width / THUMBNAIL_WIDTH;
+        views[view].x_rend = center[0] + width * ((float)rand() / RAND_MAX - 1.0f);
+        views[view].y_rend = center[1] + width * ((float)rand() / RAND_MAX);
+        views[view].width  = THUMBNAIL_WIDTH;
+        views[view].height = THUMBNAIL_HEIGHT;
+        views[view].counts = counts + view * THUMBNAIL_PIXELS;
+        views[view].pixels = thumbnails + 4 * view * THUMBNAIL_PIXELS;
+    }
+
+    // The frame: as wide as the screen, as many pixels as all thumbnails together.
+    unsigned frame_height = (unsigned)(BATCH_TEST_VIEWS * THUMBNAIL_PIXELS / SCREEN_WIDTH);
+    unsigned *frame       = (unsigned *)calloc((size_t)SCREEN_WIDTH * frame_height, sizeof(unsigned));
+    float     frame_delta = 2 * MAX_ZERO_OFFSET / SCREEN_WIDTH;
+
+    double batch_time    = 0;
+    double threaded_time = 0;
+    double single_time   = 0;
+    double frame_time    = 0;
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t start = TimeCounterStart();
+        RenderMandelbrotBatch(views, BATCH_TEST_VIEWS, N_ITERATIONS, 1);
+        int64_t batched = TimeCounterEnd();
+        RenderMandelbrotBatch(views, BATCH_TEST_VIEWS, N_ITERATIONS, n_threads);
+        int64_t threaded = TimeCounterEnd();
+        for(unsigned view = 0; view < BATCH_TEST_VIEWS; view++)
+        {
+            RenderMandelbrotCounts(single + view * THUMBNAIL_PIXELS, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT, views[view].x_rend, views[view].y_rend,
+                                   views[view].delta, N_ITERATIONS, false);
+            ColorMandelbrot(views[view].pixels, single + view * THUMBNAIL_PIXELS, THUMBNAIL_PIXELS);
+        }
+        int64_t singled = TimeCounterEnd();
+        RenderMandelbrotCounts(frame, SCREEN_WIDTH, frame_height, -MAX_ZERO_OFFSET, frame_delta * frame_height / 2, frame_delta, N_ITERATIONS, false);
+        int64_t end = TimeCounterEnd();
+
+        batch_time    += (double)(batched  - start);
+        threaded_time += (double)(threaded - batched);
+        single_time   += (double)(singled  - threaded);
+        frame_time    += (double)(end      - singled);
+    }
+
+    double thumbnail_iterations = SumCounts(counts, BATCH_TEST_VIEWS * THUMBNAIL_PIXELS);
+    double frame_iterations     = SumCounts(frame, (size_t)SCREEN_WIDTH * frame_height);
+
+    size_t n_different = 0;
+    for(size_t pix = 0; pix < BATCH_TEST_VIEWS * THUMBNAIL_PIXELS; pix++) n_different += (counts[pix] != single[pix]);
+
+    printf("batch of %u thumbnails %ux%u: %.3lf ticks per iteration, %u threads %.3lf, one call per view %.3lf, one %ux%u frame %.3lf; "
+           "%zu counts differ from one call per view%s\n", BATCH_TEST_VIEWS, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT,
+           batch_time / N_TESTS / thumbnail_iterations, n_threads, threaded_time / N_TESTS / thumbnail_iterations,
+           single_time / N_TESTS / thumbnail_iterations, SCREEN_WIDTH, frame_height, frame_time / N_TESTS / frame_iterations,
+           n_different, (n_different == 0) ? "" : ", FAILED");
+
+    free(frame);
+    free(thumbnails);
+    free(single);
+    free(counts);
+    free(views);
+
+    return n_different == 0;
+}
+
+// The starting view as a list of points, against the grid kernels on the same pixels. The points come from
+// GridCoordinates, so the counts of the float, the |z|^2 and the double loops have to equal those of the grid, otherwise
+// the test fails; then the same points in a random order, where neighbouring lanes no longer escape together.
+bool TestPoints(float x_rend, float y_rend, float delta)
+{
+    const size_t N_TESTS  = 10;
+    const size_t N_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    unsigned *counts      = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *grid_counts = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *grid_double = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    float    *r2          = (float    *)calloc(N_PIXELS, sizeof(float));
+    float    *x           = (float    *)calloc(N_PIXELS, sizeof(float));
+    float    *y           = (float    *)calloc(N_PIXELS, sizeof(float));
+    double   *x_double    = (double   *)calloc(N_PIXELS, sizeof(double));
+    double   *y_double    = (double   *)calloc(N_PIXELS, sizeof(double));
+
+    float  *x_row        = (float  *)calloc(SCREEN_WIDTH,  sizeof(float));
+    float  *y_col        = (float  *)calloc(SCREEN_HEIGHT, sizeof(float));
+    double *x_row_double = (double *)calloc(SCREEN_WIDTH,  sizeof(double));
+    double *y_col_double = (double *)calloc(SCREEN_HEIGHT, sizeof(double));
+
+    GridCoordinates(x_row, y_col, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta);
+    GridCoordinates(x_row_double, y_col_double, SCREEN_WIDTH, SCREEN_HEIGHT, (double)x_rend, (double)y_rend, (double)delta);
+    for(size_t pix = 0; pix < N_PIXELS; pix++)
+    {
+        x[pix]        = x_row[pix % SCREEN_WIDTH];
+        y[pix]        = y_col[pix / SCREEN_WIDTH];
+        x_double[pix] = x_row_double[pix % SCREEN_WIDTH];
+        y_double[pix] = y_col_double[pix / SCREEN_WIDTH];
+    }
+
+    double times[5] = {};
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t start = TimeCounterStart();
+        RenderMandelbrotCounts(grid_counts, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, false);
+        int64_t grid = TimeCounterEnd();
+        RenderMandelbrotPoints(counts, NULL, x, y, N_PIXELS, N_ITERATIONS);
+        int64_t points = TimeCounterEnd();
+        RenderMandelbrotPoints(counts, r2, x, y, N_PIXELS, N_ITERATIONS);
+        int64_t points_r2 = TimeCounterEnd();
+        RenderMandelbrotCounts(grid_double, SCREEN_WIDTH, SCREEN_HEIGHT, (double)x_rend, (double)y_rend, (double)delta, N_ITERATIONS, false);
+        int64_t grid_double_end = TimeCounterEnd();
+        RenderMandelbrotPoints(counts, NULL, x_double, y_double, N_PIXELS, N_ITERATIONS);
+        int64_t end = TimeCounterEnd();
+
+        times[0] += (double)(grid            - start);
+        times[1] += (double)(points          - grid);
+        times[2] += (double)(points_r2       - points);
+        times[3] += (double)(grid_double_end - points_r2);
+        times[4] += (double)(end             - grid_double_end);
+    }
+
+    // The loop ends on the double points, so counts holds them now.
+    size_t n_different = 0;
+    for(size_t pix = 0; pix < N_PIXELS; pix++) n_different += (counts[pix] != grid_double[pix]);
+
+    RenderMandelbrotPoints(counts, r2, x, y, N_PIXELS, N_ITERATIONS);
+    for(size_t pix = 0; pix < N_PIXELS; pix++) n_different += (counts[pix] != grid_counts[pix]);
+
+    RenderMandelbrotPoints(counts, NULL, x, y, N_PIXELS, N_ITERATIONS);
+    for(size_t pix = 0; pix < N_PIXELS; pix++) n_different += (counts[pix] != grid_counts[pix]);
+
+    // Fisher-Yates with a fixed seed, x and y of a point moved together.
+    srand(1);
+    for(size_t pix = N_PIXELS - 1; pix > 0; pix--)
+    {
+        size_t other = (size_t)rand() % (pix + 1);
+
+        float x_swap = x[pix];
+        float y_swap = y[pix];
+        x[pix]   = x[other];
+        y[pix]   = y[other];
+        x[other] = x_swap;
+        y[other] = y_swap;
+    }
+
+    double shuffled_time = 0;
+    for(size_t i = 0; i < N_TESTS; i++)
+    {
+        int64_t start = TimeCounterStart();
+        RenderMandelbrotPoints(counts, NULL, x, y, N_PIXELS, N_ITERATIONS);
+        shuffled_time += (double)(TimeCounterEnd() - start);
+    }
+
+    printf("point list, starting view: float %.0lf ticks (grid %.0lf, %+.1lf%%), with |z|^2 %.0lf (%+.1lf%%), double %.0lf (grid %.0lf, %+.1lf%%); "
+           "%zu counts differ from the grid%s; shuffled points %.0lf (%.2lfx)\n", times[1] / N_TESTS, times[0] / N_TESTS, 100 * (times[1] / times[0] - 1),
+           times[2] / N_TESTS, 100 * (times[2] / times[1] - 1), times[4] / N_TESTS, times[3] / N_TESTS, 100 * (times[4] / times[3] - 1), n_different,
+           (n_different == 0) ? "" : ", FAILED", shuffled_time / N_TESTS, shuffled_time / times[1]);
+
+    free(y_col_double);
+    free(x_row_double);
+    free(y_col);
+    free(x_row);
+    free(y_double);
+    free(x_double);
+    free(y);
+    free(x);
+    free(r2);
+    free(grid_double);
+    free(grid_counts);
+    free(counts);
+
+    return n_different == 0;
+}
+
+// Share of pixels the interval pre-pass fills without the kernel, and what it saves, on the views of TestEqualization, a
+// deep one at the end of double precision and the minibrot on the real axis. The starting view also goes through the
+// float overload. Counts have to equal those of the kernel alone on every view, otherwise the test fails.
+bool TestIntervalTiles(float x_rend, float y_rend, float delta)
+{
+    const size_t   N_TESTS  = 5;
+    const unsigned N_VIEWS  = 5;
+    const size_t   N_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    const char *const NAMES[N_VIEWS]      = {"starting view", "seahorse valley", "spiral", "deep spiral", "period 3 minibrot"};
+    const double      VIEWS[N_VIEWS][3]   = {{x_rend, y_rend, delta},
+                                             {-0.745 - 0.025, 0.113 + 0.025 * SCREEN_HEIGHT / SCREEN_WIDTH, 0.05 / SCREEN_WIDTH},
+                                             {-0.7436439 - 5e-5, 0.1318259 + 5e-5 * SCREEN_HEIGHT / SCREEN_WIDTH, 1e-4 / SCREEN_WIDTH},
+                                             {-0.743643887037151 - 5e-11, 0.131825904205330 + 5e-11 * SCREEN_HEIGHT / SCREEN_WIDTH, 1e-10 / SCREEN_WIDTH},
+                                             {-1.7548776662466927 - 0.02, 0.02 * SCREEN_HEIGHT / SCREEN_WIDTH, 0.04 / SCREEN_WIDTH}};
+    const unsigned    ITERATIONS[N_VIEWS] = {N_ITERATIONS, N_ITERATIONS, 2000, 5000, N_ITERATIONS};
+
+    unsigned *counts       = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *plain_counts = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+
+    bool passed = true;
+    for(unsigned view = 0; view < N_VIEWS + 1; view++)
+    {
+        bool     as_float = (view == N_VIEWS);
+        unsigned source   = as_float ? 0 : view;
+
+        double plain_time    = 0;
+        double interval_time = 0;
+        size_t n_proven      = 0;
+        for(size_t i = 0; i < N_TESTS; i++)
+        {
+            int64_t start = TimeCounterStart();
+            if(as_float) RenderMandelbrotCounts(plain_counts, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, ITERATIONS[source], false);
+            else RenderMandelbrotCounts(plain_counts, SCREEN_WIDTH, SCREEN_HEIGHT, VIEWS[source][0], VIEWS[source][1], VIEWS[source][2],
+                                        ITERATIONS[source], false);
+            int64_t plain = TimeCounterEnd();
+            if(as_float) n_proven = RenderMandelbrotIntervalCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, ITERATIONS[source]);
+            else n_proven = RenderMandelbrotIntervalCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, VIEWS[source][0], VIEWS[source][1], VIEWS[source][2],
+                                                           ITERATIONS[source]);
+            int64_t end = TimeCounterEnd();
+
+            plain_time    += (double)(plain - start);
+            interval_time += (double)(end   - plain);
+        }
+
+        size_t n_different = 0;
+        for(size_t pix = 0; pix < N_PIXELS; pix++) n_different += (counts[pix] != plain_counts[pix]);
+
+        printf("interval tiles, %s%s: %.1lf%% of the pixels proven, %.0lf ticks, kernel alone %.0lf (%.2lfx); %zu counts differ%s\n",
+               NAMES[source], as_float ? " in float" : "", 100.0 * n_proven / N_PIXELS, interval_time / N_TESTS,
+               plain_time / N_TESTS, plain_time / interval_time, n_different, (n_different == 0) ? "" : ", FAILED");
+
+        passed &= (n_different == 0);
+    }
+
+    free(plain_counts);
+    free(counts);
+
+    return passed;
+}
+
+// Replays moves of the viewer in real time, once rendering every frame and once with the prefetcher: the think time of a
+// move is slept with the frame shown, then the latency runs from the key to the colored frame. --trace FILE replays a
+// trace the viewer recorded, otherwise two synthetic ones run, browsing and a held key at the key repeat rate.
+bool TestPrefetch(const char *trace_path, float x_rend, float y_rend, float delta)
+{
+    const size_t MAX_EVENTS  = 4096;
+    const size_t N_SYNTHETIC = 60;
+
+    double   *think_ms = (double   *)calloc(MAX_EVENTS, sizeof(double));
+    ViewMove *moves    = (ViewMove *)calloc(MAX_EVENTS, sizeof(ViewMove));
+
+    bool passed = true;
+    if(trace_path)
+    {
+        size_t n_events = ReadTrace(trace_path, think_ms, moves, MAX_EVENTS);
+        if(n_events > 0) passed &= ReplayTrace(trace_path, think_ms, moves, n_events, x_rend, y_rend, delta);
+    }
+    else
+    {
+        SyntheticTrace(think_ms, moves, N_SYNTHETIC, false);
+        passed &= ReplayTrace("browsing", think_ms, moves, N_SYNTHETIC, x_rend, y_rend, delta);
+
+        SyntheticTrace(think_ms, moves, N_SYNTHETIC, true);
+        passed &= ReplayTrace("held key", think_ms, moves, N_SYNTHETIC, x_rend, y_rend, delta);
+    }
+
+    free(moves);
+    free(think_ms);
+
+    return passed;
+}
+
+// The frames taken from the prefetcher are checked against a fresh render before it is started again, outside of the
+// latency and of the think time; a single differing count fails the test.
+bool ReplayTrace(const char *name, const double *think_ms, const ViewMove *moves, size_t n_events, float x_rend, float y_rend, float delta)
+{
+    const size_t N_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    unsigned *counts       = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *fresh_counts = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    uint8_t  *pixels       = (uint8_t  *)calloc(N_PIXELS, 4 * sizeof(uint8_t));
+    double   *latency_ms   = (double   *)calloc(n_events, sizeof(double));
+
+    Prefetcher prefetcher = {};
+    PrefetchInit(&prefetcher, N_ITERATIONS, PIXELS_PER_OFFSET);
+
+    size_t n_different = 0;
+    for(unsigned pass = 0; pass < 2; pass++)
+    {
+        bool speculate = (pass == 1);
+
+        PrefetchView view = {x_rend, y_rend, delta, SCREEN_WIDTH, SCREEN_HEIGHT};
+        RenderMandelbrotCounts(counts, view.width, view.height, view.x_rend, view.y_rend, view.delta, N_ITERATIONS, true);
+        ColorMandelbrot(pixels, counts, N_PIXELS);
+        if(speculate) PrefetchStart(&prefetcher, &view);
+
+        size_t n_hits = 0;
+        for(size_t event = 0; event < n_events; event++)
+        {
+            usleep((useconds_t)(think_ms[event] * 1000));
+
+            double start_ms = FrameClockMs();
+            PrefetchStop(&prefetcher);
+
+            MoveView(&view.x_rend, &view.y_rend, &view.delta, view.width, view.height, moves[event], PIXELS_PER_OFFSET);
+            bool hit = speculate && PrefetchTake(&prefetcher, &view, counts);
+            if(!hit) RenderMandelbrotCounts(counts, view.width, view.height, view.x_rend, view.y_rend, view.delta, N_ITERATIONS, true);
+            ColorMandelbrot(pixels, counts, N_PIXELS);
+
+            latency_ms[event] = FrameClockMs() - start_ms;
+
+            if(hit)
             {
-                sf::Uint8 color = *(n_p++);
-                pixels[pix_arr_pos + 0] = color;
-                pixels[pix_arr_pos + 1] = color;
-                pixels[pix_arr_pos + 2] = color * 32;
+                RenderMandelbrotCounts(fresh_counts, view.width, view.height, view.x_rend, view.y_rend, view.delta, N_ITERATIONS, true);
+                for(size_t pix = 0; pix < N_PIXELS; pix++) n_different += (counts[pix] != fresh_counts[pix]);
+                n_hits++;
             }
-#endif
+            if(speculate) PrefetchStart(&prefetcher, &view);
         }
+        PrefetchStop(&prefetcher);
+
+        double mean_ms = 0;
+        for(size_t event = 0; event < n_events; event++) mean_ms += latency_ms[event];
+        mean_ms /= n_events;
+
+        qsort(latency_ms, n_events, sizeof(double), [](const void *a, const void *b)
+        {
+            double lhs = *(const double *)a;
+            double rhs = *(const double *)b;
+            return (lhs < rhs) ? -1 : (lhs > rhs) ? 1 : 0;
+        });
+
+        printf("prefetch, %s, %zu moves %s: latency %.1lf ms mean, %.1lf ms p95", name, n_events, speculate ? "with it" : "without",
+               mean_ms, latency_ms[(n_events * 95) / 100 < n_events ? (n_events * 95) / 100 : n_events - 1]);
+        if(speculate) printf("; %zu hits (%.0lf%%), %zu of their counts differ from a fresh render%s", n_hits, 100.0 * n_hits / n_events,
+                             n_different, (n_different == 0) ? "" : ", FAILED");
+        printf("\n");
     }
 
-#ifndef RENDER
-    int64_t end = TimeCounter();
-    return (end - start);
-#endif
+    PrefetchFree(&prefetcher);
+
+    free(latency_ms);
+    free(pixels);
+    free(fresh_counts);
+    free(counts);
 
-    return 0;
+    return n_different == 0;
 }
 
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
+// Lines of "<milliseconds since the frame was shown> <move>", as the viewer writes them with --trace.
+size_t ReadTrace(const char *path, double *think_ms, ViewMove *moves, size_t max_events)
 {
-    static sf::Sprite sprite;
-    static sf::Texture texture;
+    FILE *file = fopen(path, "r");
+    if(!file)
+    {
+        perror(path);
+        return 0;
+    }
 
-    texture.create(SCREEN_WIDTH, SCREEN_HEIGHT);
-    texture.update(pixels);
+    size_t n_events = 0;
+    double ms       = 0;
+    char   name[16] = "";
+    while(n_events < max_events && fscanf(file, "%lf %15s", &ms, name) == 2)
+    {
+        for(unsigned move = 0; move < PREFETCH_N_MOVES; move++)
+        {
+            if(strcmp(name, MoveName((ViewMove)move)) != 0) continue;
 
-    sprite.setTexture(texture);
+            think_ms[n_events] = ms;
+            moves[n_events]    = (ViewMove)move;
+            n_events++;
+        }
+    }
 
-    window.clear(sf::Color::Black);
-    window.draw(sprite);
-    window.display();
+    fclose(file);
+    return n_events;
 }
 
-void TestSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+// The same moves on every run. Browsing keeps its direction 60% of the time, otherwise pans 70%, zooms in 20% and out
+// 10%, after 80 to 400 ms; a held arrow repeats one pan every 33 ms, in runs of 12.
+void SyntheticTrace(double *think_ms, ViewMove *moves, size_t n_events, bool held_key)
 {
-    const size_t N_TESTS = 100;
-    int64_t results[N_TESTS] = {};
+    const size_t HELD_RUN = 12;
 
-    double result_time = 0;
-    double error       = 0;
+    uint32_t seed = held_key ? 2 : 1;
+    auto random = [&seed]()
+    {
+        seed = seed * 1664525 + 1013904223;
+        return (double)(seed >> 8) / (1 << 24);
+    };
 
-    for(size_t i = 0; i < N_TESTS; i++)
+    ViewMove move = MOVE_RIGHT;
+    for(size_t event = 0; event < n_events; event++)
     {
-        int64_t delta_time = RenderMandelbrot(pixels, x_rend, y_rend, delta);
-        results[i]   = delta_time;
-        result_time += (double)delta_time;
+        if(held_key)
+        {
+            if(event % HELD_RUN == 0) move = (ViewMove)(random() * 4);
+            think_ms[event] = 33;
+        }
+        else
+        {
+            if(random() >= 0.6 || move >= MOVE_ZOOM_IN)
+            {
+                double kind = random();
+                move = (kind < 0.7) ? (ViewMove)(random() * 4) : (kind < 0.9) ? MOVE_ZOOM_IN : MOVE_ZOOM_OUT;
+            }
+            think_ms[event] = 80 + 320 * random();
+        }
+
+        moves[event] = move;
+    }
+}
+
+// The tile coordinator next to this program, mandelbrot-render.out, against one RenderMandelbrotCounts call on the same
+// view: small tiles that do not start on a vector, three workers, the first of them killed half way so its tiles are
+// rendered again by the others. Every count has to be the same, in float and in double, otherwise the test fails.
+bool TestTileRender(const char *program)
+{
+    const unsigned WIDTH      = 1000;
+    const unsigned HEIGHT     = 700;
+    const double   CENTER_X   = -0.7;
+    const double   CENTER_Y   = 0.1;
+    const double   SPAN       = 1.3;
+    const unsigned TILE       = 60;
+    const unsigned N_WORKERS  = 3;
+    const unsigned KILL_AFTER = 60;
+    const size_t   N_PIXELS   = (size_t)WIDTH * HEIGHT;
+
+    unsigned *counts       = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    unsigned *tiled_counts = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+
+    // The view as the coordinator computes it.
+    double delta  = SPAN / ((WIDTH > HEIGHT) ? WIDTH : HEIGHT);
+    double x_rend = CENTER_X - delta * (WIDTH  / 2);
+    double y_rend = CENTER_Y + delta * (HEIGHT / 2);
+
+    char output[] = "/tmp/mandelbrot-tiles-XXXXXX";
+    int  fd       = mkstemp(output);
+    if(fd >= 0) close(fd);
+
+    const char *slash = strrchr(program, '/');
+
+    bool passed = (fd >= 0);
+    for(unsigned high_precision = 0; high_precision < 2 && passed; high_precision++)
+    {
+        char command[512] = "";
+        snprintf(command, sizeof(command), "%.*smandelbrot-render.out --width %u --height %u --x %.17g --y %.17g --span %.17g --tile %u "
+                 "--workers %u --kill-after %u --format counts%s %s 2>/dev/null", slash ? (int)(slash - program + 1) : 0, program, WIDTH, HEIGHT,
+                 CENTER_X, CENTER_Y, SPAN, TILE, N_WORKERS, KILL_AFTER, high_precision ? " --double" : "", output);
+
+        bool   rendered = (system(command) == 0);
+        FILE  *file     = rendered ? fopen(output, "rb") : NULL;
+        size_t n_read   = file ? fread(tiled_counts, sizeof(unsigned), N_PIXELS, file) : 0;
+        if(file) fclose(file);
+
+        if(high_precision) RenderMandelbrotCounts(counts, WIDTH, HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+        else RenderMandelbrotCounts(counts, WIDTH, HEIGHT, (float)x_rend, (float)y_rend, (float)delta, N_ITERATIONS, true);
+
+        size_t n_different = 0;
+        for(size_t pix = 0; pix < N_PIXELS; pix++) n_different += (counts[pix] != tiled_counts[pix]);
+
+        passed = (n_read == N_PIXELS && n_different == 0);
+        if(n_read == N_PIXELS)
+        {
+            printf("tile coordinator, %s, %ux%u in tiles of %u on %u workers, one killed: %zu counts differ from one render%s\n",
+                   high_precision ? "[4 x double]" : "[8 x float]", WIDTH, HEIGHT, TILE, N_WORKERS, n_different, passed ? "" : ", FAILED");
+        }
+        else printf("tile coordinator: no image from \"%s\", FAILED\n", command);
+    }
+
+    unlink(output);
+
+    free(tiled_counts);
+    free(counts);
+
+    return passed;
+}
+
+// Energy of a frame from RAPL for each kernel, and for the batch kernel with 1, 2, 4 ... threads up to the number of
+// CPUs: every one renders the default view, without the mirror, for at least MIN_MS. The package also counts the
+// uncore, so it is measured idle first; without readable counters nothing is measured.
+void TestEnergy(float x_rend, float y_rend, float delta)
+{
+    const double   MIN_MS    = 2000;
+    const size_t   N_PIXELS  = SCREEN_WIDTH * SCREEN_HEIGHT;
+    const unsigned N_KERNELS = 4;
+
+    const char *const NAMES[N_KERNELS] = {"Mandelbrot [8 x float]", "Mandelbrot [4 x double]", "interval tiles [8 x float]", "batch [8 x float]"};
+
+    long     n_cpus      = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned max_threads = (unsigned)((n_cpus > 0) ? n_cpus : 1);
+    if(max_threads > BATCH_MAX_THREADS) max_threads = BATCH_MAX_THREADS;
+
+    EnergyCounters energy = {};
+    EnergyCountersOpen(&energy);
+    if(!EnergyAvailable(&energy, ENERGY_PACKAGE) && !EnergyAvailable(&energy, ENERGY_CORE))
+    {
+        printf("energy: no readable RAPL counters under %s (missing, or root only), skipped\n", ENERGY_POWERCAP_DIR);
+        return;
+    }
+
+    unsigned *counts = (unsigned *)calloc(N_PIXELS, sizeof(unsigned));
+    Viewport  frame  = {x_rend, y_rend, delta, SCREEN_WIDTH, SCREEN_HEIGHT, counts, NULL};
+
+    EnergyCountersStart(&energy);
+    double idle_start = FrameClockMs();
+    usleep((useconds_t)(MIN_MS * 1000));
+    EnergyCountersStop(&energy);
+    PrintEnergy(&energy, "idle", 0, 0, FrameClockMs() - idle_start);
+
+    for(unsigned kernel = 0; kernel < N_KERNELS; kernel++)
+    {
+        bool threaded = (kernel == N_KERNELS - 1);
+
+        unsigned n_threads = 1;
+        do {
+            size_t n_frames = 0;
+
+            EnergyCountersStart(&energy);
+            double start_ms = FrameClockMs();
+            do {
+                if(kernel == 0) RenderMandelbrotCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, false);
+                else if(kernel == 1) RenderMandelbrotCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, (double)x_rend, (double)y_rend, (double)delta,
+                                                            N_ITERATIONS, false);
+                else if(kernel == 2) RenderMandelbrotIntervalCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS);
+                else RenderMandelbrotBatch(&frame, 1, N_ITERATIONS, n_threads);
+
+                n_frames++;
+            } while(FrameClockMs() - start_ms < MIN_MS);
+            EnergyCountersStop(&energy);
+
+            PrintEnergy(&energy, NAMES[kernel], n_threads, n_frames, FrameClockMs() - start_ms);
+
+            if(!threaded || n_threads == max_threads) break;
+            n_threads = (2 * n_threads < max_threads) ? 2 * n_threads : max_threads;
+        } while(true);
+    }
+
+    free(counts);
+}
+
+// Joules per frame and megapixels per joule of every zone, or only the power when idle (n_frames == 0).
+void PrintEnergy(const EnergyCounters *energy, const char *kernel, unsigned n_threads, size_t n_frames, double elapsed_ms)
+{
+    static const char *const ZONE_NAMES[N_ENERGY_ZONES] = {"package", "core"};
+
+    if(n_frames > 0) printf("energy, %s, %u thread%s: %.1lf ms/frame", kernel, n_threads, (n_threads == 1) ? "" : "s", elapsed_ms / n_frames);
+    else             printf("energy, %s: %.0lf ms", kernel, elapsed_ms);
+
+    for(unsigned id = 0; id < N_ENERGY_ZONES; id++)
+    {
+        if(!EnergyAvailable(energy, (EnergyZoneId)id))
+        {
+            printf(", %s n/a", ZONE_NAMES[id]);
+            continue;
+        }
+
+        double joules = energy->joules[id];
+        double watts  = joules / (elapsed_ms * 1e-3);
+        if(n_frames > 0)
+        {
+            printf(", %s %.3lf J/frame (%.1lf W), %.2lf Mpixels/J", ZONE_NAMES[id], joules / n_frames, watts,
+                   (joules > 0) ? 1e-6 * n_frames * SCREEN_WIDTH * SCREEN_HEIGHT / joules : 0.0);
+        }
+        else printf(", %s %.1lf W", ZONE_NAMES[id], watts);
+    }
+    printf("\n");
+}
+
+// Renders the default view tile by tile with the unmodified kernel and writes three heatmaps:
+// profile-iterations.ppm - iterations per pixel,
+// profile-lanes.ppm      - share of idle lanes in each 8 pixel block (the block keeps looping until its slowest lane escapes),
+// profile-cycles.ppm     - TSC ticks spent on each PROFILE_TILE_WIDTH x PROFILE_TILE_HEIGHT tile.
+void ProfileSIMD(float x_rend, float y_rend, float delta)
+{
+    unsigned *counts      = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT,             sizeof(unsigned));
+    unsigned *tile_counts = (unsigned *)calloc(PROFILE_TILE_WIDTH * PROFILE_TILE_HEIGHT, sizeof(unsigned));
+    unsigned *block_trips = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT / 8,         sizeof(unsigned));
+    int64_t  *tile_cycles = (int64_t  *)calloc(PROFILE_N_TILES_X * PROFILE_N_TILES_Y,     sizeof(int64_t));
+
+    for(unsigned tile_y = 0; tile_y < PROFILE_N_TILES_Y; tile_y++)
+    {
+        for(unsigned tile_x = 0; tile_x < PROFILE_N_TILES_X; tile_x++)
+        {
+            float tile_x_rend = x_rend + tile_x * PROFILE_TILE_WIDTH  * delta;
+            float tile_y_rend = y_rend - tile_y * PROFILE_TILE_HEIGHT * delta;
+
+            int64_t start = TimeCounterStart();
+            RenderMandelbrotCounts(tile_counts, PROFILE_TILE_WIDTH, PROFILE_TILE_HEIGHT, tile_x_rend, tile_y_rend, delta, N_ITERATIONS, false);
+            int64_t end = TimeCounterEnd();
+
+            tile_cycles[tile_y * PROFILE_N_TILES_X + tile_x] = end - start;
+
+            for(unsigned y_pos = 0; y_pos < PROFILE_TILE_HEIGHT; y_pos++)
+            {
+                memcpy(counts + (tile_y * PROFILE_TILE_HEIGHT + y_pos) * SCREEN_WIDTH + tile_x * PROFILE_TILE_WIDTH,
+                       tile_counts + y_pos * PROFILE_TILE_WIDTH, PROFILE_TILE_WIDTH * sizeof(unsigned));
+            }
+        }
+    }
+
+    // The kernel leaves its loop on the first iteration where no lane is active, so a block loops
+    // one more time than its slowest lane counted, unless that lane hit the iteration limit.
+    uint64_t total_iterations = 0;
+    uint64_t total_trips      = 0;
+    unsigned max_iterations   = 0;
+    size_t   n_interior       = 0;
+
+    uint8_t *lanes_image = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 3 * sizeof(uint8_t));
+    for(size_t block = 0; block < SCREEN_WIDTH * SCREEN_HEIGHT / 8; block++)
+    {
+        unsigned block_max = 0;
+        unsigned block_sum = 0;
+        for(unsigned i = 0; i < 8; i++)
+        {
+            unsigned n = counts[8 * block + i];
+            block_sum += n;
+            if(n > block_max) block_max = n;
+            if(n == N_ITERATIONS) n_interior++;
+        }
+
+        block_trips[block] = (block_max < N_ITERATIONS) ? block_max + 1 : N_ITERATIONS;
+
+        total_iterations += block_sum;
+        total_trips      += block_trips[block];
+        if(block_max > max_iterations) max_iterations = block_max;
+
+        double idle = 1 - (double)block_sum / (8.0 * block_trips[block]);
+        for(unsigned i = 0; i < 8; i++)
+        {
+            HeatColor(lanes_image + 3 * (8 * block + i), idle);
+        }
+    }
+
+    uint8_t *iterations_image = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 3 * sizeof(uint8_t));
+    for(size_t pix_pos = 0; pix_pos < SCREEN_WIDTH * SCREEN_HEIGHT; pix_pos++)
+    {
+        HeatColor(iterations_image + 3 * pix_pos, (double)counts[pix_pos] / N_ITERATIONS);
+    }
+
+    size_t  n_tiles      = PROFILE_N_TILES_X * PROFILE_N_TILES_Y;
+    int64_t total_cycles = 0;
+    int64_t max_cycles   = 0;
+    for(size_t tile = 0; tile < n_tiles; tile++)
+    {
+        total_cycles += tile_cycles[tile];
+        if(tile_cycles[tile] > max_cycles) max_cycles = tile_cycles[tile];
+    }
+
+    uint8_t *cycles_image = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 3 * sizeof(uint8_t));
+    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos++)
+    {
+        for(unsigned x_pos = 0; x_pos < SCREEN_WIDTH; x_pos++)
+        {
+            int64_t cycles = tile_cycles[(y_pos / PROFILE_TILE_HEIGHT) * PROFILE_N_TILES_X + x_pos / PROFILE_TILE_WIDTH];
+            HeatColor(cycles_image + 3 * (y_pos * SCREEN_WIDTH + x_pos), (double)cycles / (double)max_cycles);
+        }
+    }
+
+    int64_t *sorted_cycles = (int64_t *)calloc(n_tiles, sizeof(int64_t));
+    memcpy(sorted_cycles, tile_cycles, n_tiles * sizeof(int64_t));
+    qsort(sorted_cycles, n_tiles, sizeof(int64_t), [](const void *a, const void *b)
+    {
+        int64_t lhs = *(const int64_t *)a;
+        int64_t rhs = *(const int64_t *)b;
+        return (lhs < rhs) ? 1 : (lhs > rhs) ? -1 : 0;
+    });
+
+    int64_t top_cycles = 0;
+    for(size_t tile = 0; tile < n_tiles / 10; tile++)
+    {
+        top_cycles += sorted_cycles[tile];
+    }
+
+    WritePPM("profile-iterations.ppm", iterations_image, SCREEN_WIDTH, SCREEN_HEIGHT);
+    WritePPM("profile-lanes.ppm",      lanes_image,      SCREEN_WIDTH, SCREEN_HEIGHT);
+    WritePPM("profile-cycles.ppm",     cycles_image,     SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    size_t n_pixels = SCREEN_WIDTH * SCREEN_HEIGHT;
+    printf("iterations:  %" PRIu64 " total, %.1lf per pixel, max %u, %.1lf%% of pixels at the limit\n",
+           total_iterations, (double)total_iterations / n_pixels, max_iterations, 100.0 * n_interior / n_pixels);
+    printf("loop trips:  %" PRIu64 " total, %.1lf per 8 lane block\n", total_trips, (double)total_trips / (n_pixels / 8));
+    printf("lanes:       %" PRIu64 " active of %" PRIu64 " lane iterations, %.1lf%% utilization\n",
+           total_iterations, 8 * total_trips, 100.0 * total_iterations / (8.0 * total_trips));
+    printf("tiles:       %ux%u, %" PRId64 " ticks total, min %" PRId64 ", median %" PRId64 ", max %" PRId64 ", top 10%% of tiles take %.1lf%%\n",
+           PROFILE_TILE_WIDTH, PROFILE_TILE_HEIGHT, total_cycles, sorted_cycles[n_tiles - 1], sorted_cycles[n_tiles / 2], sorted_cycles[0],
+           100.0 * top_cycles / total_cycles);
+
+    free(sorted_cycles);
+    free(cycles_image);
+    free(iterations_image);
+    free(lanes_image);
+    free(tile_cycles);
+    free(block_trips);
+    free(tile_counts);
+    free(counts);
+}
+
+// Black - blue - red - yellow - white for t from 0 to 1.
+inline void HeatColor(uint8_t *rgb, double t)
+{
+    if(t < 0) t = 0;
+    if(t > 1) t = 1;
+
+    double r = 3 * t - 1;
+    double g = 3 * t - 2;
+    double b = (t < 1.0 / 3) ? 3 * t : (t < 2.0 / 3) ? 2 - 3 * t : 3 * t - 2;
+
+    rgb[0] = (uint8_t)(255 * ((r < 0) ? 0 : (r > 1) ? 1 : r));
+    rgb[1] = (uint8_t)(255 * ((g < 0) ? 0 : g));
+    rgb[2] = (uint8_t)(255 * b);
+}
+
+inline void WritePPM(const char *path, const uint8_t *rgb, unsigned width, unsigned height)
+{
+    FILE *file = fopen(path, "wb");
+    if(!file)
+    {
+        perror(path);
+        return;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    fwrite(rgb, 3 * sizeof(uint8_t), (size_t)width * height, file);
+    fclose(file);
+}
+
+// Times a full render against a mirrored one. The mirrored render must be bit-exact with the full one, otherwise the
+// test fails; how far the snap moves rows against the unsnapped view is only reported.
+bool TestSymmetry(float x_rend, float y_rend, float delta)
+{
+    const size_t N_TESTS  = 10;
+    const size_t N_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    unsigned *full     = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    unsigned *mirrored = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+
+    float y_offset   = 0;
+    int   mirror_sum = FindMirrorSum(y_rend, delta, &y_offset);
+
+    unsigned n_mirrored = 0;
+    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos++)
+    {
+        if(MirrorSource(y_pos, mirror_sum) >= 0) n_mirrored++;
     }
-    result_time /= (double)N_TESTS;
 
+    double full_time     = 0;
+    double mirrored_time = 0;
     for(size_t i = 0; i < N_TESTS; i++)
     {
-        int64_t abs_err = results[i] - result_time;
-        error += (double)abs_err * (double)abs_err;
+        int64_t start = TimeCounterStart();
+        RenderMandelbrotCounts(full,     SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, false);
+        int64_t middle = TimeCounterEnd();
+        RenderMandelbrotCounts(mirrored, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+        int64_t end = TimeCounterEnd();
+
+        full_time     += (double)(middle - start);
+        mirrored_time += (double)(end - middle);
     }
-    error = sqrt(error / (double)N_TESTS);
-    double exp = pow(10, (int)log10(error));
 
-    error       = round(error       / exp) * exp;
-    result_time = round(result_time / exp) * exp;
-    printf("%lg ± %lg\n", result_time, error);
-}
\ No newline at end of file
+    bool exact = (memcmp(full, mirrored, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(unsigned)) == 0);
+
+    printf("symmetry: %u of %u rows mirrored, %s full render, x%.2lf faster%s\n",
+           n_mirrored, SCREEN_HEIGHT, exact ? "bit-exact with" : "DIFFERS from", full_time / mirrored_time, exact ? "" : ", FAILED");
+
+    // Both renders above place rows at the snapped y_offset, so they cannot show what the snap itself does. Against rows
+    // at the unsnapped y_rend / delta it moves every row by the same fraction of a pixel: none on the standard view, and
+    // SNAP_NUDGE on one nudged off the half-integer by less than the tolerance of FindMirrorSum.
+    const float SNAP_NUDGE = 1.0f / 4096;
+
+    float *x     = (float *)calloc(N_PIXELS, sizeof(float));
+    float *y     = (float *)calloc(N_PIXELS, sizeof(float));
+    float *x_row = (float *)calloc(SCREEN_WIDTH,  sizeof(float));
+    float *y_col = (float *)calloc(SCREEN_HEIGHT, sizeof(float));
+
+    for(unsigned nudged = 0; nudged < 2; nudged++)
+    {
+        float view_y = y_rend + (float)nudged * SNAP_NUDGE * delta;
+
+        float shift = 0;
+        FindMirrorSum(view_y, delta, &shift);
+        shift -= view_y / delta;
+
+        GridCoordinates(x_row, y_col, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, view_y, delta);
+        for(size_t pix = 0; pix < N_PIXELS; pix++)
+        {
+            x[pix] = x_row[pix % SCREEN_WIDTH];
+            y[pix] = (view_y / delta - (float)(pix / SCREEN_WIDTH)) * delta;
+        }
+
+        RenderMandelbrotCounts(mirrored, SCREEN_WIDTH, SCREEN_HEIGHT, x_rend, view_y, delta, N_ITERATIONS, true);
+        RenderMandelbrotPoints(full, NULL, x, y, N_PIXELS, N_ITERATIONS);
+
+        size_t n_differ = 0;
+        for(size_t pix = 0; pix < N_PIXELS; pix++) n_differ += (full[pix] != mirrored[pix]);
+
+        printf("symmetry: %s view, rows snapped by %.2e pixel, %zu of %zu counts differ from unsnapped rows\n",
+               nudged ? "nudged" : "standard", fabs(shift), n_differ, N_PIXELS);
+    }
+
+    free(y_col);
+    free(x_row);
+    free(y);
+    free(x);
+    free(mirrored);
+    free(full);
+
+    return exact;
+}
+
+// Renders the same view at the default width and at widths that leave 1, 5 and 7 pixels in the last vector of each row.
+// Columns all widths share must match the aligned render exactly, otherwise the test fails; ticks per pixel should
+// stay close to it.
+bool TestResolution(float x_rend, float y_rend, float delta)
+{
+    const size_t   N_TESTS  = 20;
+    const unsigned N_WIDTHS = 4;
+    const unsigned WIDTHS[N_WIDTHS] = {SCREEN_WIDTH, SCREEN_WIDTH - 3, SCREEN_WIDTH - 7, SCREEN_WIDTH + 1};
+
+    unsigned *counts[N_WIDTHS] = {};
+    double    times[N_WIDTHS]  = {};
+    for(unsigned i = 0; i < N_WIDTHS; i++)
+    {
+        counts[i] = (unsigned *)calloc(WIDTHS[i] * SCREEN_HEIGHT, sizeof(unsigned));
+    }
+
+    // Widths take turns, so frequency changes during the test spread over all of them evenly.
+    for(size_t test = 0; test < N_TESTS; test++)
+    {
+        for(unsigned i = 0; i < N_WIDTHS; i++)
+        {
+            int64_t start = TimeCounterStart();
+            RenderMandelbrotCounts(counts[i], WIDTHS[i], SCREEN_HEIGHT, x_rend, y_rend, delta, N_ITERATIONS, true);
+            int64_t end = TimeCounterEnd();
+
+            times[i] += (double)(end - start) / WIDTHS[i];
+        }
+    }
+
+    bool passed = true;
+    for(unsigned i = 0; i < N_WIDTHS; i++)
+    {
+        unsigned width  = WIDTHS[i];
+        unsigned shared = (width < SCREEN_WIDTH) ? width : SCREEN_WIDTH;
+
+        bool exact = true;
+        for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT && exact; y_pos++)
+        {
+            exact = (memcmp(counts[i] + (size_t)y_pos * width, counts[0] + (size_t)y_pos * SCREEN_WIDTH, shared * sizeof(unsigned)) == 0);
+        }
+
+        printf("resolution %ux%u: %.1lf ticks per pixel (x%.3lf of aligned), %s\n", width, SCREEN_HEIGHT,
+               times[i] / (N_TESTS * SCREEN_HEIGHT), times[i] / times[0], exact ? "matches aligned render" : "DIFFERS from aligned render, FAILED");
+        passed &= exact;
+    }
+
+    for(unsigned i = 0; i < N_WIDTHS; i++)
+    {
+        free(counts[i]);
+    }
+
+    return passed;
+}
+
+// Iterations per TSC tick of every formula, relative to the Mandelbrot kernel, on a small view inside the set, where
+// every lane runs all N_ITERATIONS. Ratios on other views would compare different images: the rate there also counts the
+// lanes that wait for the rest of their vector, and how many do depends on the picture. The share of pixels at the cap
+// is printed, so a view that is not all inside shows. Rows are never mirrored.
+void TestFractals(void)
+{
+    const size_t N_TESTS       = 10;
+    const float  INTERIOR_SPAN = 0.1f;
+
+    const Fractal FRACTALS[N_FRACTALS] = {{FRACTAL_MANDELBROT,   0,     0},
+                                          {FRACTAL_JULIA,       -0.1,   0.1},
+                                          {FRACTAL_BURNING_SHIP, 0,     0},
+                                          {FRACTAL_MULTIBROT3,   0,     0},
+                                          {FRACTAL_MULTIBROT4,   0,     0}};
+
+    // c = -0.1 is inside all of the parameter-space sets, the fixed point near z = 0 attracts the orbits of the Julia set.
+    float interior_delta  = INTERIOR_SPAN / SCREEN_WIDTH;
+    float interior_y_rend = interior_delta * (SCREEN_HEIGHT / 2);
+
+    unsigned *counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+
+    double rates[N_FRACTALS] = {};
+    for(unsigned type = 0; type < N_FRACTALS; type++)
+    {
+        float interior_x_rend = ((type == FRACTAL_JULIA) ? 0 : -0.1f) - INTERIOR_SPAN / 2;
+
+        double time = 0;
+        for(size_t i = 0; i < N_TESTS; i++)
+        {
+            int64_t start = TimeCounterStart();
+            RenderFractalCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, interior_x_rend, interior_y_rend, interior_delta, N_ITERATIONS, FRACTALS[type], false);
+            time += (double)(TimeCounterEnd() - start);
+        }
+
+        double n_iterations = 0;
+        size_t n_inside     = 0;
+        for(size_t pix = 0; pix < SCREEN_WIDTH * SCREEN_HEIGHT; pix++)
+        {
+            n_iterations += counts[pix];
+            n_inside     += (counts[pix] == N_ITERATIONS);
+        }
+
+        rates[type] = n_iterations * N_TESTS / time;
+
+        printf("%-14s iterations per tick inside the set: %.3lf (x%.2lf), %.1lf%% of pixels at the cap\n", FractalName((FractalType)type),
+               rates[type], rates[type] / rates[0], 100.0 * (double)n_inside / (SCREEN_WIDTH * SCREEN_HEIGHT));
+    }
+
+    free(counts);
+}
+
+// Compression ratio and throughput of the escape count codec on the starting view and on views of the boundary with
+// little interior and many small differences. Throughput is in GB of raw counts per second, the counts must come back
+// exactly, otherwise the test fails.
+bool TestTileCodec(float x_rend, float y_rend, float delta)
+{
+    const size_t   N_TESTS  = 50;
+    const unsigned N_VIEWS  = 4;
+    const size_t   N_COUNTS = SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    const char *const NAMES[N_VIEWS] = {"starting view", "seahorse valley", "elephant valley", "spiral"};
+    const float CENTERS[N_VIEWS][2]  = {{0, 0}, {-0.745f, 0.113f}, {0.28f, 0.008f}, {-0.7436439f, 0.1318259f}};
+    const float SPANS[N_VIEWS]       = {0, 0.05f, 0.02f, 0.0005f};
+
+    unsigned *counts  = (unsigned *)calloc(N_COUNTS, sizeof(unsigned));
+    unsigned *decoded = (unsigned *)calloc(N_COUNTS, sizeof(unsigned));
+    uint8_t  *encoded = (uint8_t  *)calloc(EncodedCountsBound(N_COUNTS), 1);
+
+    bool passed = true;
+    for(unsigned view = 0; view < N_VIEWS; view++)
+    {
+        float view_x     = x_rend;
+        float view_y     = y_rend;
+        float view_delta = delta;
+        if(view > 0)
+        {
+            view_delta = SPANS[view] / SCREEN_WIDTH;
+            view_x     = CENTERS[view][0] - view_delta * (SCREEN_WIDTH  / 2);
+            view_y     = CENTERS[view][1] + view_delta * (SCREEN_HEIGHT / 2);
+        }
+        RenderMandelbrotCounts(counts, SCREEN_WIDTH, SCREEN_HEIGHT, view_x, view_y, view_delta, N_ITERATIONS, true);
+
+        size_t size = 0;
+        double start_ms = FrameClockMs();
+        for(size_t i = 0; i < N_TESTS; i++) size = EncodeCounts(encoded, counts, N_COUNTS);
+        double encode_ms = FrameClockMs() - start_ms;
+
+        bool exact = true;
+        start_ms = FrameClockMs();
+        for(size_t i = 0; i < N_TESTS; i++) exact = DecodeCounts(decoded, N_COUNTS, encoded, size) && exact;
+        double decode_ms = FrameClockMs() - start_ms;
+
+        exact = exact && (memcmp(counts, decoded, N_COUNTS * sizeof(unsigned)) == 0);
+
+        double raw_gb = (double)N_COUNTS * sizeof(unsigned) * N_TESTS * 1e-9;
+        printf("codec, %-15s: %zu -> %zu bytes (x%.1lf, %.2lf bits per pixel), encode %.2lf GB/s, decode %.2lf GB/s, %s\n", NAMES[view],
+               N_COUNTS * sizeof(unsigned), size, (double)N_COUNTS * sizeof(unsigned) / size, 8.0 * size / N_COUNTS,
+               raw_gb / (encode_ms * 1e-3), raw_gb / (decode_ms * 1e-3), exact ? "exact" : "DIFFERS, FAILED");
+        passed &= exact;
+    }
+
+    free(encoded);
+    free(decoded);
+    free(counts);
+
+    return passed;
+}
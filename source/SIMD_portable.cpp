@@ -1,24 +1,30 @@
+#ifdef RENDER
 #include "SFML/Graphics.hpp"
 #include "SFML/Window.hpp"
 #include "SFML/System.hpp"
+#endif
 
 #include <immintrin.h>
 #include <inttypes.h>
 #include <math.h>
 #include <string.h>
 
+#include "PerfCounters.h"
+
 const unsigned SCREEN_WIDTH  = 1920;
 const unsigned SCREEN_HEIGHT = 1080;
 
 const unsigned PIXELS_PER_OFFSET = 20;
 const float MAX_ZERO_OFFSET      = 2;
 
+#ifdef RENDER
 inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render);
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels);
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels);
+#endif
 
-inline int64_t TimeCounter(void);
-void TestSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta);
+inline int64_t RenderMandelbrot(uint8_t *pixels, float x_rend, float y_rend, float delta);
+
+void TestSIMD(uint8_t *pixels, float x_rend, float y_rend, float delta);
 
 int main(void)
 {
@@ -30,8 +36,8 @@ int main(void)
     float x_rend = -MAX_ZERO_OFFSET;
     float y_rend = MAX_ZERO_OFFSET * ratio;
 // ================================================================================================================================================================================
-    sf::Uint8 *pixels = (sf::Uint8 *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(sf::Uint8));
-    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(sf::Uint8)));
+    uint8_t *pixels = (uint8_t *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, 4 * sizeof(uint8_t));
+    memset(pixels, 255, (SCREEN_WIDTH * SCREEN_HEIGHT) * (4 * sizeof(uint8_t)));
 // ================================================================================================================================================================================
 #ifndef RENDER
     TestSIMD(pixels, x_rend, y_rend, delta);
@@ -62,26 +68,7 @@ int main(void)
 // ================================================================================================================================================================================
 }
 
-inline int64_t TimeCounter(void)
-{
-    int64_t result = 0;
-
-    asm volatile
-    (
-        ".intel_syntax noprefix\n\t"
-        "rdtsc\n\t"
-        "shl rdx, 32\n\t"
-        "add rax, rdx\n\t"
-        "mov %0, rax\n\t"
-        ".att_syntax prefix\n\t"
-        : "=r"(result)
-        :
-        : "%rdx", "%rax"
-    );
-
-    return result;
-}
-
+#ifdef RENDER
 inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_rend, float &y_rend, float &delta, bool &to_render)
 {
     switch(event.type)
@@ -144,11 +131,12 @@ inline void ProcessEvent(sf::RenderWindow &window, sf::Event &event, float &x_re
         }
     }
 }
+#endif
 
-inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+inline int64_t RenderMandelbrot(uint8_t *pixels, float x_rend, float y_rend, float delta)
 {
 #ifndef RENDER
-    int64_t start = TimeCounter();
+    int64_t start = TimeCounterStart();
 #endif
 
     static const unsigned N_ITERATIONS = 255;
@@ -193,7 +181,7 @@ inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, f
             unsigned *n_p = (unsigned *)&n;
             for(unsigned i = 0; i < 8; i++, pix_arr_pos += 4)
             {
-                sf::Uint8 color = *(n_p++);
+                uint8_t color = *(n_p++);
                 pixels[pix_arr_pos + 0] = color;
                 pixels[pix_arr_pos + 1] = color;
                 pixels[pix_arr_pos + 2] = color * 32;
@@ -203,14 +191,15 @@ inline int64_t RenderMandelbrot(sf::Uint8 *pixels, float x_rend, float y_rend, f
     }
 
 #ifndef RENDER
-    int64_t end = TimeCounter();
+    int64_t end = TimeCounterEnd();
     return (end - start);
 #endif
 
     return 0;
 }
 
-inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
+#ifdef RENDER
+inline void DrawMandelbrot(sf::RenderWindow &window, uint8_t *pixels)
 {
     static sf::Sprite sprite;
     static sf::Texture texture;
@@ -224,8 +213,9 @@ inline void DrawMandelbrot(sf::RenderWindow &window, sf::Uint8 *pixels)
     window.draw(sprite);
     window.display();
 }
+#endif
 
-void TestSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
+void TestSIMD(uint8_t *pixels, float x_rend, float y_rend, float delta)
 {
     const size_t N_TESTS = 100;
     int64_t results[N_TESTS] = {};
@@ -233,9 +223,17 @@ void TestSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
     double result_time = 0;
     double error       = 0;
 
+    PrintTSCCalibration();
+
+    PerfCounters counters = {};
+    PerfCountersOpen(&counters);
+
     for(size_t i = 0; i < N_TESTS; i++)
     {
+        PerfCountersStart(&counters);
         int64_t delta_time = RenderMandelbrot(pixels, x_rend, y_rend, delta);
+        PerfCountersStop(&counters);
+
         results[i]   = delta_time;
         result_time += (double)delta_time;
     }
@@ -252,4 +250,7 @@ void TestSIMD(sf::Uint8 *pixels, float x_rend, float y_rend, float delta)
     error       = round(error       / exp) * exp;
     result_time = round(result_time / exp) * exp;
     printf("%lg ± %lg\n", result_time, error);
+
+    PrintPerfCounters(&counters);
+    PerfCountersClose(&counters);
 }
\ No newline at end of file
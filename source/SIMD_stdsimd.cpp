@@ -0,0 +1,261 @@
+#include <experimental/simd>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "PerfCounters.h"
+
+// The kernel of SIMD.cpp written against std::experimental::simd instead of x86 intrinsics. native_simd<REAL> is as
+// wide as the target allows: [8 x float] and [4 x double] with -mavx2, [4 x float] and [2 x double] with plain SSE2,
+// NEON, AltiVec and so on elsewhere, and the same source compiles everywhere. With AVX2 the intrinsic kernel runs the
+// same loop next to it, so both the time and the escape counts can be compared. Only the timing (the TSC) is x86.
+
+namespace stdx = std::experimental;
+
+const unsigned SCREEN_WIDTH  = 1920;
+const unsigned SCREEN_HEIGHT = 1080;
+
+const unsigned N_ITERATIONS    = 255;
+const float    MAX_ZERO_OFFSET = 2;
+
+const size_t N_TESTS = 20;
+
+template<typename REAL>
+int64_t RenderPortable(unsigned *counts, REAL x_rend, REAL y_rend, REAL delta);
+
+#ifdef __AVX2__
+int64_t RenderIntrinsics(unsigned *counts, float  x_rend, float  y_rend, float  delta);
+int64_t RenderIntrinsics(unsigned *counts, double x_rend, double y_rend, double delta);
+#endif
+
+template<typename REAL>
+void TestPortable(unsigned *portable_counts, unsigned *intrinsic_counts, const char *type_name);
+int CompareTicks(const void *first, const void *second);
+
+int main(void)
+{
+// ================================================================================================================================================================================
+    unsigned *portable_counts  = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+    unsigned *intrinsic_counts = (unsigned *)calloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(unsigned));
+// ================================================================================================================================================================================
+    PrintTSCCalibration();
+
+    TestPortable<float> (portable_counts, intrinsic_counts, "float");
+    TestPortable<double>(portable_counts, intrinsic_counts, "double");
+// ================================================================================================================================================================================
+    free(intrinsic_counts);
+    free(portable_counts);
+
+    return EXIT_SUCCESS;
+// ================================================================================================================================================================================
+}
+
+// Counts are kept in REAL lanes, as a mask of REAL lanes can only be applied to a vector of the same type. Both types
+// count exactly far beyond N_ITERATIONS. where(cmp, n) += 1 would add to all lanes and blend the result back, the step
+// masked to 1 is a single and, like the subtraction of the mask in the intrinsic kernel.
+template<typename REAL>
+int64_t RenderPortable(unsigned *counts, REAL x_rend, REAL y_rend, REAL delta)
+{
+    typedef stdx::native_simd<REAL> Vector;
+    const unsigned LANES = (unsigned)Vector::size();
+
+    int64_t start = TimeCounterStart();
+
+    const Vector MAX_ZERO_OFFSET2_V = MAX_ZERO_OFFSET * MAX_ZERO_OFFSET;
+    const Vector SHIFT_V([](auto lane) { return (REAL)lane; });
+
+    Vector delta_v         = delta;
+    Vector delta_v_shifted = SHIFT_V * delta_v;
+    Vector packed_adj_v    = LANES * delta;
+
+    size_t pix_arr_pos = 0;
+
+    Vector y_0 = y_rend;
+    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos++, y_0 -= delta_v)
+    {
+        Vector x_0 = x_rend + delta_v_shifted;
+        for(unsigned x_pos = 0; x_pos < SCREEN_WIDTH; x_pos += LANES, x_0 += packed_adj_v)
+        {
+            Vector x_n = 0;
+            Vector y_n = 0;
+            Vector n   = 0;
+            for(volatile unsigned i = 0; i < N_ITERATIONS; i++)
+            {
+                Vector x2 = x_n * x_n;
+                Vector y2 = y_n * y_n;
+                Vector xy = x_n * y_n;
+
+                auto cmp = (x2 + y2 < MAX_ZERO_OFFSET2_V);
+                if(stdx::none_of(cmp)) break;
+
+                Vector step = 0;
+                stdx::where(cmp, step) = 1;
+                n += step;
+
+                x_n = x2 - y2 + x_0;
+                y_n = xy + xy + y_0;
+            }
+
+            for(unsigned lane = 0; lane < LANES; lane++)
+            {
+                counts[pix_arr_pos++] = (unsigned)n[lane];
+            }
+        }
+    }
+
+    return TimeCounterEnd() - start;
+}
+
+#ifdef __AVX2__
+int64_t RenderIntrinsics(unsigned *counts, float x_rend, float y_rend, float delta)
+{
+    int64_t start = TimeCounterStart();
+
+    const __m256 MAX_ZERO_OFFSET2_V = _mm256_set1_ps(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+    const __m256 SHIFT_V            = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+
+    __m256 delta_v         = _mm256_set1_ps(delta);
+    __m256 delta_v_shifted = _mm256_mul_ps(SHIFT_V, delta_v);
+    __m256 packed_adj_v    = _mm256_set1_ps(8 * delta);
+
+    size_t pix_arr_pos = 0;
+
+    __m256 y_0 = _mm256_set1_ps(y_rend);
+    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos++, y_0 = _mm256_sub_ps(y_0, delta_v))
+    {
+        __m256 x_0 = _mm256_add_ps(_mm256_set1_ps(x_rend), delta_v_shifted);
+        for(unsigned x_pos = 0; x_pos < SCREEN_WIDTH; x_pos += 8, x_0 = _mm256_add_ps(x_0, packed_adj_v))
+        {
+            __m256 x_n = _mm256_setzero_ps();
+            __m256 y_n = _mm256_setzero_ps();
+
+            __m256i n = _mm256_setzero_si256();
+            for(volatile unsigned i = 0; i < N_ITERATIONS; i++)
+            {
+                __m256 x2 = _mm256_mul_ps(x_n, x_n);
+                __m256 y2 = _mm256_mul_ps(y_n, y_n);
+                __m256 xy = _mm256_mul_ps(x_n, y_n);
+
+                __m256 cmp = _mm256_cmp_ps(_mm256_add_ps(x2, y2), MAX_ZERO_OFFSET2_V, _CMP_LT_OQ);
+                if(_mm256_movemask_ps(cmp) == 0) break;
+
+                n = _mm256_sub_epi32(n, _mm256_castps_si256(cmp));
+
+                x_n = _mm256_add_ps(_mm256_sub_ps(x2, y2), x_0);
+                y_n = _mm256_add_ps(_mm256_add_ps(xy, xy), y_0);
+            }
+
+            _mm256_storeu_si256((__m256i *)(counts + pix_arr_pos), n);
+            pix_arr_pos += 8;
+        }
+    }
+
+    return TimeCounterEnd() - start;
+}
+
+int64_t RenderIntrinsics(unsigned *counts, double x_rend, double y_rend, double delta)
+{
+    int64_t start = TimeCounterStart();
+
+    const __m256d MAX_ZERO_OFFSET2_V = _mm256_set1_pd(MAX_ZERO_OFFSET * MAX_ZERO_OFFSET);
+    const __m256d SHIFT_V            = _mm256_set_pd(3, 2, 1, 0);
+
+    __m256d delta_v         = _mm256_set1_pd(delta);
+    __m256d delta_v_shifted = _mm256_mul_pd(SHIFT_V, delta_v);
+    __m256d packed_adj_v    = _mm256_set1_pd(4 * delta);
+
+    size_t pix_arr_pos = 0;
+
+    __m256d y_0 = _mm256_set1_pd(y_rend);
+    for(unsigned y_pos = 0; y_pos < SCREEN_HEIGHT; y_pos++, y_0 = _mm256_sub_pd(y_0, delta_v))
+    {
+        __m256d x_0 = _mm256_add_pd(_mm256_set1_pd(x_rend), delta_v_shifted);
+        for(unsigned x_pos = 0; x_pos < SCREEN_WIDTH; x_pos += 4, x_0 = _mm256_add_pd(x_0, packed_adj_v))
+        {
+            __m256d x_n = _mm256_setzero_pd();
+            __m256d y_n = _mm256_setzero_pd();
+
+            __m256i n = _mm256_setzero_si256();
+            for(volatile unsigned i = 0; i < N_ITERATIONS; i++)
+            {
+                __m256d x2 = _mm256_mul_pd(x_n, x_n);
+                __m256d y2 = _mm256_mul_pd(y_n, y_n);
+                __m256d xy = _mm256_mul_pd(x_n, y_n);
+
+                __m256d cmp = _mm256_cmp_pd(_mm256_add_pd(x2, y2), MAX_ZERO_OFFSET2_V, _CMP_LT_OQ);
+                if(_mm256_movemask_pd(cmp) == 0) break;
+
+                n = _mm256_sub_epi64(n, _mm256_castpd_si256(cmp));
+
+                x_n = _mm256_add_pd(_mm256_sub_pd(x2, y2), x_0);
+                y_n = _mm256_add_pd(_mm256_add_pd(xy, xy), y_0);
+            }
+
+            // Low halves of the 64-bit counts: dwords 0, 2, 4, 6.
+            __m256i packed = _mm256_permutevar8x32_epi32(n, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+            _mm_storeu_si128((__m128i *)(counts + pix_arr_pos), _mm256_castsi256_si128(packed));
+            pix_arr_pos += 4;
+        }
+    }
+
+    return TimeCounterEnd() - start;
+}
+#endif
+
+// Both kernels take turns on the starting view, so frequency changes spread over them evenly, and the medians of
+// N_TESTS runs are compared. Ticks per iteration are per pixel iteration and can be compared between builds for
+// different targets.
+template<typename REAL>
+void TestPortable(unsigned *portable_counts, unsigned *intrinsic_counts, const char *type_name)
+{
+    REAL ratio       = (REAL)SCREEN_HEIGHT / (REAL)SCREEN_WIDTH;
+    REAL coefficient = (SCREEN_WIDTH > SCREEN_HEIGHT) ? SCREEN_WIDTH : SCREEN_HEIGHT;
+
+    REAL delta  = 2 * MAX_ZERO_OFFSET / coefficient;
+    REAL x_rend = -MAX_ZERO_OFFSET;
+    REAL y_rend = MAX_ZERO_OFFSET * ratio;
+
+    int64_t portable_ticks[N_TESTS]  = {};
+    int64_t intrinsic_ticks[N_TESTS] = {};
+    for(size_t test = 0; test < N_TESTS; test++)
+    {
+        portable_ticks[test] = RenderPortable(portable_counts, x_rend, y_rend, delta);
+#ifdef __AVX2__
+        intrinsic_ticks[test] = RenderIntrinsics(intrinsic_counts, x_rend, y_rend, delta);
+#endif
+    }
+
+    qsort(portable_ticks,  N_TESTS, sizeof(int64_t), CompareTicks);
+    qsort(intrinsic_ticks, N_TESTS, sizeof(int64_t), CompareTicks);
+
+    double n_iterations = 0;
+    for(size_t pix = 0; pix < SCREEN_WIDTH * SCREEN_HEIGHT; pix++) n_iterations += portable_counts[pix];
+
+    double portable_median = (double)portable_ticks[N_TESTS / 2];
+    printf("[%zu x %s] std::experimental::simd: %.0lf ticks, %.3lf per iteration\n", stdx::native_simd<REAL>::size(), type_name,
+           portable_median, portable_median / n_iterations);
+
+#ifdef __AVX2__
+    double intrinsic_median = (double)intrinsic_ticks[N_TESTS / 2];
+    bool   identical        = (memcmp(portable_counts, intrinsic_counts, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(unsigned)) == 0);
+
+    printf("[%zu x %s] intrinsics:              %.0lf ticks, %.3lf per iteration; portable x%.3lf, counts %s\n", 32 / sizeof(REAL), type_name,
+           intrinsic_median, intrinsic_median / n_iterations, portable_median / intrinsic_median, identical ? "identical" : "DIFFER");
+#else
+    (void)intrinsic_counts;
+#endif
+}
+
+int CompareTicks(const void *first, const void *second)
+{
+    int64_t a = *(const int64_t *)first;
+    int64_t b = *(const int64_t *)second;
+
+    return (a > b) - (a < b);
+}
@@ -0,0 +1,79 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Live statistics of the interactive viewers, one record per rendered frame. They are shown in the window title and
+// can be appended to a CSV file together with the view, so the cost of a frame can be matched with what was on screen.
+
+const size_t TELEMETRY_TITLE_SIZE  = 256;
+const size_t TELEMETRY_KERNEL_SIZE = 64;
+
+struct FrameStats
+{
+    char kernel[TELEMETRY_KERNEL_SIZE];  // formula, vector type and rendering mode
+
+    unsigned width;         // rendered resolution, smaller than the window in budget mode
+    unsigned height;
+    unsigned n_iterations;
+
+    double x_rend;
+    double y_rend;
+    double delta;
+
+    double render_ms;       // kernel and coloring
+    double present_ms;      // texture upload, drawing and display
+    double iterations;      // sum of escape counts
+};
+
+inline double SumCounts(const unsigned *counts, size_t n_pixels);
+
+inline void  FormatTelemetry(char *title, size_t size, const FrameStats *stats);
+inline FILE *OpenTelemetryCSV(const char *path);
+inline void  WriteTelemetryCSV(FILE *csv, size_t frame, double time_ms, const FrameStats *stats);
+
+inline double SumCounts(const unsigned *counts, size_t n_pixels)
+{
+    uint64_t sum = 0;
+    for(size_t pix = 0; pix < n_pixels; pix++) sum += counts[pix];
+
+    return (double)sum;
+}
+
+inline void FormatTelemetry(char *title, size_t size, const FrameStats *stats)
+{
+    double n_pixels = (double)stats->width * stats->height;
+
+    snprintf(title, size, "%s | %ux%u | render %.1lf ms | present %.1lf ms | %.1lf Mpx/s | %.1lf M iterations | %.1lf per pixel",
+             stats->kernel, stats->width, stats->height, stats->render_ms, stats->present_ms,
+             (stats->render_ms > 0) ? n_pixels / (stats->render_ms * 1e3) : 0, stats->iterations * 1e-6,
+             (n_pixels > 0) ? stats->iterations / n_pixels : 0);
+}
+
+inline FILE *OpenTelemetryCSV(const char *path)
+{
+    FILE *csv = fopen(path, "w");
+    if(!csv)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    fprintf(csv, "frame,time_ms,kernel,width,height,n_iterations,x_rend,y_rend,delta,render_ms,present_ms,mpixels_per_s,iterations,iterations_per_pixel\n");
+    return csv;
+}
+
+// Lines are flushed right away, so the log can be followed while the viewer runs.
+inline void WriteTelemetryCSV(FILE *csv, size_t frame, double time_ms, const FrameStats *stats)
+{
+    double n_pixels = (double)stats->width * stats->height;
+
+    fprintf(csv, "%zu,%.3lf,\"%s\",%u,%u,%u,%.17lg,%.17lg,%.17lg,%.3lf,%.3lf,%.3lf,%.0lf,%.3lf\n", frame, time_ms, stats->kernel,
+            stats->width, stats->height, stats->n_iterations, stats->x_rend, stats->y_rend, stats->delta, stats->render_ms, stats->present_ms,
+            (stats->render_ms > 0) ? n_pixels / (stats->render_ms * 1e3) : 0, stats->iterations, (n_pixels > 0) ? stats->iterations / n_pixels : 0);
+    fflush(csv);
+}
+
+#endif // TELEMETRY_H
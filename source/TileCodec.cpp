@@ -0,0 +1,207 @@
+#include <immintrin.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TileCodec.h"
+
+static inline __m256i LoadBlock(const unsigned *counts, size_t n_left);
+static inline __m256i PreviousCounts(__m256i block, __m256i previous);
+static inline __m256i PrefixSum(__m256i differences);
+static inline __m256i LastCount(__m256i block);
+static inline uint8_t *WriteRun(uint8_t *encoded, size_t n_blocks);
+
+size_t EncodedCountsBound(size_t n_counts)
+{
+    return (n_counts + CODEC_BLOCK - 1) / CODEC_BLOCK * (1 + sizeof(unsigned) * CODEC_BLOCK);
+}
+
+// encoded has to hold EncodedCountsBound(n_counts) bytes, returns the number written.
+size_t EncodeCounts(uint8_t *encoded, const unsigned *counts, size_t n_counts)
+{
+    uint8_t *encoded_p = encoded;
+    size_t   n_run     = 0;
+
+    __m256i previous = _mm256_setzero_si256();
+    for(size_t pix = 0; pix < n_counts; pix += CODEC_BLOCK)
+    {
+        __m256i block      = LoadBlock(counts + pix, n_counts - pix);
+        __m256i difference = _mm256_sub_epi32(block, PreviousCounts(block, previous));
+        __m256i zigzag     = _mm256_xor_si256(_mm256_slli_epi32(difference, 1), _mm256_srai_epi32(difference, 31));
+
+        previous = LastCount(block);
+
+        __m128i bits_any = _mm_or_si128(_mm256_castsi256_si128(zigzag), _mm256_extracti128_si256(zigzag, 1));
+        bits_any = _mm_or_si128(bits_any, _mm_shuffle_epi32(bits_any, _MM_SHUFFLE(1, 0, 3, 2)));
+        bits_any = _mm_or_si128(bits_any, _mm_shuffle_epi32(bits_any, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        unsigned bits_all = (unsigned)_mm_cvtsi128_si32(bits_any);
+        if(bits_all == 0)
+        {
+            n_run++;
+            if(n_run == CODEC_MAX_RUN)
+            {
+                encoded_p = WriteRun(encoded_p, n_run);
+                n_run     = 0;
+            }
+            continue;
+        }
+
+        encoded_p = WriteRun(encoded_p, n_run);
+        n_run     = 0;
+
+        // The most significant bit in use goes to the sign bits, then every bit plane is one movemask.
+        unsigned width = 32 - __builtin_clz(bits_all);
+        *encoded_p++ = (uint8_t)width;
+
+        zigzag = _mm256_sll_epi32(zigzag, _mm_cvtsi32_si128(32 - width));
+        for(unsigned bit = 0; bit < width; bit++)
+        {
+            *encoded_p++ = (uint8_t)_mm256_movemask_ps(_mm256_castsi256_ps(zigzag));
+            zigzag = _mm256_add_epi32(zigzag, zigzag);
+        }
+    }
+
+    encoded_p = WriteRun(encoded_p, n_run);
+
+    return (size_t)(encoded_p - encoded);
+}
+
+// False if the data is damaged or does not hold exactly n_counts counts.
+bool DecodeCounts(unsigned *counts, size_t n_counts, const uint8_t *encoded, size_t size)
+{
+    const __m256i LANE_BITS_V = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    const uint8_t *encoded_end = encoded + size;
+
+    __m256i previous = _mm256_setzero_si256();
+    size_t  pix      = 0;
+    while(pix < n_counts)
+    {
+        if(encoded == encoded_end) return false;
+
+        uint8_t header = *encoded++;
+        if(header >= CODEC_RUN)
+        {
+            size_t n_run = (size_t)(header - CODEC_RUN + 1) * CODEC_BLOCK;
+            if(n_run > n_counts - pix + CODEC_BLOCK - 1) return false;
+
+            unsigned last = (unsigned)_mm256_extract_epi32(previous, 0);
+            for(size_t end = (pix + n_run < n_counts) ? pix + n_run : n_counts; pix < end; pix++) counts[pix] = last;
+            continue;
+        }
+
+        unsigned width = header;
+        if(width > 32 || (size_t)(encoded_end - encoded) < width) return false;
+
+        __m256i zigzag = _mm256_setzero_si256();
+        for(unsigned bit = 0; bit < width; bit++)
+        {
+            __m256i plane = _mm256_and_si256(_mm256_set1_epi32(*encoded++), LANE_BITS_V);
+            zigzag = _mm256_sub_epi32(_mm256_add_epi32(zigzag, zigzag), _mm256_cmpeq_epi32(plane, LANE_BITS_V));
+        }
+
+        __m256i difference = _mm256_xor_si256(_mm256_srli_epi32(zigzag, 1), _mm256_sub_epi32(_mm256_setzero_si256(),
+                                                                                               _mm256_and_si256(zigzag, _mm256_set1_epi32(1))));
+        __m256i block = _mm256_add_epi32(PrefixSum(difference), previous);
+        previous = LastCount(block);
+
+        if(n_counts - pix >= CODEC_BLOCK)
+        {
+            _mm256_storeu_si256((__m256i *)(counts + pix), block);
+        }
+        else
+        {
+            unsigned tail[CODEC_BLOCK] = {};
+            _mm256_storeu_si256((__m256i *)tail, block);
+            memcpy(counts + pix, tail, (n_counts - pix) * sizeof(unsigned));
+        }
+        pix += CODEC_BLOCK;
+    }
+
+    return encoded == encoded_end;
+}
+
+bool WriteEncodedCounts(FILE *stream, const unsigned *counts, unsigned width, unsigned height)
+{
+    size_t   n_counts = (size_t)width * height;
+    uint8_t *encoded  = (uint8_t *)calloc(EncodedCountsBound(n_counts) + 1, 1);
+
+    uint64_t size = EncodeCounts(encoded, counts, n_counts);
+    uint32_t dims[2] = {width, height};
+
+    bool written = fwrite(CODEC_MAGIC, sizeof(CODEC_MAGIC), 1, stream) == 1 && fwrite(dims, sizeof(dims), 1, stream) == 1 &&
+                   fwrite(&size, sizeof(size), 1, stream) == 1 && fwrite(encoded, 1, size, stream) == size;
+
+    free(encoded);
+    return written;
+}
+
+// Counts read from stream, NULL on errors. The caller frees them.
+unsigned *ReadEncodedCounts(FILE *stream, unsigned *width, unsigned *height)
+{
+    char     magic[sizeof(CODEC_MAGIC)] = {};
+    uint32_t dims[2] = {};
+    uint64_t size    = 0;
+
+    if(fread(magic, sizeof(magic), 1, stream) != 1 || memcmp(magic, CODEC_MAGIC, sizeof(magic)) != 0) return NULL;
+    if(fread(dims, sizeof(dims), 1, stream) != 1 || fread(&size, sizeof(size), 1, stream) != 1) return NULL;
+
+    size_t n_counts = (size_t)dims[0] * dims[1];
+    if(n_counts == 0 || size > EncodedCountsBound(n_counts)) return NULL;
+
+    uint8_t  *encoded = (uint8_t  *)calloc(size + 1, 1);
+    unsigned *counts  = (unsigned *)calloc(n_counts, sizeof(unsigned));
+
+    bool decoded = fread(encoded, 1, size, stream) == size && DecodeCounts(counts, n_counts, encoded, size);
+    free(encoded);
+
+    if(!decoded)
+    {
+        free(counts);
+        return NULL;
+    }
+
+    *width  = dims[0];
+    *height = dims[1];
+    return counts;
+}
+
+// A block past the end is filled with the last count, so the padding costs no bits.
+static inline __m256i LoadBlock(const unsigned *counts, size_t n_left)
+{
+    if(n_left >= CODEC_BLOCK) return _mm256_loadu_si256((const __m256i *)counts);
+
+    unsigned block[CODEC_BLOCK] = {};
+    for(size_t lane = 0; lane < CODEC_BLOCK; lane++) block[lane] = counts[(lane < n_left) ? lane : n_left - 1];
+
+    return _mm256_loadu_si256((const __m256i *)block);
+}
+
+// Lane i gets count i - 1 of the block, lane 0 the last count of the block before.
+static inline __m256i PreviousCounts(__m256i block, __m256i previous)
+{
+    __m256i rotated = _mm256_permutevar8x32_epi32(block, _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6));
+    return _mm256_blend_epi32(rotated, previous, 0x01);
+}
+
+// Inclusive prefix sum of 8 lanes: within each 128-bit half by byte shifts, then the lower half carried into the upper.
+static inline __m256i PrefixSum(__m256i differences)
+{
+    differences = _mm256_add_epi32(differences, _mm256_slli_si256(differences, 4));
+    differences = _mm256_add_epi32(differences, _mm256_slli_si256(differences, 8));
+
+    __m256i carry = _mm256_permutevar8x32_epi32(differences, _mm256_set1_epi32(3));
+    return _mm256_add_epi32(differences, _mm256_blend_epi32(_mm256_setzero_si256(), carry, 0xF0));
+}
+
+// Last count of the block in every lane.
+static inline __m256i LastCount(__m256i block)
+{
+    return _mm256_permutevar8x32_epi32(block, _mm256_set1_epi32(7));
+}
+
+static inline uint8_t *WriteRun(uint8_t *encoded, size_t n_blocks)
+{
+    if(n_blocks > 0) *encoded++ = (uint8_t)(CODEC_RUN + n_blocks - 1);
+    return encoded;
+}
@@ -0,0 +1,30 @@
+#ifndef TILE_CODEC_H
+#define TILE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Compressed escape counts for everything that is stored or sent: counts change little from pixel to pixel and are
+// constant over large regions. Counts are taken in blocks of CODEC_BLOCK in raster order, each one predicted by the
+// pixel before it. A block is a header byte with the width b of its largest zig-zag coded difference, followed by b
+// bytes: bit j of the 8 differences, most significant first, one movemask each. Blocks whose counts all repeat the
+// previous one are not written: a header byte CODEC_RUN + k stands for k + 1 such blocks. The last block is padded with
+// its last count, the number of counts is not stored, the decoder has to know it.
+
+const unsigned CODEC_BLOCK   = 8;
+const uint8_t  CODEC_RUN     = 0x80;
+const size_t   CODEC_MAX_RUN = 0x80;
+
+const char CODEC_MAGIC[4] = {'M', 'B', 'Z', 'C'};
+
+size_t EncodedCountsBound(size_t n_counts);
+
+size_t EncodeCounts(uint8_t *encoded, const unsigned *counts, size_t n_counts);
+bool   DecodeCounts(unsigned *counts, size_t n_counts, const uint8_t *encoded, size_t size);
+
+// Files of encoded counts: CODEC_MAGIC, uint32 width and height, uint64 size of the data, native byte order.
+bool      WriteEncodedCounts(FILE *stream, const unsigned *counts, unsigned width, unsigned height);
+unsigned *ReadEncodedCounts(FILE *stream, unsigned *width, unsigned *height);
+
+#endif // TILE_CODEC_H
@@ -0,0 +1,80 @@
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "TileProtocol.h"
+
+// Listening (server) or connected (client) socket, -1 on errors. Server sockets are non-blocking.
+int OpenSocket(SocketAddress address, bool server)
+{
+    int fd = -1;
+    int result = -1;
+
+    if(address.port)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if(fd < 0)
+        {
+            perror("socket");
+            return -1;
+        }
+
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET,  SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,  &one, sizeof(one));
+
+        sockaddr_in inet = {};
+        inet.sin_family      = AF_INET;
+        inet.sin_port        = htons((uint16_t)address.port);
+        inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        result = server ? bind(fd, (sockaddr *)&inet, sizeof(inet)) : connect(fd, (sockaddr *)&inet, sizeof(inet));
+    }
+    else
+    {
+        sockaddr_un local = {};
+        local.sun_family = AF_UNIX;
+        if(strlen(address.path) >= sizeof(local.sun_path))
+        {
+            fprintf(stderr, "socket path is too long: %s\n", address.path);
+            return -1;
+        }
+        strcpy(local.sun_path, address.path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0)
+        {
+            perror("socket");
+            return -1;
+        }
+
+        if(server) unlink(address.path);
+        result = server ? bind(fd, (sockaddr *)&local, sizeof(local)) : connect(fd, (sockaddr *)&local, sizeof(local));
+    }
+
+    if(result == 0 && server) result = listen(fd, SOMAXCONN);
+    if(result == 0 && server) result = fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    if(result != 0)
+    {
+        perror(address.port ? "127.0.0.1" : address.path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+double NowUs()
+{
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
@@ -0,0 +1,62 @@
+#ifndef TILE_PROTOCOL_H
+#define TILE_PROTOCOL_H
+
+#include <stdint.h>
+
+// Tile protocol. A client sends TileRequest structs and gets back, for each of them, a TileResponse followed by size bytes
+// of payload. Responses come in the order batches are rendered, not in the order of requests, so they are matched by id.
+// Fields are in host byte order: the server only listens on a Unix socket or on localhost.
+//
+// (x_rend, y_rend) is the top left pixel of a view and the tile is the width x height pixels of it starting at column
+// x_offset and row y_offset. The kernels step x from the left edge of what they render, so a tile sent as a view of its
+// own would get coordinates rounded differently from the whole view; with offsets it gets exactly those of the view.
+enum TileFormat
+{
+    TILE_COUNTS, // uint32 escape counts, row after row
+    TILE_RGBA,   // colored as in the viewer
+    TILE_PNG,
+    TILE_COUNTS_ENCODED, // escape counts compressed by EncodeCounts (TileCodec.h)
+};
+
+enum TileStatus
+{
+    TILE_OK,
+    TILE_BAD_REQUEST,
+};
+
+struct TileRequest
+{
+    uint32_t id;
+    uint32_t width;
+    uint32_t height;
+    uint32_t n_iterations;
+    uint32_t format;
+    uint32_t high_precision;
+    uint32_t x_offset;
+    uint32_t y_offset;
+
+    double x_rend;
+    double y_rend;
+    double delta;
+};
+
+struct TileResponse
+{
+    uint32_t id;
+    uint32_t status;
+    uint64_t size;
+};
+
+// Unix socket at path, or localhost TCP if port is not 0.
+struct SocketAddress
+{
+    const char *path;
+    unsigned    port;
+};
+
+const char DEFAULT_SOCKET[] = "/tmp/mandelbrot.sock";
+
+int OpenSocket(SocketAddress address, bool server);
+double NowUs();
+
+#endif // TILE_PROTOCOL_H